@@ -0,0 +1,175 @@
+/**
+ * Benchmark of tile-compressed FITS output. Writes synthetic sky frame the
+ * same way as Image::writeData does - empty primary HDU followed by the
+ * image - uncompressed and with the cfitsio compression algorithms, reports
+ * write throughput and file size and checks that integer data are read
+ * back unchanged.
+ *
+ * Run as bench_fitscompress [width [height [directory]]], default is 4k x 4k
+ * image written to /tmp.
+ */
+
+#include <fitsio.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// gaussian noise around sky level, with some stars
+static void fillSky (uint16_t *data, long w, long h)
+{
+	for (long i = 0; i < w * h; i++)
+	{
+		double u1 = (random () + 1.0) / (RAND_MAX + 2.0);
+		double u2 = (random () + 1.0) / (RAND_MAX + 2.0);
+		data[i] = 1000 + 15 * sqrt (-2 * log (u1)) * cos (2 * M_PI * u2);
+	}
+	for (int s = 0; s < w * h / 20000; s++)
+	{
+		long sx = random () % w;
+		long sy = random () % h;
+		double flux = random () % 30000;
+		for (long y = sy - 5; y <= sy + 5; y++)
+		{
+			for (long x = sx - 5; x <= sx + 5; x++)
+			{
+				if (x < 0 || y < 0 || x >= w || y >= h)
+					continue;
+				double v = data[y * w + x] + flux * exp (-((x - sx) * (x - sx) + (y - sy) * (y - sy)) / 4.0);
+				data[y * w + x] = v > 65535 ? 65535 : v;
+			}
+		}
+	}
+}
+
+// returns written file size, -1 on error
+static long writeImage (const std::string &fn, int compressType, float quantize, int bitpix, int datatype, void *data, long w, long h)
+{
+	int status = 0;
+	fitsfile *fptr;
+	fits_create_file (&fptr, ("!" + fn).c_str (), &status);
+	fits_create_hdu (fptr, &status);
+	fits_write_key_log (fptr, (char *) "SIMPLE", 1, (char *) "conform to FITS standard", &status);
+	fits_write_key_lng (fptr, (char *) "BITPIX", 16, (char *) "unsigned short data", &status);
+	fits_write_key_lng (fptr, (char *) "NAXIS", 0, (char *) "number of axes", &status);
+	fits_write_key_log (fptr, (char *) "EXTEND", 1, (char *) "this is FITS with extensions", &status);
+
+	long sizes[2] = {w, h};
+	if (compressType)
+	{
+		if (datatype == TFLOAT)
+			fits_set_quantize_level (fptr, quantize, &status);
+		fits_set_compression_type (fptr, compressType, &status);
+	}
+	fits_create_img (fptr, bitpix, 2, sizes, &status);
+	fits_write_img (fptr, datatype, 1, w * h, data, &status);
+	fits_close_file (fptr, &status);
+
+	// writes are measured including sync, as FitsWriter does
+	FILE *f = fopen (fn.c_str (), "r");
+	if (f)
+	{
+		fsync (fileno (f));
+		fclose (f);
+	}
+
+	if (status)
+	{
+		fits_report_error (stderr, status);
+		return -1;
+	}
+	struct stat st;
+	if (stat (fn.c_str (), &st))
+		return -1;
+	return st.st_size;
+}
+
+// returns true if integer data were read back unchanged
+static bool verifyImage (const std::string &fn, uint16_t *data, long w, long h)
+{
+	int status = 0;
+	fitsfile *fptr;
+	fits_open_diskfile (&fptr, fn.c_str (), READONLY, &status);
+	// image is in the first extension
+	fits_movabs_hdu (fptr, 2, NULL, &status);
+	uint16_t *r = new uint16_t[w * h];
+	int anynull = 0;
+	fits_read_img_usht (fptr, 0, 1, w * h, 0, r, &anynull, &status);
+	fits_close_file (fptr, &status);
+	bool ret = (status == 0);
+	for (long i = 0; ret && i < w * h; i++)
+		ret = (r[i] == data[i]);
+	delete[] r;
+	return ret;
+}
+
+static void bench (const char *name, const std::string &fn, int compressType, float quantize, int bitpix, int datatype, void *data, long w, long h, uint16_t *verify, long rawSize)
+{
+	double t0 = now ();
+	long size = writeImage (fn, compressType, quantize, bitpix, datatype, data, w, h);
+	double t1 = now ();
+	if (size < 0)
+	{
+		std::cout << std::setw (16) << name << " failed" << std::endl;
+		return;
+	}
+	std::cout << std::setw (16) << name << std::fixed << std::setprecision (3)
+		<< " " << (t1 - t0) << " s, " << std::setprecision (1) << (rawSize / 1048576.0 / (t1 - t0)) << " MB/s, "
+		<< (size / 1048576.0) << " MB, ratio " << std::setprecision (2) << ((double) rawSize / size);
+	if (verify)
+		std::cout << (verifyImage (fn, verify, w, h) ? ", lossless" : ", DATA DIFFER");
+	std::cout << std::endl;
+}
+
+int main (int argc, char **argv)
+{
+	long w = 4096;
+	long h = 4096;
+	std::string dir ("/tmp");
+	if (argc > 1)
+		w = h = atol (argv[1]);
+	if (argc > 2)
+		h = atol (argv[2]);
+	if (argc > 3)
+		dir = argv[3];
+
+	std::string fn = dir + "/bench_fitscompress.fits";
+
+	uint16_t *u = new uint16_t[w * h];
+	fillSky (u, w, h);
+
+	long rawSize = w * h * sizeof (uint16_t);
+	bench ("uint16 none", fn, 0, 0, USHORT_IMG, TUSHORT, u, w, h, u, rawSize);
+	bench ("uint16 rice", fn, RICE_1, 0, USHORT_IMG, TUSHORT, u, w, h, u, rawSize);
+	bench ("uint16 hcompress", fn, HCOMPRESS_1, 0, USHORT_IMG, TUSHORT, u, w, h, u, rawSize);
+	bench ("uint16 gzip", fn, GZIP_1, 0, USHORT_IMG, TUSHORT, u, w, h, u, rawSize);
+	bench ("uint16 gzip2", fn, GZIP_2, 0, USHORT_IMG, TUSHORT, u, w, h, u, rawSize);
+
+	float *f = new float[w * h];
+	for (long i = 0; i < w * h; i++)
+		f[i] = u[i] / 3.0;
+	delete[] u;
+
+	rawSize = w * h * sizeof (float);
+	bench ("float none", fn, 0, 0, FLOAT_IMG, TFLOAT, f, w, h, NULL, rawSize);
+	bench ("float gzip2", fn, GZIP_2, 0, FLOAT_IMG, TFLOAT, f, w, h, NULL, rawSize);
+	bench ("float rice q4", fn, RICE_1, 4, FLOAT_IMG, TFLOAT, f, w, h, NULL, rawSize);
+	bench ("float rice q16", fn, RICE_1, 16, FLOAT_IMG, TFLOAT, f, w, h, NULL, rawSize);
+	delete[] f;
+
+	unlink (fn.c_str ());
+	return 0;
+}
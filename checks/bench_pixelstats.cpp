@@ -0,0 +1,95 @@
+/**
+ * Benchmark of pixel statistics kernels. Compares kernels with code
+ * previously used in Camera::updateStatistics.
+ *
+ * Run as bench_pixelstats [number of pixels], default is 9k x 9k image.
+ */
+
+#include "pixelstats.h"
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <sys/time.h>
+
+using namespace rts2core;
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// loop previously used in Camera::updateStatistics
+template <typename t> double oldStatistics (t *data, size_t n)
+{
+	long double tSum = 0;
+	double tMin = 1e300;
+	double tMax = -1e300;
+	for (t *tData = data; tData < data + n; tData++)
+	{
+		t tD = *tData;
+		tSum += tD;
+		if (tD < tMin)
+			tMin = tD;
+		if (tD > tMax)
+			tMax = tD;
+	}
+	return tSum + tMin + tMax;
+}
+
+template <typename t> void bench (const char *name, t *data, size_t n)
+{
+	double t0 = now ();
+	volatile double r = oldStatistics (data, n);
+	double t1 = now ();
+
+	PixelStats ps;
+	pixelStatsScalar (data, n, ps);
+	double t2 = now ();
+
+	ps.clear ();
+	pixelStats (data, n, ps);
+	double t3 = now ();
+
+	double *cs = new double[1024];
+	double rs, rmax;
+	int np = 0;
+	for (size_t i = 0; i + 1024 <= n; i += 1024)
+		thresholdRowScalar (data + i, 1024, 1000, cs, rs, np, rmax);
+	double t4 = now ();
+	for (size_t i = 0; i + 1024 <= n; i += 1024)
+		thresholdRow (data + i, 1024, 1000, cs, rs, np, rmax);
+	double t5 = now ();
+	delete[] cs;
+
+	(void) r;
+	std::cout << std::setw (8) << name << std::fixed << std::setprecision (4)
+		<< " old " << (t1 - t0) << " s, scalar " << (t2 - t1) << " s, " << pixelKernelName () << " " << (t3 - t2) << " s"
+		<< ", threshold scalar " << (t4 - t3) << " s, " << pixelKernelName () << " " << (t5 - t4) << " s" << std::endl;
+}
+
+int main (int argc, char **argv)
+{
+	size_t n = 9216 * 9216;
+	if (argc > 1)
+		n = atol (argv[1]);
+
+	uint16_t *u = new uint16_t[n];
+	for (size_t i = 0; i < n; i++)
+		u[i] = random () % 65536;
+	bench ("uint16", u, n);
+	bench ("int16", (int16_t *) u, n);
+	bench ("uint8", (uint8_t *) u, n);
+	delete[] u;
+
+	float *f = new float[n];
+	for (size_t i = 0; i < n; i++)
+		f[i] = random () / 1000.0;
+	bench ("float", f, n);
+	bench ("int32", (int32_t *) f, n);
+	delete[] f;
+
+	return 0;
+}
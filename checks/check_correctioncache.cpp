@@ -0,0 +1,136 @@
+#include "correctioncache.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <check.h>
+#include <check_utils.h>
+
+using namespace rts2teld;
+
+#define JD0    2457500.5
+
+// synthetic correction - rotation around X axis (as precession in obliquity), angle varies with time
+static void correct (double ra, double dec, double JD, double c[2])
+{
+	double angle = (0.3 + 0.5 * (JD - JD0) + 0.001 * sin ((JD - JD0) * 2 * M_PI)) * M_PI / 180.0;
+	double r = ra * M_PI / 180.0;
+	double d = dec * M_PI / 180.0;
+	double x = cos (d) * cos (r);
+	double y = cos (d) * sin (r);
+	double z = sin (d);
+	double y2 = y * cos (angle) - z * sin (angle);
+	double z2 = y * sin (angle) + z * cos (angle);
+	c[0] = atan2 (y2, x) * 180.0 / M_PI;
+	if (c[0] < 0)
+		c[0] += 360.0;
+	c[1] = asin (z2) * 180.0 / M_PI;
+}
+
+static void fillCache (CorrectionCache &cache, double ra, double dec, double JD, double step)
+{
+	CorrectionCache::Node nodes[3];
+	for (int i = 0; i < 3; i++)
+	{
+		double nJD = CorrectionCache::getNodeJD (JD, step, i);
+		double c[2], c_ra[2], c_dec[2];
+		correct (ra, dec, nJD, c);
+		correct (ra + CORR_CACHE_DELTA, dec, nJD, c_ra);
+		correct (ra, dec + CORR_CACHE_DELTA, nJD, c_dec);
+		nodes[i] = CorrectionCache::makeNode (ra, dec, c, c_ra, c_dec);
+	}
+	cache.set (ra, dec, JD, step, 1, nodes);
+}
+
+// distance of interpolated and exact position, in arcsec
+static double interpolationError (CorrectionCache &cache, double ra, double dec, double JD)
+{
+	double c[2];
+	correct (ra, dec, JD, c);
+	cache.apply (ra, dec, JD);
+	double d_ra = fmod (ra - c[0] + 540.0, 360.0) - 180.0;
+	return 3600.0 * sqrt (pow (d_ra * cos (c[1] * M_PI / 180.0), 2) + pow (dec - c[1], 2));
+}
+
+START_TEST(COVERS)
+{
+	CorrectionCache cache;
+	ck_assert (cache.covers (10, 20, JD0, 1, 0.1) == false);
+	ck_assert_dbl_eq (cache.getStep (), 0.0, 10e-10);
+
+	fillCache (cache, 10, 20, JD0, 300);
+	ck_assert_dbl_eq (cache.getStep (), 300.0, 10e-10);
+
+	ck_assert (cache.covers (10, 20, JD0, 1, 0.1));
+	ck_assert (cache.covers (10.05, 20.05, JD0 + 200 / 86400.0, 1, 0.1));
+	// different corrections
+	ck_assert (cache.covers (10, 20, JD0, 3, 0.1) == false);
+	// outside interval
+	ck_assert (cache.covers (10, 20, JD0 - 1 / 86400.0, 1, 0.1) == false);
+	ck_assert (cache.covers (10, 20, JD0 + 301 / 86400.0, 1, 0.1) == false);
+	// too far
+	ck_assert (cache.covers (10.2, 20, JD0, 1, 0.1) == false);
+	ck_assert (cache.covers (10, 19.8, JD0, 1, 0.1) == false);
+
+	cache.invalidate ();
+	ck_assert (cache.covers (10, 20, JD0, 1, 0.1) == false);
+
+	// RA wraps around 0
+	fillCache (cache, 359.98, 0, JD0, 300);
+	ck_assert (cache.covers (0.02, 0, JD0, 1, 0.1));
+
+	// not close to poles
+	fillCache (cache, 10, 89.5, JD0, 300);
+	ck_assert (cache.covers (10, 89.5, JD0, 1, 0.1) == false);
+}
+END_TEST
+
+START_TEST(INTERPOLATION)
+{
+	CorrectionCache cache;
+
+	fillCache (cache, 10, 20, JD0, 300);
+	// exact at the first node
+	ck_assert_dbl_eq (interpolationError (cache, 10, 20, JD0), 0.0, 10e-6);
+
+	for (double t = 0; t <= 300; t += 25)
+	{
+		double JD = JD0 + t / 86400.0;
+		ck_assert_dbl_eq (interpolationError (cache, 10, 20, JD), 0.0, 0.001);
+		ck_assert_dbl_eq (interpolationError (cache, 10.07, 20.03, JD), 0.0, 0.01);
+		ck_assert_dbl_eq (interpolationError (cache, 9.95, 19.92, JD), 0.0, 0.01);
+	}
+
+	fillCache (cache, 359.98, -45, JD0, 300);
+	ck_assert_dbl_eq (interpolationError (cache, 0.05, -45.02, JD0 + 150 / 86400.0), 0.0, 0.01);
+}
+END_TEST
+
+Suite * correctioncache_suite (void)
+{
+	Suite *s;
+	TCase *tc_cache;
+
+	s = suite_create ("CorrectionCache");
+	tc_cache = tcase_create ("Interpolation of astrometric corrections");
+
+	tcase_add_test (tc_cache, COVERS);
+	tcase_add_test (tc_cache, INTERPOLATION);
+	suite_add_tcase (s, tc_cache);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = correctioncache_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,114 @@
+#include "histogram.h"
+
+#include <stdlib.h>
+#include <check.h>
+#include <check_utils.h>
+
+using namespace rts2core;
+
+Histogram *hist;
+
+void setup_histogram (void)
+{
+	hist = new Histogram (100);
+}
+
+void teardown_histogram (void)
+{
+	delete hist;
+}
+
+START_TEST(INTEGER)
+{
+	uint16_t data[] = {10, 12, 12, 13, 12, 15, 11};
+	hist->add (data, 7, 10, 15);
+
+	ck_assert_int_eq (hist->getCount (), 7);
+	ck_assert_dbl_eq (hist->getMode (), 12.0, 10e-10);
+	ck_assert_dbl_eq (hist->getMedian (), 12.0, 10e-10);
+	ck_assert_dbl_eq (hist->getQuantile (0), 10.0, 10e-10);
+	ck_assert_dbl_eq (hist->getQuantile (1), 15.0, 10e-10);
+
+	// values below and above current range
+	uint16_t data2[] = {1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 2};
+	hist->add (data2, 9, 2, 1000);
+
+	ck_assert_int_eq (hist->getCount (), 16);
+	ck_assert_int_eq (hist->getBins (), 100);
+	ck_assert_dbl_eq (hist->getMode (), 1000.0, 16.0);
+	ck_assert_dbl_eq (hist->getQuantile (0), 2.0, 16.0);
+	ck_assert_dbl_eq (hist->getQuantile (0.25), 12.0, 16.0);
+}
+END_TEST
+
+START_TEST(WIDE)
+{
+	uint32_t data[1000];
+	for (int i = 0; i < 1000; i++)
+		data[i] = i * 4000000;
+	data[500] = 3;
+	data[501] = 3;
+	hist->add (data, 1000, 0, 999 * 4000000.0);
+
+	ck_assert_int_eq (hist->getCount (), 1000);
+	ck_assert_dbl_eq (hist->getMedian (), 2000000000.0, 50000000.0);
+	ck_assert_dbl_eq (hist->getMode (), 0.0, 50000000.0);
+}
+END_TEST
+
+START_TEST(FLOAT)
+{
+	float data[10001];
+	for (int i = 0; i <= 10000; i++)
+		data[i] = -1 + i / 5000.0;
+	hist->add (data, 10001, -1, 1);
+
+	ck_assert_dbl_eq (hist->getMedian (), 0.0, 0.02);
+	ck_assert_dbl_eq (hist->getQuantile (0.25), -0.5, 0.02);
+	ck_assert_dbl_eq (hist->getQuantile (0.75), 0.5, 0.02);
+
+	// NaN is ignored
+	data[0] = NAN;
+	data[1] = 3;
+	hist->add (data, 2, NAN, NAN);
+
+	ck_assert_int_eq (hist->getCount (), 10002);
+	ck_assert_dbl_eq (hist->getQuantile (1), 3.0, 0.1);
+
+	hist->clear ();
+	ck_assert_int_eq (hist->getCount (), 0);
+	ck_assert (isnan (hist->getMedian ()));
+}
+END_TEST
+
+Suite * histogram_suite (void)
+{
+	Suite *s;
+	TCase *tc_histogram;
+
+	s = suite_create ("Histogram");
+	tc_histogram = tcase_create ("Streaming histogram");
+
+	tcase_add_checked_fixture (tc_histogram, setup_histogram, teardown_histogram);
+	tcase_add_test (tc_histogram, INTEGER);
+	tcase_add_test (tc_histogram, WIDE);
+	tcase_add_test (tc_histogram, FLOAT);
+	suite_add_tcase (s, tc_histogram);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = histogram_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
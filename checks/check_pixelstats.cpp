@@ -0,0 +1,217 @@
+#include "pixelstats.h"
+#include "rts2fits/channel.h"
+
+#include <stdlib.h>
+#include <check.h>
+#include <check_utils.h>
+
+using namespace rts2core;
+
+#define NPIX  100003
+
+template <typename t> void compareStats (t *data, size_t n)
+{
+	PixelStats ps, ref;
+
+	pixelKernelScalar (false);
+	pixelStats (data, n, ps);
+	pixelStatsScalar (data, n, ref);
+
+	ck_assert_int_eq (ps.n, n);
+	ck_assert_dbl_eq (ps.sum, ref.sum, fabs (ref.sum) * 1e-12 + 1e-12);
+	ck_assert_dbl_eq (ps.sum2, ref.sum2, fabs (ref.sum2) * 1e-12 + 1e-12);
+	ck_assert_dbl_eq (ps.min, ref.min, 10e-10);
+	ck_assert_dbl_eq (ps.max, ref.max, 10e-10);
+}
+
+template <typename t> void compareThreshold (t *data, size_t w, double threshold)
+{
+	double cs[w], csRef[w];
+	double rs, rsRef, rmax, rmaxRef;
+	int np = 0, npRef = 0;
+	for (size_t i = 0; i < w; i++)
+		cs[i] = csRef[i] = 1;
+
+	thresholdRow (data, w, threshold, cs, rs, np, rmax);
+	thresholdRowScalar (data, w, threshold, csRef, rsRef, npRef, rmaxRef);
+
+	ck_assert_int_eq (np, npRef);
+	ck_assert_dbl_eq (rs, rsRef, 10e-10);
+	if (npRef > 0)
+		ck_assert_dbl_eq (rmax, rmaxRef, 10e-10);
+	else
+		ck_assert (isnan (rmax));
+	for (size_t i = 0; i < w; i++)
+		ck_assert_dbl_eq (cs[i], csRef[i], 10e-10);
+}
+
+// two pass statistics, as previously calculated by Channel::computeStatistics
+template <typename t> void oldChannelStats (t *data, long n, long double &pixelSum, double &average, double &stdev)
+{
+	pixelSum = 0;
+	for (t *pixel = data; pixel < data + n; pixel++)
+		pixelSum += *pixel;
+	average = pixelSum / n;
+	long double s = 0;
+	for (t *pixel = data; pixel < data + n; pixel++)
+	{
+		long double tmp_s = *pixel - average;
+		s += tmp_s * tmp_s;
+	}
+	stdev = sqrt (s / n);
+}
+
+template <typename t> void compareChannelStats (t *data, long w, long h, int16_t dataType)
+{
+	long double pixelSum;
+	double average, stdev;
+	oldChannelStats (data, w * h, pixelSum, average, stdev);
+
+	long sizes[2] = {w, h};
+	rts2image::Channels chs;
+	chs.push_back (new rts2image::Channel (0, (char *) data, 2, sizes, dataType, false));
+	chs.push_back (new rts2image::Channel (1, (char *) data, 2, sizes, dataType, false));
+
+	for (int threads = 1; threads <= 8; threads *= 2)
+	{
+		rts2image::Channels::setStatisticsThreads (threads);
+		chs.computeStatistics ();
+		for (rts2image::Channels::iterator iter = chs.begin (); iter != chs.end (); iter++)
+		{
+			ck_assert_dbl_eq ((double) (*iter)->getPixelSum (), (double) pixelSum, fabs (pixelSum) * 1e-12);
+			ck_assert_dbl_eq ((*iter)->getAverage (), average, fabs (average) * 1e-12);
+			ck_assert_dbl_eq ((*iter)->getStDev (), stdev, stdev * 1e-10);
+		}
+		chs[0]->computeStatistics ();
+		ck_assert_dbl_eq (chs[0]->getStDev (), stdev, stdev * 1e-10);
+	}
+	rts2image::Channels::setStatisticsThreads (0);
+}
+
+START_TEST(CHANNEL_STATS)
+{
+	// larger than one statistics part, so frames are split between threads
+	long w = 1500, h = 1100;
+	uint16_t *u = new uint16_t[w * h];
+	for (long i = 0; i < w * h; i++)
+		u[i] = random () % 65536;
+	compareChannelStats (u, w, h, RTS2_DATA_USHORT);
+
+	// high bias with small noise, sum of squares looses precision
+	for (long i = 0; i < w * h; i++)
+		u[i] = 60000 + random () % 20;
+	compareChannelStats (u, w, h, RTS2_DATA_USHORT);
+	delete[] u;
+
+	float *f = new float[w * h];
+	for (long i = 0; i < w * h; i++)
+		f[i] = 1000 + (random () % 200000) / 100.0;
+	compareChannelStats (f, w, h, RTS2_DATA_FLOAT);
+	delete[] f;
+}
+END_TEST
+
+START_TEST(STATS_16)
+{
+	uint16_t *u = new uint16_t[NPIX];
+	for (int i = 0; i < NPIX; i++)
+		u[i] = random () % 65536;
+	u[17] = 0;
+	u[NPIX - 1] = 65535;
+	for (size_t n = 0; n < 40; n++)
+		compareStats (u, n);
+	compareStats (u, NPIX);
+	compareStats (u + 3, NPIX - 3);
+
+	int16_t *s = (int16_t *) u;
+	compareStats (s, NPIX);
+	compareStats (s + 1, 33);
+
+	// exact sums
+	for (int i = 0; i < NPIX; i++)
+		u[i] = 65535;
+	PixelStats ps;
+	pixelStats (u, NPIX, ps);
+	ck_assert (ps.sum == 65535.0 * NPIX);
+	ck_assert (ps.sum2 == 65535.0 * 65535.0 * NPIX);
+	ck_assert_dbl_eq (ps.getStdev (), 0.0, 10e-10);
+
+	delete[] u;
+}
+END_TEST
+
+START_TEST(STATS_OTHER)
+{
+	float *f = new float[NPIX];
+	for (int i = 0; i < NPIX; i++)
+		f[i] = (random () % 200000) / 10.0 - 10000;
+	compareStats (f, NPIX);
+	compareStats (f + 1, 13);
+	// NaNs are ignored for min and max
+	f[0] = NAN;
+	PixelStats ps;
+	pixelStats (f, 13, ps);
+	pixelStats (f, 1, ps);
+	ck_assert (isnan (ps.sum));
+	ck_assert (!isnan (ps.min));
+	ck_assert_int_eq (ps.n, 14);
+
+	int32_t *l = (int32_t *) f;
+	compareStats (l + 1, NPIX - 1);
+	uint8_t *b = (uint8_t *) f;
+	compareStats (b, NPIX);
+
+	delete[] f;
+}
+END_TEST
+
+START_TEST(THRESHOLD)
+{
+	uint16_t row[1003];
+	for (int i = 0; i < 1003; i++)
+		row[i] = random () % 65536;
+	compareThreshold (row, 1003, 30000);
+	compareThreshold (row, 1003, 30000.5);
+	compareThreshold (row, 1003, 0);
+	compareThreshold (row, 1003, -10);
+	compareThreshold (row, 1003, 65535);
+	compareThreshold (row, 1003, 70000);
+	compareThreshold (row, 1003, NAN);
+	compareThreshold (row + 1, 7, 10);
+
+	int16_t *srow = (int16_t *) row;
+	compareThreshold (srow, 1003, -100);
+}
+END_TEST
+
+Suite * pixelstats_suite (void)
+{
+	Suite *s;
+	TCase *tc_pixelstats;
+
+	s = suite_create ("PixelStats");
+	tc_pixelstats = tcase_create ("SIMD kernels match scalar code");
+
+	tcase_add_test (tc_pixelstats, STATS_16);
+	tcase_add_test (tc_pixelstats, STATS_OTHER);
+	tcase_add_test (tc_pixelstats, THRESHOLD);
+	tcase_add_test (tc_pixelstats, CHANNEL_STATS);
+	suite_add_tcase (s, tc_pixelstats);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = pixelstats_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+#include "skypixel.h"
+
+#include <algorithm>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+#include <check.h>
+#include <check_utils.h>
+
+static std::vector <int> cone (double ra, double dec, double radius)
+{
+	std::vector <int> pix (skypix_cone (ra, dec, radius, NULL));
+	skypix_cone (ra, dec, radius, &(pix[0]));
+	return pix;
+}
+
+static bool contains (std::vector <int> &pix, int p)
+{
+	return std::find (pix.begin (), pix.end (), p) != pix.end ();
+}
+
+// random point at given distance from the center
+static void offset (double ra, double dec, double dist, double pa, double &o_ra, double &o_dec)
+{
+	double d = dist * M_PI / 180.0;
+	double r = ra * M_PI / 180.0;
+	double de = dec * M_PI / 180.0;
+	double sd = sin (de) * cos (d) + cos (de) * sin (d) * cos (pa);
+	o_dec = asin (sd) * 180.0 / M_PI;
+	o_ra = (r + atan2 (sin (pa) * sin (d) * cos (de), cos (d) - sin (de) * sd)) * 180.0 / M_PI;
+}
+
+START_TEST(PIXELS)
+{
+	int total = skypix_count ();
+	// sphere is 41253 square degrees, pixels are about 0.25 square degree
+	ck_assert (total > 150000 && total < 170000);
+
+	ck_assert_int_eq (skypix_pixel (0, -90), 0);
+	ck_assert_int_eq (skypix_pixel (359.999, 90), total - 1);
+
+	// RA wraps around
+	ck_assert_int_eq (skypix_pixel (360, 10), skypix_pixel (0, 10));
+	ck_assert_int_eq (skypix_pixel (-0.1, 10), skypix_pixel (359.9, 10));
+
+	for (int i = 0; i < 10000; i++)
+	{
+		int p = skypix_pixel (random () * 360.0 / RAND_MAX, random () * 180.0 / RAND_MAX - 90);
+		ck_assert (p >= 0 && p < total);
+	}
+
+	ck_assert_dbl_eq (skypix_separation (10, 20, 10, 21), 1.0, 10e-10);
+	ck_assert_dbl_eq (skypix_separation (359.5, 0, 0.5, 0), 1.0, 10e-10);
+	ck_assert_dbl_eq (skypix_separation (0, 89, 180, 89), 2.0, 10e-10);
+}
+END_TEST
+
+START_TEST(CONE)
+{
+	// small cone is covered by a few pixels
+	std::vector <int> pix = cone (100, 20, 0.1);
+	ck_assert (pix.size () <= 4);
+	ck_assert (contains (pix, skypix_pixel (100, 20)));
+
+	// RA wraps around, pixels on both sides of 0 must be covered
+	pix = cone (0.1, 0, 0.3);
+	ck_assert (contains (pix, skypix_pixel (359.9, 0)));
+	ck_assert (contains (pix, skypix_pixel (0.3, 0)));
+
+	// cone containing pole covers whole polar zones
+	pix = cone (10, 89.8, 0.5);
+	ck_assert (contains (pix, skypix_pixel (190, 89.8)));
+	ck_assert (contains (pix, skypix_pixel (100, 89.6)));
+
+	// every point inside the cone must be in a covering pixel
+	for (int i = 0; i < 2000; i++)
+	{
+		double ra = random () * 360.0 / RAND_MAX;
+		double dec = random () * 180.0 / RAND_MAX - 90;
+		double radius = random () * SKYPIX_MAX_RADIUS / RAND_MAX;
+		pix = cone (ra, dec, radius);
+		// no pixel is listed twice
+		std::vector <int> sorted (pix);
+		std::sort (sorted.begin (), sorted.end ());
+		ck_assert (std::adjacent_find (sorted.begin (), sorted.end ()) == sorted.end ());
+		for (int j = 0; j < 50; j++)
+		{
+			double o_ra, o_dec;
+			offset (ra, dec, radius * random () / RAND_MAX, 2 * M_PI * random () / RAND_MAX, o_ra, o_dec);
+			ck_assert (contains (pix, skypix_pixel (o_ra, o_dec)));
+		}
+		// points on the cone border
+		for (int j = 0; j < 16; j++)
+		{
+			double o_ra, o_dec;
+			offset (ra, dec, radius * 0.999999, j * M_PI / 8, o_ra, o_dec);
+			ck_assert (contains (pix, skypix_pixel (o_ra, o_dec)));
+		}
+	}
+}
+END_TEST
+
+Suite * skypixel_suite (void)
+{
+	Suite *s;
+	TCase *tc_skypixel;
+
+	s = suite_create ("SkyPixel");
+	tc_skypixel = tcase_create ("Sky partitioning for cone searches");
+
+	tcase_add_test (tc_skypixel, PIXELS);
+	tcase_add_test (tc_skypixel, CONE);
+	suite_add_tcase (s, tc_skypixel);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = skypixel_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
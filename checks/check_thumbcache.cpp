@@ -0,0 +1,197 @@
+#include "thumbcache.h"
+#include "utilsfunc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <check.h>
+#include <check_utils.h>
+
+using namespace rts2core;
+
+char cachedir[] = "/tmp/rts2-check-thumbcache-XXXXXX";
+
+void setup_thumbcache (void)
+{
+	ck_assert (mkdtemp (cachedir) != NULL);
+}
+
+void teardown_thumbcache (void)
+{
+	rmdir_r (cachedir);
+	strcpy (cachedir, "/tmp/rts2-check-thumbcache-XXXXXX");
+}
+
+static std::string readFd (int fd, size_t length)
+{
+	char buf[length];
+	ck_assert_int_eq (read (fd, buf, length), length);
+	close (fd);
+	return std::string (buf, length);
+}
+
+START_TEST(PUT_GET)
+{
+	ThumbnailCache tc (cachedir, 1000);
+	ck_assert_int_eq (tc.init (), 0);
+
+	size_t length;
+	ck_assert_int_eq (tc.get ("a", length), -1);
+	ck_assert_int_eq (tc.getMisses (), 1);
+
+	ck_assert_int_eq (tc.put ("a", "first", 5), 0);
+	ck_assert_int_eq (tc.put ("b", "second", 6), 0);
+	ck_assert_int_eq (tc.getSize (), 11);
+
+	int fd = tc.get ("a", length);
+	ck_assert (fd >= 0);
+	ck_assert_int_eq (length, 5);
+	ck_assert (readFd (fd, length) == "first");
+
+	// replace data
+	ck_assert_int_eq (tc.put ("a", "1", 1), 0);
+	ck_assert_int_eq (tc.getSize (), 7);
+	fd = tc.get ("a", length);
+	ck_assert (readFd (fd, length) == "1");
+
+	ck_assert_int_eq (tc.getHits (), 2);
+	ck_assert_int_eq (tc.getEntries (), 2);
+}
+END_TEST
+
+START_TEST(EVICT)
+{
+	ThumbnailCache tc (cachedir, 30);
+	ck_assert_int_eq (tc.init (), 0);
+
+	ck_assert_int_eq (tc.put ("a", "0123456789", 10), 0);
+	ck_assert_int_eq (tc.put ("b", "0123456789", 10), 0);
+	ck_assert_int_eq (tc.put ("c", "0123456789", 10), 0);
+
+	// a becomes most recently used
+	size_t length;
+	close (tc.get ("a", length));
+
+	ck_assert_int_eq (tc.put ("d", "0123456789", 10), 0);
+	ck_assert_int_eq (tc.getSize (), 30);
+	ck_assert_int_eq (tc.get ("b", length), -1);
+
+	int fd = tc.get ("a", length);
+	ck_assert (fd >= 0);
+	close (fd);
+
+	tc.setBudget (10);
+	ck_assert_int_eq (tc.getEntries (), 1);
+	ck_assert_int_eq (tc.get ("c", length), -1);
+	ck_assert_int_eq (tc.get ("d", length), -1);
+	fd = tc.get ("a", length);
+	ck_assert (fd >= 0);
+	close (fd);
+}
+END_TEST
+
+START_TEST(SHARED)
+{
+	ThumbnailCache tc1 (cachedir, 1000);
+	ck_assert_int_eq (tc1.init (), 0);
+	ck_assert_int_eq (tc1.put ("a", "0123456789", 10), 0);
+
+	// file stored by other process is found
+	ThumbnailCache tc2 (cachedir, 1000);
+	ck_assert_int_eq (tc2.init (), 0);
+	ck_assert_int_eq (tc2.getEntries (), 1);
+	ck_assert_int_eq (tc1.put ("b", "01234", 5), 0);
+
+	size_t length;
+	int fd = tc2.get ("b", length);
+	ck_assert (fd >= 0);
+	ck_assert (readFd (fd, length) == "01234");
+	ck_assert_int_eq (tc2.getSize (), 15);
+
+	// file removed by other process
+	tc1.setBudget (0);
+	ck_assert_int_eq (tc2.get ("a", length), -1);
+	ck_assert_int_eq (tc2.getEntries (), 1);
+}
+END_TEST
+
+START_TEST(DIRECTORY)
+{
+	std::string d2 = std::string (cachedir) + "/other/";
+	ThumbnailCache tc (cachedir, 1000);
+	ck_assert_int_eq (tc.init (), 0);
+	ck_assert_int_eq (tc.put ("a", "0123456789", 10), 0);
+
+	// switch to new, empty directory
+	ck_assert_int_eq (tc.setDirectory (d2.c_str ()), 0);
+	ck_assert_int_eq (tc.getEntries (), 0);
+	ck_assert_int_eq (tc.getSize (), 0);
+	size_t length;
+	ck_assert_int_eq (tc.get ("a", length), -1);
+	ck_assert_int_eq (tc.put ("b", "01234", 5), 0);
+
+	// switch back, files in the original directory are found
+	ck_assert_int_eq (tc.setDirectory (cachedir), 0);
+	ck_assert_int_eq (tc.getEntries (), 1);
+	ck_assert_int_eq (tc.getSize (), 10);
+	int fd = tc.get ("a", length);
+	ck_assert (fd >= 0);
+	close (fd);
+}
+END_TEST
+
+START_TEST(KEY)
+{
+	struct stat st;
+	memset (&st, 0, sizeof (st));
+	st.st_ino = 10;
+	st.st_mtime = 1000;
+	st.st_size = 2000;
+
+	std::string k1 = ThumbnailCache::makeKey (st, 128, "%Y @OBJECT", 0.005, 0, 0);
+	ck_assert (k1 == ThumbnailCache::makeKey (st, 128, "%Y @OBJECT", 0.005, 0, 0));
+	ck_assert (k1 != ThumbnailCache::makeKey (st, 256, "%Y @OBJECT", 0.005, 0, 0));
+	ck_assert (k1 != ThumbnailCache::makeKey (st, 128, "%Y", 0.005, 0, 0));
+	ck_assert (k1 != ThumbnailCache::makeKey (st, 128, "%Y @OBJECT", 0.01, 0, 0));
+	ck_assert (k1 != ThumbnailCache::makeKey (st, 128, "%Y @OBJECT", 0.005, 1, 0));
+	ck_assert (k1 != ThumbnailCache::makeKey (st, 128, "%Y @OBJECT", 0.005, 0, 1));
+
+	// modified file
+	st.st_mtime++;
+	ck_assert (k1 != ThumbnailCache::makeKey (st, 128, "%Y @OBJECT", 0.005, 0, 0));
+}
+END_TEST
+
+Suite * thumbcache_suite (void)
+{
+	Suite *s;
+	TCase *tc_thumbcache;
+
+	s = suite_create ("ThumbnailCache");
+	tc_thumbcache = tcase_create ("Thumbnail cache operations");
+
+	tcase_add_checked_fixture (tc_thumbcache, setup_thumbcache, teardown_thumbcache);
+	tcase_add_test (tc_thumbcache, PUT_GET);
+	tcase_add_test (tc_thumbcache, EVICT);
+	tcase_add_test (tc_thumbcache, SHARED);
+	tcase_add_test (tc_thumbcache, DIRECTORY);
+	tcase_add_test (tc_thumbcache, KEY);
+	suite_add_tcase (s, tc_thumbcache);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = thumbcache_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+#include "timerqueue.h"
+
+#include <stdlib.h>
+#include <check.h>
+#include <check_utils.h>
+
+using namespace rts2core;
+
+TimerQueue *tq;
+
+void setup_timerqueue (void)
+{
+	tq = new TimerQueue ();
+}
+
+void teardown_timerqueue (void)
+{
+	delete tq;
+}
+
+START_TEST(ORDER)
+{
+	double scheduled;
+	tq->add (30, new Event (3));
+	tq->add (10, new Event (1));
+	tq->add (20, new Event (2));
+	tq->add (10, new Event (4));
+
+	ck_assert_int_eq (tq->size (), 4);
+	ck_assert_dbl_eq (tq->nextTime (), 10.0, 10e-10);
+
+	ck_assert (tq->popDue (5, scheduled) == NULL);
+
+	Event *ev = tq->popDue (100, scheduled);
+	ck_assert_int_eq (ev->getType (), 1);
+	ck_assert_dbl_eq (scheduled, 10.0, 10e-10);
+	delete ev;
+
+	// events with the same time are triggered in order they were added
+	ev = tq->popDue (100, scheduled);
+	ck_assert_int_eq (ev->getType (), 4);
+	delete ev;
+
+	ev = tq->popDue (100, scheduled);
+	ck_assert_int_eq (ev->getType (), 2);
+	delete ev;
+
+	// timer is triggered only when its time passed
+	ck_assert (tq->popDue (30, scheduled) == NULL);
+
+	ev = tq->popDue (30.1, scheduled);
+	ck_assert_int_eq (ev->getType (), 3);
+	delete ev;
+
+	ck_assert (tq->empty ());
+}
+END_TEST
+
+START_TEST(CANCEL)
+{
+	double scheduled;
+	timer_id_t t1 = tq->add (10, new Event (1));
+	timer_id_t t2 = tq->add (20, new Event (2));
+	tq->add (30, new Event (3));
+
+	ck_assert (tq->cancel (t1));
+	ck_assert (tq->cancel (t1) == false);
+	ck_assert_dbl_eq (tq->nextTime (), 20.0, 10e-10);
+
+	ck_assert (tq->cancel (t2));
+	ck_assert_int_eq (tq->size (), 1);
+
+	Event *ev = tq->popDue (100, scheduled);
+	ck_assert_int_eq (ev->getType (), 3);
+	delete ev;
+
+	ck_assert (tq->popDue (100, scheduled) == NULL);
+}
+END_TEST
+
+START_TEST(CANCEL_TYPE)
+{
+	double scheduled;
+	for (int i = 0; i < 100; i++)
+		tq->add (100 - i, new Event (i % 3));
+
+	ck_assert_int_eq (tq->cancelType (1), 33);
+	ck_assert_int_eq (tq->cancelType (1), 0);
+	ck_assert_int_eq (tq->size (), 67);
+
+	double last = 0;
+	Event *ev;
+	while ((ev = tq->popDue (1000, scheduled)) != NULL)
+	{
+		ck_assert (ev->getType () != 1);
+		ck_assert (scheduled >= last);
+		last = scheduled;
+		delete ev;
+	}
+
+	ck_assert (tq->empty ());
+}
+END_TEST
+
+Suite * timerqueue_suite (void)
+{
+	Suite *s;
+	TCase *tc_timerqueue;
+
+	s = suite_create ("TimerQueue");
+	tc_timerqueue = tcase_create ("Timer queue operations");
+
+	tcase_add_checked_fixture (tc_timerqueue, setup_timerqueue, teardown_timerqueue);
+	tcase_add_test (tc_timerqueue, ORDER);
+	tcase_add_test (tc_timerqueue, CANCEL);
+	tcase_add_test (tc_timerqueue, CANCEL_TYPE);
+	suite_add_tcase (s, tc_timerqueue);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = timerqueue_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
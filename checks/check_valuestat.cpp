@@ -0,0 +1,160 @@
+#include "valuestat.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <check.h>
+#include <check_utils.h>
+
+using namespace rts2core;
+
+// statistics calculated as ValueDoubleStat::calculate used to calculate them
+static void naiveStat (std::deque <double> values, double &mean, double &mode, double &min, double &max, double &stdev)
+{
+	std::sort (values.begin (), values.end ());
+	min = values.front ();
+	max = values.back ();
+	int n = values.size ();
+	double sum = 0;
+	for (std::deque <double>::iterator iter = values.begin (); iter != values.end (); iter++)
+		sum += *iter;
+	mean = sum / n;
+	stdev = 0;
+	for (std::deque <double>::iterator iter = values.begin (); iter != values.end (); iter++)
+		stdev += (*iter - mean) * (*iter - mean);
+	stdev = sqrt (stdev / n);
+	if ((n % 2) == 1)
+		mode = values[n / 2];
+	else
+		mode = (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+static void checkStat (ValueDoubleStat &stat, std::deque <double> &values)
+{
+	double mean, mode, min, max, stdev;
+	naiveStat (values, mean, mode, min, max, stdev);
+	stat.calculate ();
+	ck_assert_int_eq (stat.getNumMes (), values.size ());
+	ck_assert_dbl_eq (stat.getValueDouble (), mean, 10e-8);
+	ck_assert_dbl_eq (stat.getMode (), mode, 10e-10);
+	ck_assert_dbl_eq (stat.getMin (), min, 10e-10);
+	ck_assert_dbl_eq (stat.getMax (), max, 10e-10);
+	ck_assert_dbl_eq (stat.getStdev (), stdev, 10e-8);
+}
+
+START_TEST(SIMPLE)
+{
+	ValueDoubleStat stat ("test", "test value", false);
+	ck_assert_int_eq (stat.getNumMes (), 0);
+	ck_assert (isnan (stat.getMode ()));
+
+	stat.addValue (3);
+	stat.addValue (1);
+	stat.addValue (2);
+	stat.calculate ();
+	ck_assert_int_eq (stat.getNumMes (), 3);
+	ck_assert_dbl_eq (stat.getValueDouble (), 2.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMode (), 2.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMin (), 1.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMax (), 3.0, 10e-10);
+	ck_assert_dbl_eq (stat.getStdev (), sqrt (2 / 3.0), 10e-10);
+
+	// window of 3 values - removes 3
+	stat.addValue (10, 3);
+	stat.calculate ();
+	ck_assert_int_eq (stat.getNumMes (), 3);
+	ck_assert_dbl_eq (stat.getValueDouble (), 13 / 3.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMode (), 2.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMin (), 1.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMax (), 10.0, 10e-10);
+
+	// window of 2 values - removes 1 and 2
+	stat.addValue (4, 2);
+	stat.calculate ();
+	ck_assert_int_eq (stat.getNumMes (), 2);
+	ck_assert_dbl_eq (stat.getMode (), 7.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMin (), 4.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMax (), 10.0, 10e-10);
+	ck_assert_dbl_eq (stat.getStdev (), 3.0, 10e-10);
+
+	stat.clearStat ();
+	ck_assert_int_eq (stat.getNumMes (), 0);
+	ck_assert_int_eq (stat.getMesList ().size (), 0);
+
+	stat.addValue (5, 10);
+	stat.calculate ();
+	ck_assert_int_eq (stat.getNumMes (), 1);
+	ck_assert_dbl_eq (stat.getMode (), 5.0, 10e-10);
+	ck_assert_dbl_eq (stat.getStdev (), 0.0, 10e-10);
+
+	// NaN values are ignored
+	stat.addValue (NAN, 10);
+	stat.addValue (7, 2);
+	stat.addValue (NAN);
+	stat.addValue (6, 2);
+	stat.calculate ();
+	ck_assert_int_eq (stat.getNumMes (), 2);
+	ck_assert_dbl_eq (stat.getValueDouble (), 6.5, 10e-10);
+	ck_assert_dbl_eq (stat.getMin (), 6.0, 10e-10);
+	ck_assert_dbl_eq (stat.getMax (), 7.0, 10e-10);
+}
+END_TEST
+
+START_TEST(ROLLING)
+{
+	ValueDoubleStat stat ("test", "test value", false);
+	std::deque <double> values;
+
+	srandom (1);
+
+	// tracking frequency like values, with duplicates
+	for (int i = 0; i < 2000; i++)
+	{
+		size_t window = (i < 1000) ? 50 : 7;
+		double v = 10000 + (random () % 200) / 10.0;
+		while (values.size () >= window)
+			values.pop_front ();
+		values.push_back (v);
+		stat.addValue (v, window);
+		checkStat (stat, values);
+	}
+
+	// copy of the value
+	ValueDoubleStat copy ("copy", "copy of test value", false);
+	copy.setFromValue (&stat);
+	copy.addValue (10005, 7);
+	values.pop_front ();
+	values.push_back (10005);
+	checkStat (copy, values);
+}
+END_TEST
+
+Suite * valuestat_suite (void)
+{
+	Suite *s;
+	TCase *tc_stat;
+
+	s = suite_create ("ValueDoubleStat");
+	tc_stat = tcase_create ("Rolling statistics");
+
+	tcase_add_test (tc_stat, SIMPLE);
+	tcase_add_test (tc_stat, ROLLING);
+	suite_add_tcase (s, tc_stat);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = valuestat_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
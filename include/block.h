@@ -41,8 +41,13 @@
 #include <sys/inotify.h>
 #endif
 
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #include "event.h"
 #include "object.h"
+#include "timerqueue.h"
 #include "connection.h"
 #include "networkaddress.h"
 #include "connuser.h"
@@ -650,19 +655,41 @@ class Block: public App
 		 * @param timer_time  Timer time in seconds, counted from now.
 		 * @param event       Event which will be posted for triger. Event argument
 		 *
+		 * @return handle of the timer, which can be used to remove the timer with deleteTimer
+		 *
 		 * @see Event
 		 */
-		void addTimer (double timer_time, Event *event)
+		timer_id_t addTimer (double timer_time, Event *event)
 		{
-			timers[getNow () + timer_time] = event;
+			return timers.add (getNow () + timer_time, event);
 		}
 
+		/**
+		 * Remove timer with a given handle.
+		 *
+		 * @param id  timer handle, as returned from addTimer
+		 *
+		 * @return true if timer was pending and was removed
+		 */
+		bool deleteTimer (timer_id_t id) { return timers.cancel (id); }
+
 		/**
 		 * Remove timer with a given type from the list of timers.
 		 *
 		 * @param event_type Type of event.
 		 */
-		void deleteTimers (int event_type);
+		void deleteTimers (int event_type) { timers.cancelType (event_type); }
+
+		/**
+		 * Returns timer lateness statistics - how late (in seconds)
+		 * timers were triggered - and reset statistics.
+		 *
+		 * @param avg  average lateness, NAN if no timer was triggered since last call
+		 * @param max  maximal lateness, NAN if no timer was triggered since last call
+		 *
+		 * @return number of timers triggered since last call
+		 */
+		int getTimersLateness (double &avg, double &max);
 
 		/**
 		 * Updates metainformation about given value.
@@ -687,9 +714,32 @@ class Block: public App
 		void addPollFD (int fd, short events);
 
 		/**
-		 * Returns events associated with the given descriptor.
+		 * Returns events associated with the given descriptor. Descriptors
+		 * are indexed, so the lookup does not depend on number of
+		 * descriptors added with addPollFD.
+		 */
+		short getPollEvents (int fd)
+		{
+			if (fd < 0 || (size_t) fd >= pollIndex.size () || pollIndex[fd] == 0)
+				return 0;
+			return fds[pollIndex[fd] - 1].revents;
+		}
+
+		/**
+		 * Notify block that file descriptor, which was added to the
+		 * block poll with addPollFD, was closed. Must be called by code
+		 * which can close and reopen descriptor (possibly getting the
+		 * same descriptor number) in the same run loop iteration, as
+		 * epoll does not track descriptor numbers, but open files.
+		 *
+		 * @param fd  closed file descriptor
+		 */
+		void pollFDClosed (int fd);
+
+		/**
+		 * Returns true if epoll is used to wait for file descriptors events.
 		 */
-		short getPollEvents (int fd);
+		bool usesEpoll () { return useEpoll; }
 
 		/**
 		 * Returns true, if some data awaits on the file descriptor.
@@ -707,6 +757,7 @@ class Block: public App
 		bool isForWrite (int fd) { return getPollEvents (fd) & POLLOUT; }
 
 	protected:
+		virtual int processOption (int in_opt);
 
 		virtual Connection *createClientConnection (NetworkAddress * in_addr) = 0;
 
@@ -810,8 +861,47 @@ class Block: public App
 		nfds_t pollsize;
 		nfds_t npolls;
 
+		// index of file descriptors in fds array, shifted by 1 (0 marks descriptor not present)
+		std::vector <nfds_t> pollIndex;
+
+		bool useEpoll;
+
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+		int epfd;
+		// events registered with epfd, indexed by file descriptor
+		std::vector <uint32_t> epollRegistered;
+		// events requested in current loop, indexed by file descriptor
+		std::vector <uint32_t> epollRequested;
+		// descriptors registered with epfd
+		std::vector <int> epollFds;
+		std::vector <struct epoll_event> epollReady;
+
+		/**
+		 * Synchronize epoll interest list with descriptors added by
+		 * addPollSocks, wait for events and fill revents of fds array.
+		 *
+		 * @return -2 if epoll cannot be used for registered descriptors, otherwise epoll_wait return value
+		 */
+		int epollWait (const struct timespec *read_tout);
+#endif
+
+		/**
+		 * Clear descriptors (and their index) added for the poll call.
+		 */
+		void clearPollFDs ();
+
+		/**
+		 * Wait for events on registered file descriptors, either with ppoll or epoll.
+		 */
+		int waitPollFDs (const struct timespec *read_tout);
+
 		// timers - time when they should be executed, event which should be triggered
-		std::map <double, Event*> timers;
+		TimerQueue timers;
+
+		// timers lateness statistics
+		int timersTriggered;
+		double timersLatenessSum;
+		double timersLatenessMax;
 
 		connections_t connections;
 		
@@ -820,9 +910,6 @@ class Block: public App
 
 		connections_t centraldConns;
 
-		// entries to delete from timers map; delete will happen in idle call
-		std::vector <std::map <double, Event *>::iterator> toDelete;
-
 		// vector which holds connections which were recently added - idle loop will move them to connections
 		connections_t centraldConns_added;
 
@@ -838,12 +925,6 @@ class Block: public App
 		 * @param err error bits to set
 		 */
 		void valueMaskError (Value *val, int32_t err);
-
-		/**
-                 *
-                 * @return true if timer entry was deleted, false if it was already found in vector to delete.
-		 */
-		bool pushToDelete (const std::map <double, Event *>::iterator &iter);
 };
 
 }
@@ -860,4 +941,9 @@ void getMasterAddPollFD (int fd, short events);
 
 short getMasterGetEvents (int fd);
 
+/**
+ * Tells master block that descriptor will be closed, so it is removed from epoll set.
+ */
+void getMasterPollFDClosed (int fd);
+
 #endif							 // !__RTS2_NETBLOCK__
@@ -25,6 +25,8 @@
 
 #include "scriptdevice.h"
 #include "imghdr.h"
+#include "histogram.h"
+#include "pixelstats.h"
 
 #define MAX_CHIPS  3
 #define MAX_DATA_RETRY 100
@@ -1041,15 +1043,28 @@ class Camera:public rts2core::ScriptDevice
 		// whenewer statistics should be calculated
 		rts2core::ValueSelection *calculateStatistics;
 
+		// maximal number of image bytes written to client in one loop iteration
+		rts2core::ValueLong *dataBudget;
+
 		// image parameters
 		rts2core::ValueDouble *average;
 		rts2core::ValueDouble *min;
 		rts2core::ValueDouble *max;
 		rts2core::ValueDouble *sum;
 		rts2core::ValueDouble *image_mode;
+		rts2core::ValueDouble *image_median;
+		rts2core::ValueDouble *stdev;
+
+		// sum of squares of pixels readed out
+		double sumSquares;
 
-		uint32_t *modeCount;
-		long long unsigned int modeCountSize;
+		// quantiles to calculate, and their values
+		rts2core::DoubleArray *quantiles;
+		rts2core::DoubleArray *image_quantiles;
+
+		// histogram for mode and quantiles
+		rts2core::ValueInteger *histogramBins;
+		rts2core::Histogram histogram;
 
 		rts2core::ValueLong *computedPix;
 
@@ -1091,35 +1106,17 @@ class Camera:public rts2core::ScriptDevice
 		// update statistics
 		template <typename t> int updateStatistics (t *data, size_t dataSize)
 		{
-			long double tSum = 0;
-			double tMin = min->getValueDouble ();
-			double tMax = max->getValueDouble ();
-			int pixNum = 0;
-			t *tData = data;
-			if (modeCountSize < (((long long unsigned int) 1) << (sizeof (t) * 8)))
-			{
-				delete[] modeCount;
-				modeCountSize = ((long long unsigned int) 1) << (sizeof (t) * 8);
-				modeCount = new uint32_t[modeCountSize];
-				memset (modeCount, 0, modeCountSize * sizeof (uint32_t));
-			}
-			while (((char *) tData) < ((char *) data) + dataSize)
-			{
-				t tD = *tData;
-				tSum += tD;
-				if (tD < tMin)
-					tMin = tD;
-				if (tD > tMax)
-				  	tMax = tD;
-				modeCount[(long) tD]++;
-				tData++;
-				pixNum++;
-			}
-			sum->setValueDouble (sum->getValueDouble () + tSum);
-			if (tMin < min->getValueDouble ())
-				min->setValueDouble (tMin);
-			if (tMax > max->getValueDouble ())
-				max->setValueDouble (tMax);
+			size_t pixNum = dataSize / sizeof (t);
+			rts2core::PixelStats ps;
+			rts2core::pixelStats (data, pixNum, ps);
+			if (pixNum > 0 && calculateStatistics->getValueInteger () == STATISTIC_YES)
+				histogram.add (data, pixNum, ps.min, ps.max);
+			sum->setValueDouble (sum->getValueDouble () + ps.sum);
+			sumSquares += ps.sum2;
+			if (ps.min < min->getValueDouble ())
+				min->setValueDouble (ps.min);
+			if (ps.max > max->getValueDouble ())
+				max->setValueDouble (ps.max);
 			return pixNum;
 		}
 
@@ -1162,20 +1159,12 @@ class Camera:public rts2core::ScriptDevice
 
 			sumsY->clear ();
 
-			for (int row = 0; row < h; row++)
+			for (int row = 0; row < h; row++, tData += getUsedWidthBinned ())
 			{
-				double rs = 0;
-				for (int col = 0; col < w; col++, tData++)
-				{
-					if (*tData >= centerCutLevel->getValueDouble ())
-					{
-						sx[col] += *tData;
-						rs += *tData;
-						center_npix++;
-						if (isnan (center_max) || *tData > center_max)
-							center_max = *tData;
-					}
-				}
+				double rs, rmax;
+				rts2core::thresholdRow (tData, w, centerCutLevel->getValueDouble (), sx, rs, center_npix, rmax);
+				if (isnan (center_max) || rmax > center_max)
+					center_max = rmax;
 
 				sumsY->addValue (rs);
 				center_avg += rs;
@@ -302,6 +302,14 @@ class Configuration:public IniParser
 		 */
 		std::string observatoryDarkPath () { return obs_darks; }
 
+		/**
+		 * Returns maximal number of images written outside of the main
+		 * loop. If 0, images are written synchronously.
+		 *
+		 * @return observatory/write_queue entry in config file
+		 */
+		int getWriteQueue () { return writeQueue; }
+
 		/**
 		 * Return replacing string for an observatory.
 		 *
@@ -375,6 +383,7 @@ class Configuration:public IniParser
 		bool storeSexadecimals;
 		ObjectCheck *checker;
 		int astrometryTimeout;
+		int writeQueue;
 		double minFlatHeigh;
 		double calibrationAirmassDistance;
 		double calibrationLunarDist;
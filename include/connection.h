@@ -44,6 +44,31 @@
 
 #define MAX_DATA    2000
 
+/**
+ * Size of output buffer, after which connection will try to write buffered data immediately.
+ */
+#define WRITE_BUFFER_FLUSH       65536
+
+/**
+ * Maximal size of data buffered for connection. If the other side does not
+ * read data and buffer grows above this size, connection is closed.
+ */
+#define WRITE_BUFFER_MAX         (16 * 1024 * 1024)
+
+/**
+ * Size of binary data queued for connection above which data producer
+ * should wait. Camera does not read new data from the chip while more data
+ * are waiting for the other side.
+ */
+#define WRITE_BUFFER_BINARY_MAX  (256 * 1024 * 1024)
+
+/**
+ * Maximal size of binary data block moved from queued binary data to the
+ * output buffer. Messages are thus not waiting for the whole image to be
+ * sent.
+ */
+#define WRITE_BUFFER_BINARY_BLOCK  (1024 * 1024)
+
 /**
  * Identifier of shared data connection.
  */
@@ -225,7 +250,10 @@ class Connection:public Object
 		inline int isCommand (const char *cmd) { return !strcmp (cmd, getCommand ()); }
 
 		/**
-		 * Send char message to other side.
+		 * Send char message to other side. Message is appended to
+		 * connection output buffer, which is written to the socket
+		 * before next poll call, or when the socket becomes writable.
+		 * Messages are thus coalesced to a single write call.
 		 *
 		 * @return -1 on error, 0 on sucess
 		 */
@@ -233,6 +261,40 @@ class Connection:public Object
 		int sendMsg (std::string msg);
 		int sendMsg (std::ostringstream &_os);
 
+		/**
+		 * Write buffered messages to the socket, without blocking. At
+		 * most write budget bytes (see setWriteBudget) are written in a
+		 * single loop iteration. Queued binary data are moved to the
+		 * output buffer as it drains.
+		 *
+		 * @return -1 on error, 0 on success (including partial write)
+		 */
+		int flushWriteBuffer ();
+
+		/**
+		 * Returns number of bytes waiting in output buffer.
+		 */
+		size_t writeBufferSize () { return writeBuffer.length () - writeBufferStart; }
+
+		/**
+		 * Set maximal number of bytes written to the connection in
+		 * a single loop iteration. Limits time spent sending large
+		 * binary data, so other connections are serviced while image is
+		 * transfered. Budget is cleared when all binary data were
+		 * written.
+		 *
+		 * @param budget  budget in bytes, 0 for unlimited
+		 */
+		void setWriteBudget (size_t budget) { writeBudget = budget; }
+
+		size_t getWriteBudget () { return writeBudget; }
+
+		/**
+		 * Called by Block at start of every loop iteration to renew
+		 * the write budget.
+		 */
+		void resetWriteBudget () { writtenInLoop = 0; }
+
 		/**
 		 * Switch connection to binary connection.
 		 *
@@ -245,7 +307,13 @@ class Connection:public Object
 		int startBinaryData (int dataType, int channum, size_t *chansize);
 
 		/**
-		 * Sends part of binary data.
+		 * Sends part of binary data. Data are copied to the data
+		 * connection queue and written from the main loop, in blocks
+		 * interleaved with other buffered messages. The data are
+		 * accounted as written (see getWriteBinaryDataSize) once they
+		 * are queued. Producer should check getBinaryQueuedSize and
+		 * wait before sending more data if the other side does not
+		 * read them.
 		 *
 		 * @param data_conn  ID of data connection
 		 * @param chan       data channel
@@ -256,6 +324,12 @@ class Connection:public Object
 
 		void endBinaryData (int data_conn);
 
+		/**
+		 * Returns number of queued binary data bytes, which were not
+		 * yet moved to the output buffer.
+		 */
+		size_t getBinaryQueuedSize () { return binaryQueued; }
+
 		/**
 		 * Image data will be transfered in shared memory, attachable by key.
 		 * Those functions are called by client. The receiving side can check in 
@@ -810,6 +884,24 @@ class Connection:public Object
 		// ID of outgoing data connection
 		int dataConn;
 
+		// buffered output; data before writeBufferStart were already written
+		std::string writeBuffer;
+		size_t writeBufferStart;
+		// end of last binary data block in writeBuffer
+		size_t writeBinaryEnd;
+		// maximal number of bytes written in one loop iteration, 0 for unlimited
+		size_t writeBudget;
+		// bytes written in the current loop iteration
+		size_t writtenInLoop;
+		// binary data queued in writeChannels
+		size_t binaryQueued;
+
+		// move queued binary data to the output buffer
+		void feedBinaryData ();
+
+		// size of buffered messages, queued binary data excluded
+		size_t writeTextSize () { return writeBuffer.length () - (writeBinaryEnd > writeBufferStart ? writeBinaryEnd : writeBufferStart); }
+
 		// connectionTimeout in seconds
 		int connectionTimeout;
 		conn_state_t conn_state;
@@ -0,0 +1,129 @@
+/*
+ * Interpolation cache of astrometric corrections.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_CORRECTIONCACHE__
+#define __RTS2_CORRECTIONCACHE__
+
+// size of position step used to calculate derivatives of corrections (in degrees)
+#define CORR_CACHE_DELTA      0.01
+
+namespace rts2teld
+{
+
+/**
+ * Cache of slowly varying astrometric corrections (precession, nutation,
+ * aberation). Corrections are calculated for a position at three nodes
+ * spanning an interval, together with their derivatives by RA and DEC.
+ * Corrections of positions close to the cached position and times inside
+ * the interval are interpolated - quadratically in time, linearly in
+ * position.
+ *
+ * Cache is filled by caller, which calculates corrected positions at nodes
+ * returned by getNodeJD, for the cached position and positions offseted by
+ * CORR_CACHE_DELTA in RA and DEC.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class CorrectionCache
+{
+	public:
+		CorrectionCache () { valid = false; }
+
+		/**
+		 * Correction and its derivatives at a node.
+		 */
+		struct Node
+		{
+			// corrections (in degrees)
+			double ra;
+			double dec;
+			// derivatives of corrections by RA and DEC
+			double ra_ra;
+			double ra_dec;
+			double dec_ra;
+			double dec_dec;
+		};
+
+		/**
+		 * Construct node from corrected positions.
+		 *
+		 * @param ra       RA of the cached position
+		 * @param dec      DEC of the cached position
+		 * @param c        corrected position [ra, dec]
+		 * @param c_ra     corrected position [ra, dec] of position offseted by CORR_CACHE_DELTA in RA
+		 * @param c_dec    corrected position [ra, dec] of position offseted by CORR_CACHE_DELTA in DEC
+		 */
+		static Node makeNode (double ra, double dec, const double c[2], const double c_ra[2], const double c_dec[2]);
+
+		/**
+		 * Returns JD of the node.
+		 *
+		 * @param JD    start of the interval
+		 * @param step  interval length in seconds
+		 * @param i     node index (0..2)
+		 */
+		static double getNodeJD (double JD, double step, int i) { return JD + i * step / 2.0 / 86400.0; }
+
+		/**
+		 * Set cached corrections.
+		 *
+		 * @param ra     cached position RA
+		 * @param dec    cached position DEC
+		 * @param JD     start of the interval
+		 * @param step   interval length in seconds
+		 * @param mask   corrections included in nodes, cache is used only for the same mask
+		 * @param nodes  nodes at times returned by getNodeJD
+		 */
+		void set (double ra, double dec, double JD, double step, int mask, const Node nodes[3]);
+
+		void invalidate () { valid = false; }
+
+		/**
+		 * Returns true if corrections of the position can be interpolated.
+		 *
+		 * @param ra      position RA
+		 * @param dec     position DEC
+		 * @param JD      Julian date
+		 * @param mask    requested corrections
+		 * @param radius  maximal distance from the cached position (in degrees)
+		 */
+		bool covers (double ra, double dec, double JD, int mask, double radius);
+
+		/**
+		 * Apply interpolated corrections. Position must be covered by the cache.
+		 */
+		void apply (double &ra, double &dec, double JD);
+
+		double getStep () { return valid ? step : 0; }
+
+	private:
+		bool valid;
+
+		double ra0;
+		double dec0;
+		double JD0;
+		double step;
+		int mask;
+
+		Node nodes[3];
+};
+
+}
+
+#endif // !__RTS2_CORRECTIONCACHE__
@@ -661,6 +661,10 @@ class Daemon:public rts2core::Block
 
 		ValueTime *info_time;
 
+		// lateness of timers triggered between info calls
+		ValueDouble *timerLateness;
+		ValueDouble *timerLatenessMax;
+
 		double idleInfoInterval;
 
 		bool doHupIdleLoop;
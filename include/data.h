@@ -22,6 +22,8 @@
 
 #include <errno.h>
 #include <unistd.h>
+#include <list>
+#include <string>
 #include <vector>
 
 // maximal number of shared clients
@@ -289,7 +291,9 @@ class DataAbstractWrite
 };
 
 /**
- * Represents data written to connection through socket.
+ * Represents data written to connection through socket. Keeps copy of data
+ * which were accepted from the caller, but were not yet passed to the
+ * connection output buffer.
  *
  * @author Petr Kubanek <petr@kubanek.net>
  */
@@ -303,10 +307,51 @@ class DataWrite:public DataAbstractWrite
 		virtual size_t getChannelSize (int chan) { return binaryWriteDataSize[chan]; }
 		virtual void dataWritten (int chan, size_t size) { binaryWriteDataSize[chan] -= size; }
 
+		/**
+		 * Queue copy of data, which will be passed to the connection later.
+		 */
+		void queueData (int chan, const char *data, size_t size);
+
+		/**
+		 * Returns first block of queued data.
+		 *
+		 * @param chan  channel of the block
+		 * @param data  pointer to block data
+		 *
+		 * @return size of the block, 0 if nothing is queued
+		 */
+		size_t getQueued (int &chan, const char *&data);
+
+		/**
+		 * Remove bytes from start of the first queued block.
+		 */
+		void queuedWritten (size_t size);
+
+		/**
+		 * Drop all queued data.
+		 */
+		void clearQueued () { queued.clear (); queuedSize = 0; }
+
+		/**
+		 * Returns number of queued bytes.
+		 */
+		size_t getQueuedSize () { return queuedSize; }
+
 	private:
 		// connection data size
 		size_t *binaryWriteDataSize;
 		int channum;
+
+		struct QueuedBlock
+		{
+			int chan;
+			std::string data;
+			// bytes of data already passed to the connection
+			size_t start;
+		};
+
+		std::list <QueuedBlock> queued;
+		size_t queuedSize;
 };
 
 /**
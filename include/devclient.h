@@ -111,6 +111,12 @@ class DevClient:public Object
 
 		virtual void valueChanged (Value * value) {}
 
+		/**
+		 * Called when metainfo (flags, description) of the value was
+		 * received. Value can be newly created.
+		 */
+		virtual void valueMetaChanged (Value * value) {}
+
 		virtual void deleteConnection (Connection *conn) {};
 
 	protected:
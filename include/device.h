@@ -28,6 +28,8 @@
 #include "command.h"
 #include "daemon.h"
 
+#include <pthread.h>
+
 namespace rts2core
 {
 
@@ -238,7 +240,11 @@ class Device:public Daemon
 		 */
 		void sendFullStateInfo (Connection * conn);
 
-		// only devices can send messages
+		/**
+		 * Send message to centrald connections. Messages from threads
+		 * other than the main loop are queued and sent from the main
+		 * loop, as connection buffers are not thread safe.
+		 */
 		virtual void sendMessage (messageType_t in_messageType, const char *in_messageString);
 
 		/**
@@ -324,6 +330,9 @@ class Device:public Daemon
 
 		virtual void beforeRun ();
 
+		virtual void addPollSocks ();
+		virtual void pollSuccess ();
+
 		virtual bool isRunning (Connection *conn) { return conn->isConnState (CONN_AUTH_OK) || requireAuthorization () == false; }
 
 		/**
@@ -442,6 +451,14 @@ class Device:public Daemon
 		CommandDeviceStatusInfo *deviceStatusCommand;
 
 		char *last_weathermsg;
+
+		// messages logged from other threads, waiting to be sent from the main loop
+		pthread_t mainThread;
+		pthread_mutex_t threadMessagesMutex;
+		std::list <std::pair <messageType_t, std::string> > threadMessages;
+		int threadMessagesPipe[2];
+
+		void sendThreadMessages ();
 };
 
 }
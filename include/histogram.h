@@ -0,0 +1,163 @@
+/*
+ * Fixed-size streaming histogram.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_HISTOGRAM__
+#define __RTS2_HISTOGRAM__
+
+#include <limits>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace rts2core
+{
+
+/**
+ * Histogram with fixed number of bins, filled from data streamed in
+ * chunks. Range of the histogram is set from the first chunk and is
+ * extended as needed by doubling bin width (merging neighbouring bins),
+ * so memory used does not depend on the data type. Integer data start with
+ * bins one unit wide, so they are counted exactly as long as their range
+ * is smaller than number of bins.
+ *
+ * Provides mode, median and quantile estimates. Estimates are exact up to
+ * the final bin width.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class Histogram
+{
+	public:
+		/**
+		 * @param bins  number of bins; rounded up to even number, at least 2
+		 */
+		Histogram (size_t bins = 4096);
+
+		/**
+		 * Change number of bins. Clears the histogram.
+		 */
+		void setBins (size_t bins);
+
+		size_t getBins () { return counts.size (); }
+
+		/**
+		 * Forget all data, including histogram range.
+		 */
+		void clear ();
+
+		/**
+		 * Add data to the histogram. Caller must provide data range,
+		 * which is usually computed together with other statistics.
+		 * Non-finite values are ignored.
+		 *
+		 * @param data   data to add
+		 * @param n      number of data points
+		 * @param dmin   minimal value in data
+		 * @param dmax   maximal value in data
+		 */
+		template <typename t> void add (const t *data, size_t n, double dmin, double dmax)
+		{
+			const bool int_data = std::numeric_limits <t>::is_integer;
+			if (!int_data && !(dmin - dmin == 0 && dmax - dmax == 0))
+			{
+				// range contains infinity or NaN, find finite range
+				dmin = std::numeric_limits <double>::max ();
+				dmax = -std::numeric_limits <double>::max ();
+				for (const t *d = data; d < data + n; d++)
+				{
+					if (*d - *d != 0)
+						continue;
+					if (*d < dmin)
+						dmin = *d;
+					if (*d > dmax)
+						dmax = *d;
+				}
+				if (dmin > dmax)
+					return;
+			}
+			extend (dmin, dmax, int_data);
+
+			const size_t nb = counts.size ();
+			const double iw = 1 / width;
+			const double l = low;
+			for (const t *d = data; d < data + n; d++)
+			{
+				if (!int_data && *d - *d != 0)
+					continue;
+				size_t i = (size_t) ((*d - l) * iw);
+				// rounding at upper edge
+				if (i >= nb)
+					i = nb - 1;
+				if (++counts[i] > counts[modeBin])
+					modeBin = i;
+				total++;
+			}
+		}
+
+		/**
+		 * Number of values in the histogram.
+		 */
+		uint64_t getCount () { return total; }
+
+		/**
+		 * Returns most common value (center of the fullest bin). For
+		 * integer data counted exactly, returns the value itself. Returns
+		 * NaN for empty histogram.
+		 */
+		double getMode ();
+
+		/**
+		 * Estimate quantile by linear interpolation inside bin. Returns
+		 * NaN for empty histogram.
+		 *
+		 * @param q  quantile, 0 - 1
+		 */
+		double getQuantile (double q);
+
+		double getMedian () { return getQuantile (0.5); }
+
+	private:
+		std::vector <uint64_t> counts;
+		uint64_t total;
+		size_t modeBin;
+
+		double low;
+		// bin width, 0 if histogram range was not yet set
+		double width;
+		bool integer;
+
+		/**
+		 * Make sure histogram covers dmin - dmax range.
+		 */
+		void extend (double dmin, double dmax, bool int_data);
+
+		/**
+		 * Double bin width.
+		 *
+		 * @param down  if true, extend range below current minimum, otherwise above current maximum
+		 */
+		void grow (bool down);
+
+		// value representing given bin
+		double binValue (size_t i) { return integer ? low + i * width + (width - 1) / 2 : low + (i + 0.5) * width; }
+};
+
+}
+
+#endif // !__RTS2_HISTOGRAM__
@@ -0,0 +1,165 @@
+/*
+ * Pixel statistics kernels.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_PIXELSTATS__
+#define __RTS2_PIXELSTATS__
+
+#include "nan.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Statistics kernels used during image readout.
+ *
+ * Kernels are provided for all RTS2_DATA_* pixel types. 16-bit integer
+ * and float kernels use SSE2 or AVX2 instructions when compiled for x86 and
+ * supported by the CPU; instruction set is selected on the first call.
+ * Kernels for other types, and kernels on other architectures, are plain C++
+ * loops. Kernels return the same results as the scalar templates
+ * pixelStatsScalar and thresholdRowScalar, up to rounding errors caused by
+ * different summation order. 16-bit integer sums are calculated exactly.
+ */
+
+namespace rts2core
+{
+
+/**
+ * Accumulated pixel statistics. Kernels add data to existing values, so
+ * statistics of an image can be collected chunk by chunk.
+ */
+class PixelStats
+{
+	public:
+		PixelStats () { clear (); }
+
+		void clear ();
+
+		double getAverage () { return n > 0 ? sum / n : 0; }
+
+		/**
+		 * Population standard deviation.
+		 */
+		double getStdev ();
+
+		double sum;
+		// sum of squares
+		double sum2;
+		double min;
+		double max;
+		size_t n;
+};
+
+/**
+ * Add data to statistics. Min and max ignore NaN values.
+ */
+void pixelStats (const uint8_t *data, size_t n, PixelStats &ps);
+void pixelStats (const int8_t *data, size_t n, PixelStats &ps);
+void pixelStats (const uint16_t *data, size_t n, PixelStats &ps);
+void pixelStats (const int16_t *data, size_t n, PixelStats &ps);
+void pixelStats (const uint32_t *data, size_t n, PixelStats &ps);
+void pixelStats (const int32_t *data, size_t n, PixelStats &ps);
+void pixelStats (const int64_t *data, size_t n, PixelStats &ps);
+void pixelStats (const float *data, size_t n, PixelStats &ps);
+void pixelStats (const double *data, size_t n, PixelStats &ps);
+
+/**
+ * Sums pixels above threshold in a row, used to calculate centroid.
+ *
+ * @param row        row data
+ * @param w          number of pixels in row
+ * @param threshold  only pixels greater or equal to threshold are summed
+ * @param colSums    array of w column sums, pixel values above threshold are added to it
+ * @param rowSum     returns sum of pixels above threshold
+ * @param npix       number of pixels above threshold is added to it
+ * @param rmax       maximal pixel value above threshold (NaN if there are no such pixels)
+ */
+void thresholdRow (const uint8_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const int8_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const uint16_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const int16_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const uint32_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const int32_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const int64_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const float *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+void thresholdRow (const double *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax);
+
+/**
+ * Returns name of instruction set used by kernels ("avx2", "sse2" or "scalar").
+ */
+const char *pixelKernelName ();
+
+/**
+ * Force kernels to use scalar code. Used for testing and benchmarking.
+ */
+void pixelKernelScalar (bool scalar);
+
+/**
+ * Reference scalar implementation of pixelStats.
+ */
+template <typename t> void pixelStatsScalar (const t *data, size_t n, PixelStats &ps)
+{
+	double s = 0;
+	double s2 = 0;
+	double mi = ps.min;
+	double ma = ps.max;
+	for (const t *d = data; d < data + n; d++)
+	{
+		double v = *d;
+		s += v;
+		s2 += v * v;
+		mi = v < mi ? v : mi;
+		ma = v > ma ? v : ma;
+	}
+	ps.sum += s;
+	ps.sum2 += s2;
+	ps.min = mi;
+	ps.max = ma;
+	ps.n += n;
+}
+
+/**
+ * Reference scalar implementation of thresholdRow.
+ */
+template <typename t> void thresholdRowScalar (const t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	double rs = 0;
+	double ma = 0;
+	int np = 0;
+	for (size_t col = 0; col < w; col++)
+	{
+		double v = row[col];
+		if (v >= threshold)
+		{
+			colSums[col] += v;
+			rs += v;
+			if (np == 0 || v > ma)
+				ma = v;
+			np++;
+		}
+	}
+	rowSum = rs;
+	npix += np;
+	rmax = np > 0 ? ma : NAN;
+}
+
+}
+
+#endif // !__RTS2_PIXELSTATS__
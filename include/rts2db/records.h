@@ -31,7 +31,8 @@ namespace rts2db
 {
 
 /**
- * Class representing a record (value).
+ * Class representing a record (value). Records loaded in buckets hold
+ * average value of the bucket, together with its minimum and maximum.
  *
  * @author Petr Kubanek <petr@kubanek.net>
  */
@@ -42,14 +43,28 @@ class Record
 		{
 			rectime = _rectime;
 			val = _val;
+			vmin = vmax = _val;
+		}
+
+		Record (double _rectime, double _val, double _vmin, double _vmax)
+		{
+			rectime = _rectime;
+			val = _val;
+			vmin = _vmin;
+			vmax = _vmax;
 		}
 
 		double getRecTime () { return rectime; };
 		double getValue () { return val; };
 
+		double getMinimum () { return vmin; };
+		double getMaximum () { return vmax; };
+
 	private:
 		double rectime;
 		double val;
+		double vmin;
+		double vmax;
 };
 
 /**
@@ -64,6 +79,7 @@ class RecordsSet: public std::list <Record>
 		{
 			recval_id = _recval_id;
 			value_type = -1;
+			bucketed = false;
 
 			min = max = NAN;
 		}
@@ -73,6 +89,26 @@ class RecordsSet: public std::list <Record>
 		 */
 		void load (double t_from, double t_to);
 
+		/**
+		 * Load values downsampled to at most given number of equally
+		 * sized time buckets. Buckets are computed by the database, so
+		 * number of returned records does not depend on number of
+		 * values recorded in the interval. Each record holds average,
+		 * minimum and maximum of the bucket; its time is average time
+		 * of values in the bucket. States cannot be averaged, and are
+		 * loaded without downsampling.
+		 *
+		 * @param buckets  number of buckets (e.g. plot width in pixels); if <= 0, all values are loaded
+		 *
+		 * @throw SqlError on errror.
+		 */
+		void load (double t_from, double t_to, int buckets);
+
+		/**
+		 * True if records were loaded in buckets.
+		 */
+		bool isBucketed () { return bucketed; }
+
 		double getMin () { return min; };
 		double getMax () { return max; };
 
@@ -90,6 +126,11 @@ class RecordsSet: public std::list <Record>
 		void loadDouble (double t_from, double t_to);
 		void loadBoolean (double t_from, double t_to);
 
+		void loadDoubleBuckets (double t_from, double t_to, int buckets);
+		void loadBooleanBuckets (double t_from, double t_to, int buckets);
+
+		bool bucketed;
+
 		// minmal and maximal values..
 		double min;
 		double max;
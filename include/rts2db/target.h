@@ -128,6 +128,40 @@ class CameraMissingExcetion:public rts2core::Error
 		}
 };
 
+/**
+ * Target data from the targets table, together with data from the grb
+ * table for GRB targets. Rows are filled by loadTargetRows call, so targets
+ * can be created without querying the database for every single target.
+ *
+ * @see createTarget (const TargetRow&, struct ln_lnlat_posn*, double)
+ */
+struct TargetRow
+{
+	int tar_id;
+	char type_id;
+	std::string tar_name;
+	std::string tar_info;
+	float tar_priority;
+	float tar_bonus;
+	time_t tar_bonus_time;
+	time_t tar_next_observable;
+	bool tar_enabled;
+	int tar_telescope_mode;
+	struct ln_equ_posn position;
+	struct ln_equ_posn proper_motion;
+
+	// GRB data, valid only if has_grb is true
+	bool has_grb;
+	double grb_date;
+	double grb_last_update;
+	int grb_type;
+	int grb_id;
+	bool grb_is_grb;
+	struct ln_equ_posn grb;
+	double grb_errorbox;
+	bool grb_autodisabled;
+};
+
 /**
  * Class for one observation target.
  *
@@ -182,6 +216,16 @@ class Target:public Rts2Target
 		// load target data from give target id
 		void loadTarget (int in_tar_id);
 
+		/**
+		 * Set row retrieved by bulk load. If the row is set, load () takes
+		 * target data from it instead of querying the database. The row
+		 * must be valid until load () returns, and shall be reset to NULL
+		 * afterwards.
+		 *
+		 * @param row  target row, NULL to query the database
+		 */
+		void setPreloaded (const TargetRow *row) { preloaded = row; }
+
 		virtual int save (bool overwrite);
 		virtual int saveWithID (bool overwrite, int tar_id);
 
@@ -847,6 +891,12 @@ class Target:public Rts2Target
 		// get called when target was selected to update bonuses etc..
 		virtual int selectedAsGood ();
 
+		/**
+		 * Returns preloaded row if it holds data of target with the
+		 * given ID, NULL otherwise.
+		 */
+		const TargetRow *getPreloaded (int _tar_id) { return (preloaded && preloaded->tar_id == _tar_id) ? preloaded : NULL; }
+
 	private:
 		// holds current target observation
 		Observation * observation;
@@ -887,6 +937,8 @@ class Target:public Rts2Target
 		double satisfiedFrom;
 		double satisfiedTo;
 		double satisfiedProbedUntil;
+
+		const TargetRow *preloaded;
 };
 
 /**
@@ -1221,6 +1273,32 @@ Rts2InfoValStream & operator << (Rts2InfoValStream & _os, rts2db::Target & targe
  */
 rts2db::Target *createTarget (int tar_id, struct ln_lnlat_posn *obs, double altitude);
 
+/**
+ * Create target from row retrieved by loadTargetRows. No database query is
+ * issued for targets with constant coordinates and GRBs; targets which
+ * need data from other tables query them as usual.
+ *
+ * @param row         target row
+ * @param obs         observer position
+ * @param altitude    observator altitude
+ *
+ * @throw rts2core::Error and descendants if target cannot be loaded
+ */
+rts2db::Target *createTarget (const rts2db::TargetRow &row, struct ln_lnlat_posn *obs, double altitude);
+
+/**
+ * Retrieve rows of targets matching given condition with a single query.
+ * Transaction is left open, caller shall commit it after targets are
+ * created.
+ *
+ * @param where       SQL condition on targets table
+ * @param order_by    SQL ordering of the rows
+ * @param rows        vector to which rows will be appended
+ *
+ * @throw SqlError on database error
+ */
+void loadTargetRows (const std::string &where, const std::string &order_by, std::vector <rts2db::TargetRow> &rows);
+
 /**
  * Create target by name.
  *
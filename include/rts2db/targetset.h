@@ -25,6 +25,7 @@
 #include <map>
 #include <vector>
 #include <ostream>
+#include <string>
 
 #include <math.h>
 #include "nan.h"
@@ -227,6 +228,15 @@ class TargetSet:public std::map <int, Target * >
 		// values for load operation
 		std::string where;
 		std::string order_by;
+
+		/**
+		 * Load targets matching given condition. Targets table is
+		 * queried only once for all targets.
+		 *
+		 * @param _where     SQL condition on targets table
+		 * @param _order_by  SQL ordering
+		 */
+		void loadWhere (const std::string &_where, const std::string &_order_by);
 };
 
 class TargetSetSelectable:public TargetSet
@@ -22,8 +22,11 @@
 
 #include <vector>
 #include <malloc.h>
+#include <stdlib.h>
 #include <sys/types.h>
 
+#include "imghdr.h"
+
 namespace rts2image
 {
 
@@ -90,8 +93,32 @@ class Channel
 
 		const char *getData () { return (char *) data; }
 
+		int getPixelByteSize ()
+		{
+			if (dataType == RTS2_DATA_ULONG)
+				return 4;
+			return abs (dataType) / 8;
+		}
+
+		/**
+		 * Compute pixel sum, average and standard deviation. Data are
+		 * processed in a single pass; large channels are split between
+		 * threads (see Channels::setStatisticsThreads).
+		 *
+		 * @param _from      first pixel
+		 * @param _dataSize  number of pixels, 0 for all channel pixels
+		 *
+		 * @throw rts2core::Error on unknown data type
+		 */
 		void computeStatistics (size_t _from = 0, size_t _dataSize = 0);
 
+		void setStatistics (long double _pixelSum, double _average, double _stdev)
+		{
+			pixelSum = _pixelSum;
+			average = _average;
+			stdev = _stdev;
+		}
+
 	private:
 		char *data;
 		int naxis;
@@ -113,6 +140,29 @@ class Channels:public std::vector<Channel *>
 	public:
 		Channels ();
 		~Channels ();
+
+		/**
+		 * Compute statistics of all channels. Channels are processed
+		 * in parallel.
+		 *
+		 * @see Channel::computeStatistics
+		 */
+		void computeStatistics (size_t _from = 0, size_t _dataSize = 0);
+
+		/**
+		 * Set number of threads used to compute statistics.
+		 *
+		 * @param threads  number of threads, 0 for number of online CPUs
+		 */
+		static void setStatisticsThreads (int threads) { statisticsThreads = threads; }
+
+		/**
+		 * Returns number of threads used to compute statistics.
+		 */
+		static int getStatisticsThreads ();
+
+	private:
+		static int statisticsThreads;
 };
 
 }
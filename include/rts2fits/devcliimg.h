@@ -136,6 +136,17 @@ class DevClientCameraImage:public rts2core::DevClientCamera
 		 */
 		void cameraMetadata (Image * image);
 
+		/**
+		 * Process image after it was saved to the disk.
+		 */
+		void processSavedImage (CameraImage *ci);
+
+		/**
+		 * Post EVENT_ALL_IMAGES_WRITTEN if there aren't any images
+		 * waiting to be written.
+		 */
+		void checkAllImagesWritten ();
+
 		void allImageDataReceived (int data_conn, rts2core::DataChannels *data, bool data2fits);
 
 		/**
@@ -153,6 +164,9 @@ class DevClientCameraImage:public rts2core::DevClientCamera
 		// camera chip numbers..
 		CameraImages images;
 
+		// images being written by FitsWriter, indexed by writer job ID
+		std::map <unsigned long, CameraImage *> writingImages;
+
 		// current image
 		CameraImage *actualImage;
 
@@ -161,6 +175,10 @@ class DevClientCameraImage:public rts2core::DevClientCamera
 
 		bool triggered;
 
+		// tile compression of images (cfitsio algorithm, 0 for none) and quantization of floating point data
+		int compressType;
+		float compressQuantize;
+
 		// already received informations from those devices..
 		std::vector < rts2core::DevClient * > prematurelyReceived;
 };
@@ -230,6 +230,19 @@ class FitsFile: public rts2core::Expander
 		void getValues (const char *name, double *values, int num, bool required = false, int nstart = 1);
 		void getValues (const char *name, char **values, int num, bool required = false, int nstart = 1);
 
+		/**
+		 * Get dimensions of the first HDU holding image data. Data of
+		 * tile-compressed images are in an extension, and their NAXIS
+		 * keywords describe binary table, so NAXISn keywords of the
+		 * primary HDU cannot be used. Current HDU is not changed.
+		 *
+		 * @param sizes  returned image dimensions
+		 * @param num    number of dimensions
+		 *
+		 * @throw KeyNotFound if file does not contain image with num dimensions
+		 */
+		void getImageSize (long *sizes, int num);
+
 		/**
 		 * Expand FITS path.
 		 *
@@ -313,6 +326,20 @@ class FitsFile: public rts2core::Expander
 		 */
 		std::string getFitsErrors ();
 
+		/**
+		 * If set, in-memory file will be passed to the FitsWriter in
+		 * closeFile call and written to disk in the writer thread.
+		 * Image is written synchronously if the writer is not running,
+		 * or if its queue is full.
+		 */
+		void setAsyncWrite (bool _asyncWrite) { asyncWrite = _asyncWrite; }
+
+		/**
+		 * Returns ID of FitsWriter job writing the file, 0 if the file
+		 * was not passed to the writer.
+		 */
+		unsigned long getWriteJob () { return writeJob; }
+
 	protected:
 		int fits_status;
 		int flags;
@@ -352,6 +379,9 @@ class FitsFile: public rts2core::Expander
 
 		size_t *memsize;
 		void **imgbuf;
+
+		bool asyncWrite;
+		unsigned long writeJob;
 };
 
 /**
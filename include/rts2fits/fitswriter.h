@@ -0,0 +1,167 @@
+/*
+ * Background writer of in-memory FITS files.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_FITSWRITER__
+#define __RTS2_FITSWRITER__
+
+#include "connnosend.h"
+
+#include <fitsio.h>
+#include <pthread.h>
+
+#include <list>
+#include <string>
+
+// image was written to disk, argument is pointer to FitsWriter::Job
+#define EVENT_IMAGE_WRITTEN           RTS2_LOCAL_EVENT + 538
+// writer queue changed, argument is pointer to FitsWriter
+#define EVENT_WRITER_QUEUE            RTS2_LOCAL_EVENT + 539
+
+namespace rts2image
+{
+
+/**
+ * Writes in-memory FITS files to disk in a separate thread, so the event
+ * loop is not blocked by slow disks. The writer takes ownership of the
+ * memory file together with its buffer, copies it to the disk file, syncs
+ * the file and frees the buffer.
+ *
+ * Finished writes are reported through a pipe, which is polled by the
+ * block as any other connection. For every finished write,
+ * EVENT_IMAGE_WRITTEN is posted to the block.
+ *
+ * Number of images waiting to be written is limited. If the queue is full,
+ * image shall be written synchronously by the caller - that slows the loop
+ * down to disk speed, instead of filling memory with images.
+ *
+ * As only one writer is needed per process, it is created with start call
+ * and accessed with instance call.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class FitsWriter:public rts2core::ConnNoSend
+{
+	public:
+		/**
+		 * Write job. Ownership of the memory file passes to the writer.
+		 */
+		struct Job
+		{
+			unsigned long id;
+			fitsfile *memFile;
+			void **imgbuf;
+			size_t *memsize;
+			std::string fileName;
+			bool overwrite;
+			// size of the buffer, in bytes
+			size_t size;
+			bool failed;
+		};
+
+		virtual ~FitsWriter ();
+
+		/**
+		 * Create writer and add it to block connections. Returns NULL
+		 * if cfitsio library is not thread safe, or if writer thread
+		 * cannot be started.
+		 *
+		 * @param master    block which will receive EVENT_IMAGE_WRITTEN
+		 * @param maxQueue  maximal number of images waiting to be written
+		 */
+		static FitsWriter *start (rts2core::Block *master, int maxQueue);
+
+		/**
+		 * Returns running writer, NULL if writer was not started.
+		 */
+		static FitsWriter *instance () { return pInstance; }
+
+		/**
+		 * Queue memory file for writing.
+		 *
+		 * @param memFile    memory file, writer will close it
+		 * @param imgbuf     memory file buffer, writer will free it
+		 * @param memsize    memory file size, writer will free it
+		 * @param fileName   disk file name
+		 * @param overwrite  if true, existing disk file will be overwritten
+		 *
+		 * @return job ID, 0 if the queue is full and file was not queued
+		 */
+		unsigned long queue (fitsfile *memFile, void **imgbuf, size_t *memsize, const char *fileName, bool overwrite);
+
+		virtual int receive (rts2core::Block *block);
+
+		/**
+		 * Number of images being written.
+		 */
+		size_t getQueued () { return inFlight; }
+
+		int getMaxQueue () { return maxQueue; }
+
+		/**
+		 * Bytes waiting to be written.
+		 */
+		size_t getBytesPending () { return bytesPending; }
+
+		/**
+		 * Number of images written synchronously, as the queue was full.
+		 */
+		unsigned long getOverflows () { return overflows; }
+
+		/**
+		 * Number of failed writes.
+		 */
+		unsigned long getFailed () { return failed; }
+
+		/**
+		 * Record synchronous write caused by full queue.
+		 */
+		void overflow () { overflows++; }
+
+	private:
+		FitsWriter (rts2core::Block *_master, int _maxQueue, int notifyFd);
+
+		static FitsWriter *pInstance;
+
+		int maxQueue;
+		int notifyWrite;
+
+		unsigned long lastId;
+		size_t inFlight;
+		size_t bytesPending;
+		unsigned long overflows;
+		unsigned long failed;
+
+		pthread_t thread;
+		bool running;
+
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		bool stop;
+
+		std::list <Job> pending;
+		std::list <Job> finished;
+
+		static void *writeImages (void *arg);
+
+		void writeJob (Job &job);
+};
+
+}
+
+#endif // !__RTS2_FITSWRITER__
@@ -263,6 +263,27 @@ class Image:public FitsFile
 
 		int writeData (char *in_data, char *fullTop, int nchan);
 
+		/**
+		 * Sets tile compression of data written by writeData. As
+		 * primary HDU cannot be compressed, compressed data are always
+		 * written to extensions, and primary HDU holds only headers.
+		 *
+		 * @param _compressType  cfitsio compression algorithm (RICE_1, GZIP_1, ..), 0 to write uncompressed data
+		 * @param _quantize      quantization level of floating point data, 0 for lossless compression
+		 */
+		void setCompression (int _compressType, float _quantize)
+		{
+			compressType = _compressType;
+			quantize = _quantize;
+		}
+
+		/**
+		 * Returns cfitsio compression algorithm for its name (rice,
+		 * gzip, gzip2, hcompress or plio), 0 for none, -1 if name is
+		 * not known.
+		 */
+		static int getCompressionType (const char *name);
+
 		/**
 		 * Fill image header structure.
 		 */
@@ -359,6 +380,14 @@ class Image:public FitsFile
 		 * Store image to blob, which can be used to get data etc..
 		 */
 		void writeAsBlob (Magick::Blob &blob, const char * label = NULL, float quantiles=0.005, int chan = -1, int colourVariant = PSEUDOCOLOUR_VARIANT_GREY);
+
+		/**
+		 * Write preview, as shown on image preview pages, to blob.
+		 *
+		 * @param prevsize   preview size in pixels; if <= 0, image is not zoomed
+		 * @param label      label written at the bottom of the preview (expand characters)
+		 */
+		void writePreviewBlob (Magick::Blob &blob, int prevsize, const char * label, float quantiles=0.005, int chan = -1, int colourVariant = PSEUDOCOLOUR_VARIANT_GREY);
 #endif
 
 		double getAstrometryErr ();
@@ -737,6 +766,13 @@ class Image:public FitsFile
 
 		// if write RTS2 extended values
 		bool writeRTS2Values;
+
+		// tile compression of written data
+		int compressType;
+		float quantize;
+
+		// set compression for the next created image HDU
+		void setDataCompression ();
 	
 		int targetId;
 		int targetIdSel;
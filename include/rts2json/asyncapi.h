@@ -23,6 +23,7 @@
 
 #include "httpreq.h"
 #include "rts2fits/image.h"
+#include "rts2json/subscriptions.h"
 #include "xmlrpc++/XmlRpc.h"
 #include "device.h"
 
@@ -51,6 +52,21 @@ class AsyncAPI:public rts2core::Object
 		virtual void stateChanged (rts2core::Connection *_conn) {};
 		virtual void valueChanged (rts2core::Connection *_conn, rts2core::Value *_value) {};
 
+		/**
+		 * Register values whose changes will be passed to valueChanged.
+		 */
+		virtual void subscribe (SubscriptionIndex <AsyncAPI *> &index) {}
+
+		/**
+		 * Returns description of subscribed values, empty string if the call does not subscribe to any value.
+		 */
+		virtual std::string getSubscriptions () { return std::string (); }
+
+		/**
+		 * Returns number of value changes passed to the call.
+		 */
+		unsigned long getDispatched () { return dispatched; }
+
 		/**
 		 * Check if the request is for connection or source..
 		 */
@@ -82,6 +98,8 @@ class AsyncAPI:public rts2core::Object
 		XmlRpc::XmlRpcServerConnection *source;
 		rts2core::Connection *conn;
 
+		unsigned long dispatched;
+
 	private:
 		bool ext;
 };
@@ -120,6 +138,11 @@ class AsyncValueAPI:public AsyncAPI
 		virtual void stateChanged (rts2core::Connection *_conn);
 
 		virtual void valueChanged (rts2core::Connection *_conn, rts2core::Value *_value);
+
+		virtual void subscribe (SubscriptionIndex <AsyncAPI *> &index);
+
+		virtual std::string getSubscriptions ();
+
 		/**
 		 * Send all registered values and states on JSON connection. Throw an error if value/connection
 		 * cannot be found.
@@ -133,7 +156,12 @@ class AsyncValueAPI:public AsyncAPI
 		std::vector <std::pair <std::string, std::string> > values;
 
 		void sendState (std::list <AsyncState>::iterator astate, rts2core::Connection *_conn);
-		void sendValue (const std::string &device, rts2core::Value *_value);
+		/**
+		 * Send value change to the client.
+		 *
+		 * @param _conn   connection holding the value, NULL for own values
+		 */
+		void sendValue (const std::string &device, rts2core::Connection *_conn, rts2core::Value *_value);
 };
 
 /**
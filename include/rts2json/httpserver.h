@@ -27,8 +27,10 @@
 #include <sys/socket.h>
 
 #include "block.h"
+#include "thumbcache.h"
 #include "userpermissions.h"
 #include "rts2db/camlist.h"
+#include "rts2json/subscriptions.h"
 
 namespace rts2json
 {
@@ -41,7 +43,7 @@ class AsyncAPI;
 class HTTPServer
 {
 	public:
-		HTTPServer ()
+		HTTPServer ():subscriptions ()
 		{
 			sumAsync = NULL;
 			numberAsyncAPIs = NULL;
@@ -93,13 +95,18 @@ class HTTPServer
 		 */
 		virtual int getDefaultChannel () { return 0; }
 
+		/**
+		 * Return cache for image previews, NULL if previews should not be cached.
+		 */
+		virtual rts2core::ThumbnailCache *getThumbnailCache () { return NULL; }
+
 		/**
 		 * Verify user credentials.
 		 */
 		virtual bool verifyDBUser (std::string username, std::string pass, rts2core::UserPermissions *userPermissions = NULL) = 0;
 
 		/**
-		 * Register asynchronous API call.
+		 * Register asynchronous API call, subscribe it to value changes.
 		 */
 		void registerAPI (AsyncAPI *a);
 
@@ -109,6 +116,8 @@ class HTTPServer
 		rts2core::ValueInteger *numberAsyncAPIs;
 		rts2core::ValueInteger *sumAsync;
 		std::list <rts2json::AsyncAPI *> asyncAPIs;
+		// value subscriptions of asyncAPIs
+		SubscriptionIndex <rts2json::AsyncAPI *> subscriptions;
 
 		bool auth_localhost;
 };
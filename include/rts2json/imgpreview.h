@@ -29,6 +29,13 @@
 namespace rts2json
 {
 
+/**
+ * Returns true if cfitsio can be called from request worker threads. Requests
+ * reading FITS files are executed in the main loop if cfitsio was built
+ * without reentrant support.
+ */
+bool fitsReentrant ();
+
 /**
  * Create page with JPEG previews. This is an abstract class - all classes
  * which need preview functionality shoudl inherit from this page.
@@ -92,6 +99,8 @@ class JpegImageRequest: public rts2json::GetRequestAuthorized
 		JpegImageRequest (const char* prefix, rts2json::HTTPServer *_http_server, XmlRpc::XmlRpcServer* s):rts2json::GetRequestAuthorized (prefix, _http_server, NULL, s) {}
 
 		virtual void authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length);
+
+		virtual bool isHeavy (const std::string &path, XmlRpc::HttpParams *params) { return fitsReentrant (); }
 };
 
 /**
@@ -105,6 +114,8 @@ class JpegPreview:public rts2json::GetRequestAuthorized
 		JpegPreview (const char* prefix, rts2json::HTTPServer *_http_server, const char *_dirPath, XmlRpc::XmlRpcServer *s):rts2json::GetRequestAuthorized (prefix, _http_server, "JPEG image preview", s) { dirPath = _dirPath; }
 
 		virtual void authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length);
+
+		virtual bool isHeavy (const std::string &path, XmlRpc::HttpParams *params) { return fitsReentrant (); }
 	private:
 		const char *dirPath;
 };
@@ -112,7 +123,8 @@ class JpegPreview:public rts2json::GetRequestAuthorized
 #endif // RTS2_HAVE_LIBJPEG
 
 /**
- * Returns raw FITS file as it is written on the disk.
+ * Returns raw FITS file as it is written on the disk. If uncompress parameter
+ * is set, tile-compressed images are uncompressed before the file is sent.
  *
  * @author Petr Kubanek <petr@kubanek.net>
  */
@@ -121,6 +133,8 @@ class FitsImageRequest:public rts2json::GetRequestAuthorized
 	public:
 		FitsImageRequest (const char* prefix, rts2json::HTTPServer *_http_server, XmlRpc::XmlRpcServer* s):rts2json::GetRequestAuthorized (prefix, _http_server, NULL, s) {}
 
+		virtual bool isHeavy (const std::string &path, XmlRpc::HttpParams *params) { return params->getBoolean ("uncompress", false) && fitsReentrant (); }
+
 		virtual void authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length);
 };
 
@@ -133,26 +147,9 @@ class FitsImageRequest:public rts2json::GetRequestAuthorized
 class DownloadRequest:public rts2json::GetRequestAuthorized
 {
 	public:
-#ifdef RTS2_HAVE_LIBARCHIVE
-		DownloadRequest (const char* prefix, rts2json::HTTPServer *_http_server, XmlRpc::XmlRpcServer* s):rts2json::GetRequestAuthorized (prefix, _http_server, NULL, s) { buf = NULL; buf_size = 0; }
-		virtual ~DownloadRequest () { if (buf) free (buf); }
-#else
 		DownloadRequest (const char* prefix, rts2json::HTTPServer *_http_server, XmlRpc::XmlRpcServer* s):rts2json::GetRequestAuthorized (prefix, _http_server, NULL, s) {}
-#endif
 		virtual void authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length);
-
-#ifdef RTS2_HAVE_LIBARCHIVE
-		char *buf;
-		ssize_t buf_size;
-#endif
 };
 
 }
 
-#ifdef RTS2_HAVE_LIBARCHIVE
-
-int open_callback (struct archive *a, void *client_data);
-ssize_t write_callback (struct archive *a, void *client_data, const void *buffer, size_t length);
-int close_callback (struct archive *a, void *client_data);
-
-#endif // RTS2_HAVE_LIBARCHIVE
@@ -37,6 +37,13 @@ class JSONDBRequest:public JSONRequest
 	public:
 		JSONDBRequest (const char *prefix, HTTPServer *_http_server, XmlRpc::XmlRpcServer* s):JSONRequest (prefix, _http_server, s) {}
 
+		/**
+		 * Returns true if request is processed by dbJSON.
+		 *
+		 * @param name  first path component of the request
+		 */
+		static bool isDBRequest (const std::string &name);
+
 	protected:
 		/**
 		 * Process JSON API DB requests.
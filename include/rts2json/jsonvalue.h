@@ -122,20 +122,77 @@ class JsonString
 /**
  * Support class/interface for operations needed by XmlDevClient and XmlDevClientCamera.
  *
+ * Keeps JSON encoded values of the connection, so values are encoded only
+ * once after they change, no matter how many clients request them. Each value
+ * change increments connection generation; the value is stamped with the new
+ * generation, so clients can ask only for values changed since generation
+ * they already know.
+ *
  * @author Petr Kubanek <petr@kubanek.net>
  */
 class DevInterface
 {
 	public:
-		DevInterface ():changedTimes () {}
+		DevInterface ():cache () { generation = 0; }
+		virtual ~DevInterface () {}
 
 		double getValueChangedTime (rts2core::Value *value);
 
+		/**
+		 * Returns generation of the last value change, 0 if value
+		 * change was not recorded.
+		 */
+		unsigned long getValueGeneration (rts2core::Value *value);
+
+		/**
+		 * Returns generation of the last change of any connection value.
+		 */
+		unsigned long getGeneration () { return generation; }
+
+		/**
+		 * Returns value encoded by jsonValue. Encoded value is cached
+		 * until the value, its flags or its metainfo change.
+		 */
+		const std::string &getJsonValue (rts2core::Value *value, bool extended);
+
 	protected:
-		// value change times
-		std::map <rts2core::Value *, double> changedTimes;
+		/**
+		 * Record value change - set change time, increment generation
+		 * and drop cached JSON.
+		 */
+		void valueUpdated (rts2core::Value *value);
+
+		/**
+		 * Record change of value metainfo - increment generation and
+		 * drop cached JSON. Must be called when value description
+		 * changes, as it is not checked by getJsonValue.
+		 */
+		void valueMetaUpdated (rts2core::Value *value);
+
+	private:
+		struct ValueCache
+		{
+			ValueCache () { changed = NAN; generation = 0; flags = 0; valid[0] = valid[1] = false; }
+
+			// value change time
+			double changed;
+			unsigned long generation;
+			// flags of encoded value; changes with metainfo, error and warning bits
+			int32_t flags;
+			// JSON, index 1 is for extended encoding
+			std::string json[2];
+			bool valid[2];
+		};
+
+		std::map <rts2core::Value *, ValueCache> cache;
+		unsigned long generation;
 };
 
+/**
+ * Returns DevInterface of the connection, NULL if connection client does not provide it.
+ */
+DevInterface *getDevInterface (rts2core::Connection *conn);
+
 void sendArrayValue (rts2core::Value *value, std::ostringstream &os);
 
 void sendStatValue (rts2core::Value *value, std::ostringstream &os);
@@ -151,8 +208,9 @@ void jsonValue (rts2core::Value *value, bool extended, std::ostringstream & os);
  * Send connection values as JSON string to the client.
  *
  * @param time from which changed values will be reported. nan means that all values will be reported.
+ * @param since  only values changed after this generation will be reported; 0 reports all values
  */
-void sendConnectionValues (std::ostringstream &os, rts2core::Connection * conn, XmlRpc::HttpParams *params, double from = NAN, bool extended = false);
+void sendConnectionValues (std::ostringstream &os, rts2core::Connection * conn, XmlRpc::HttpParams *params, double from = NAN, bool extended = false, unsigned long since = 0);
 }
 
 #endif // !__RTS2_JSONVALUE__
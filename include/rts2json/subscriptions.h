@@ -0,0 +1,202 @@
+/*
+ * Index of value change subscriptions.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_SUBSCRIPTIONS__
+#define __RTS2_SUBSCRIPTIONS__
+
+#include "connection.h"
+#include "utilsfunc.h"
+#include "value.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rts2json
+{
+
+/**
+ * Index of subscribers to value changes. Subscribers register device and
+ * value names. Value names are compared case insensitive, as Value::isValue
+ * does. Device names are compared case sensitive, unless the index is
+ * created as case insensitive. Subscribers of a value are resolved
+ * by name on the first change of the value, and are then found by value
+ * pointer, so dispatching a value change does not depend on number of
+ * subscriptions.
+ *
+ * Subscriptions must not be changed while subscribers returned by find are
+ * being processed.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+template <typename T> class SubscriptionIndex
+{
+	public:
+		/**
+		 * @param _caseSensitive  if false, device names are compared case insensitive
+		 */
+		SubscriptionIndex (bool _caseSensitive = true):devices (), resolved () { caseSensitive = _caseSensitive; }
+
+		/**
+		 * Subscribe to changes of a device value.
+		 *
+		 * @param device      device name, centrald for central server values
+		 * @param value       value name, NULL to subscribe to all device values
+		 * @param subscriber  subscriber
+		 */
+		void subscribe (const char *device, const char *value, T subscriber)
+		{
+			DeviceSubscribers &ds = devices[deviceKey (device)];
+			if (value == NULL)
+				ds.all.push_back (subscriber);
+			else
+				ds.values[ci_string (value)].push_back (subscriber);
+			resolved.clear ();
+		}
+
+		/**
+		 * Remove all subscriptions of the subscriber.
+		 */
+		void unsubscribe (T subscriber)
+		{
+			for (typename std::map <std::string, DeviceSubscribers>::iterator iter = devices.begin (); iter != devices.end ();)
+			{
+				remove (iter->second.all, subscriber);
+				for (typename std::map <ci_string, std::vector <T> >::iterator viter = iter->second.values.begin (); viter != iter->second.values.end ();)
+				{
+					remove (viter->second, subscriber);
+					if (viter->second.empty ())
+						iter->second.values.erase (viter++);
+					else
+						viter++;
+				}
+				if (iter->second.all.empty () && iter->second.values.empty ())
+					devices.erase (iter++);
+				else
+					iter++;
+			}
+			resolved.clear ();
+		}
+
+		/**
+		 * Remove all subscriptions.
+		 */
+		void clear ()
+		{
+			devices.clear ();
+			resolved.clear ();
+		}
+
+		/**
+		 * Forget values of the connection. Must be called when connection is removed.
+		 */
+		void connectionRemoved (rts2core::Connection *conn)
+		{
+			for (typename std::map <rts2core::Value *, Resolved>::iterator iter = resolved.begin (); iter != resolved.end ();)
+			{
+				if (iter->second.conn == conn)
+					resolved.erase (iter++);
+				else
+					iter++;
+			}
+		}
+
+		/**
+		 * Returns subscribers of the connection value.
+		 */
+		const std::vector <T> &find (rts2core::Connection *conn, rts2core::Value *value)
+		{
+			typename std::map <rts2core::Value *, Resolved>::iterator iter = resolved.find (value);
+			// value can be recreated at the same address by metainfo
+			if (iter != resolved.end () && iter->second.conn == conn && iter->second.name == value->getName ())
+				return iter->second.subscribers;
+
+			Resolved &r = resolved[value];
+			r.conn = conn;
+			r.name = value->getName ();
+			r.subscribers.clear ();
+
+			typename std::map <std::string, DeviceSubscribers>::iterator diter = devices.find (deviceKey (getDeviceName (conn)));
+			if (diter != devices.end ())
+			{
+				add (r.subscribers, diter->second.all);
+				typename std::map <ci_string, std::vector <T> >::iterator viter = diter->second.values.find (ci_string (r.name.c_str ()));
+				if (viter != diter->second.values.end ())
+					add (r.subscribers, viter->second);
+			}
+			return r.subscribers;
+		}
+
+		/**
+		 * Returns name used to subscribe to connection values.
+		 */
+		static const char *getDeviceName (rts2core::Connection *conn)
+		{
+			return conn->getOtherType () == DEVICE_TYPE_SERVERD ? "centrald" : conn->getName ();
+		}
+
+	private:
+		struct DeviceSubscribers
+		{
+			// subscribers to all device values
+			std::vector <T> all;
+			std::map <ci_string, std::vector <T> > values;
+		};
+
+		struct Resolved
+		{
+			rts2core::Connection *conn;
+			std::string name;
+			std::vector <T> subscribers;
+		};
+
+		bool caseSensitive;
+
+		// indexed by device name, converted to upper case for case insensitive index
+		std::map <std::string, DeviceSubscribers> devices;
+		std::map <rts2core::Value *, Resolved> resolved;
+
+		std::string deviceKey (const char *device)
+		{
+			std::string ret (device);
+			if (caseSensitive == false)
+				std::transform (ret.begin (), ret.end (), ret.begin (), ::toupper);
+			return ret;
+		}
+
+		// add subscribers, each subscriber is added only once
+		static void add (std::vector <T> &v, std::vector <T> &subscribers)
+		{
+			for (typename std::vector <T>::iterator iter = subscribers.begin (); iter != subscribers.end (); iter++)
+			{
+				if (std::find (v.begin (), v.end (), *iter) == v.end ())
+					v.push_back (*iter);
+			}
+		}
+
+		static void remove (std::vector <T> &v, T subscriber)
+		{
+			v.erase (std::remove (v.begin (), v.end (), subscriber), v.end ());
+		}
+};
+
+}
+
+#endif // !__RTS2_SUBSCRIPTIONS__
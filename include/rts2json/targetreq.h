@@ -48,6 +48,11 @@ class Targets: public rts2json::GetRequestAuthorized
 	public:
 		Targets (const char *prefix, rts2json::HTTPServer *_http_server, XmlRpc::XmlRpcServer *s);
 		virtual void authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length);
+
+		/**
+		 * Altitude plots are heavy, other pages might send commands to devices.
+		 */
+		virtual bool isHeavy (const std::string &path, XmlRpc::HttpParams *params);
 	
 	private:
 		bool displaySeconds;
@@ -24,6 +24,7 @@
 #include "connexe.h"
 #include "rts2fits/imagedb.h"
 #include "rts2db/observation.h"
+#include "thumbcache.h"
 
 namespace rts2plan
 {
@@ -49,6 +50,18 @@ class ConnProcess:public rts2script::ConnExe
 #ifdef RTS2_HAVE_LIBJPEG
 		void setLastGoodJpeg (const char *_last_good_jpeg) { last_good_jpeg = _last_good_jpeg; }
 		void setLastTrashJpeg (const char *_last_trash_jpeg) { last_trash_jpeg = _last_trash_jpeg; }
+
+		/**
+		 * Set cache for image previews. Preview of processed image
+		 * is stored in the cache, so it does not have to be rendered
+		 * when HTTP server sharing the cache is asked for it.
+		 *
+		 * @param _cache     preview cache
+		 * @param _prevsize  preview size
+		 * @param _label     preview label
+		 * @param _chan      preview channel
+		 */
+		void setThumbnailCache (rts2core::ThumbnailCache *_cache, int _prevsize, const char *_label, int _chan) { thumbnailCache = _cache; thumbnailSize = _prevsize; thumbnailLabel = _label; thumbnailChannel = _chan; }
 #endif
 
 	protected:
@@ -58,6 +71,16 @@ class ConnProcess:public rts2script::ConnExe
 #ifdef RTS2_HAVE_LIBJPEG
 		const char *last_good_jpeg;
 		const char *last_trash_jpeg;
+
+		rts2core::ThumbnailCache *thumbnailCache;
+		int thumbnailSize;
+		const char *thumbnailLabel;
+		int thumbnailChannel;
+
+		/**
+		 * Store preview of the image in thumbnail cache.
+		 */
+		void writeThumbnail (const char *path);
 #endif
 };
 
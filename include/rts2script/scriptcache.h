@@ -0,0 +1,109 @@
+/*
+ * Cache of parsed target scripts.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_SCRIPTCACHE__
+#define __RTS2_SCRIPTCACHE__
+
+#include "rts2target.h"
+
+#include <libnova/libnova.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rts2script
+{
+
+/**
+ * Cache of informations extracted from target scripts - expected script
+ * durations and filters used in the script. Selector and executor queues
+ * ask for those repeatedly for the same targets; without the cache, script
+ * was parsed on each request.
+ *
+ * Entries are indexed by target ID and camera name. Script text is
+ * retrieved from the target on each request and compared with text of the
+ * cached entry, so entry is invalidated when target script changes.
+ * Scripts which are returned by parts (target getScript call returns true)
+ * are not cached.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ScriptCache
+{
+	public:
+		static ScriptCache *instance ();
+
+		/**
+		 * Returns expected script duration.
+		 *
+		 * @param tar     target for which script will be retrieved
+		 * @param camera  camera name
+		 * @param tel     current telescope position, used to estimate time needed for telescope movement
+		 * @param runnum  script run number (= 0 before script was run,..)
+		 *
+		 * @see Script::getExpectedDuration
+		 */
+		double getExpectedDuration (Rts2Target *tar, const char *camera, struct ln_equ_posn *tel = NULL, int runnum = 0);
+
+		/**
+		 * Returns filters used in filter= commands of the script.
+		 *
+		 * @param tar     target for which script will be retrieved
+		 * @param camera  camera name
+		 * @param filters returned filters
+		 */
+		void getFilters (Rts2Target *tar, const char *camera, std::vector <std::string> &filters);
+
+		void clear () { entries.clear (); }
+
+		unsigned long getHits () { return hits; }
+		unsigned long getMisses () { return misses; }
+
+	private:
+		ScriptCache ();
+
+		static ScriptCache *pInstance;
+
+		struct CacheEntry
+		{
+			std::string script;
+			// script durations without telescope movement, indexed by target acquired flag and run number
+			std::map <std::pair <bool, int>, double> durations;
+			float telescopeSettleTime;
+			float telescopeSpeed;
+			bool filtersValid;
+			std::vector <std::string> filters;
+		};
+
+		std::map <std::pair <int, std::string>, CacheEntry> entries;
+
+		unsigned long hits;
+		unsigned long misses;
+
+		/**
+		 * Returns cache entry for the target script, or NULL if the
+		 * script cannot be cached.
+		 */
+		CacheEntry *getEntry (Rts2Target *tar, const char *camera);
+};
+
+}
+
+#endif // !__RTS2_SCRIPTCACHE__
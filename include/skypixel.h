@@ -0,0 +1,168 @@
+/*
+ * Sky partitioning for indexed cone searches.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_SKYPIXEL__
+#define __RTS2_SKYPIXEL__
+
+/*
+ * Sky is divided into declination zones of SKYPIX_ZONE_HEIGHT degrees. Every
+ * zone is divided into RA cells of roughly the same width, so pixels are
+ * close to square. Pixels are numbered from the south pole, by zones and
+ * then by RA.
+ *
+ * Pixel numbers are stored in the database next to coordinates and indexed.
+ * Cone search then first selects rows in pixels covering the cone, and only
+ * for them computes exact distance.
+ *
+ * This file is included by PostgreSQL extensions (in C) as well as by the
+ * client code, so it must stay plain C.
+ */
+
+#include <math.h>
+
+#define SKYPIX_ZONE_HEIGHT    0.5
+#define SKYPIX_ZONES          360
+
+/* larger cones are searched without pixel prefilter */
+#define SKYPIX_MAX_RADIUS     10.0
+
+static int skypix_offsets[SKYPIX_ZONES + 1];
+static int skypix_initialized = 0;
+
+/* number of RA cells in zone */
+static inline int skypix_cells (int zone)
+{
+	double dec = -90.0 + (zone + 0.5) * SKYPIX_ZONE_HEIGHT;
+	int n = (int) floor (360.0 * cos (dec * M_PI / 180.0) / SKYPIX_ZONE_HEIGHT);
+	return n < 1 ? 1 : n;
+}
+
+/* number of the first pixel in the zone */
+static inline int skypix_offset (int zone)
+{
+	int z;
+	if (!skypix_initialized)
+	{
+		skypix_offsets[0] = 0;
+		for (z = 0; z < SKYPIX_ZONES; z++)
+			skypix_offsets[z + 1] = skypix_offsets[z] + skypix_cells (z);
+		skypix_initialized = 1;
+	}
+	return skypix_offsets[zone];
+}
+
+/* total number of pixels */
+static inline int skypix_count (void)
+{
+	return skypix_offset (SKYPIX_ZONES);
+}
+
+static inline int skypix_zone (double dec)
+{
+	int z = (int) floor ((dec + 90.0) / SKYPIX_ZONE_HEIGHT);
+	if (z < 0)
+		return 0;
+	if (z >= SKYPIX_ZONES)
+		return SKYPIX_ZONES - 1;
+	return z;
+}
+
+/* RA cell, RA can be outside 0-360 range */
+static inline int skypix_cell (double ra, int n)
+{
+	int c = (int) floor (ra * n / 360.0);
+	c %= n;
+	return c < 0 ? c + n : c;
+}
+
+/* pixel containing given position, in degrees */
+static inline int skypix_pixel (double ra, double dec)
+{
+	int z = skypix_zone (dec);
+	return skypix_offset (z) + skypix_cell (ra, skypix_cells (z));
+}
+
+/* angular separation of two positions, in degrees */
+static inline double skypix_separation (double ra1, double dec1, double ra2, double dec2)
+{
+	double sd = sin ((dec2 - dec1) * M_PI / 360.0);
+	double sr = sin ((ra2 - ra1) * M_PI / 360.0);
+	double a = sd * sd + cos (dec1 * M_PI / 180.0) * cos (dec2 * M_PI / 180.0) * sr * sr;
+	return 360.0 * asin (sqrt (a > 1 ? 1 : a)) / M_PI;
+}
+
+/*
+ * Pixels covering cone with given center and radius, all in degrees. Pixels
+ * are written to pix, if it is not NULL. Returns number of pixels; call it
+ * with NULL pix to find out how large array is needed.
+ *
+ * The cover is conservative - it contains every pixel which intersects the
+ * cone, and possibly some more.
+ */
+static inline int skypix_cone (double ra, double dec, double radius, int *pix)
+{
+	double alpha;
+	int z, z1, z2, c, c1, c2, n, off;
+	int ret = 0;
+
+	if (dec + radius >= 90.0 || dec - radius <= -90.0)
+	{
+		/* cone contains pole, all RA are covered */
+		alpha = 180.0;
+	}
+	else
+	{
+		/* maximal RA distance of the cone points from the center */
+		double s = sin (radius * M_PI / 180.0) / cos (dec * M_PI / 180.0);
+		alpha = s >= 1 ? 180.0 : asin (s) * 180.0 / M_PI;
+	}
+
+	z1 = skypix_zone (dec - radius);
+	z2 = skypix_zone (dec + radius);
+
+	for (z = z1; z <= z2; z++)
+	{
+		n = skypix_cells (z);
+		off = skypix_offset (z);
+		if (alpha >= 180.0)
+		{
+			c1 = 0;
+			c2 = n - 1;
+		}
+		else
+		{
+			c1 = (int) floor ((ra - alpha) * n / 360.0);
+			c2 = (int) floor ((ra + alpha) * n / 360.0);
+			if (c2 - c1 + 1 >= n)
+			{
+				c1 = 0;
+				c2 = n - 1;
+			}
+		}
+		for (c = c1; c <= c2; c++)
+		{
+			if (pix)
+				pix[ret] = off + ((c % n) + n) % n;
+			ret++;
+		}
+	}
+	return ret;
+}
+
+#endif /* !__RTS2_SKYPIXEL__ */
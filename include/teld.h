@@ -25,6 +25,7 @@
 #include <time.h>
 #include "pluto/norad.h"
 
+#include "correctioncache.h"
 #include "device.h"
 #include "objectcheck.h"
 
@@ -144,6 +145,14 @@ class Telescope:public rts2core::Device
 			calRefraction->setValueBool (_refraction);
 		}
 
+		/**
+		 * Disable interpolation of precession, nutation and aberation
+		 * (corr_cache value). Tools correcting many unrelated positions
+		 * shall call it, as the correction cache would be rebuilt for
+		 * every position.
+		 */
+		void disableCorrectionCache () { corrCacheStep->setValueDouble (0); }
+
 		/**
 		 * If aberation should be calculated in RTS2.
 		 */
@@ -1194,6 +1203,23 @@ class Telescope:public rts2core::Device
 		rts2core::ValueBool *calRefraction;
 		rts2core::ValueBool *calModel;
 
+		CorrectionCache corrCache;
+
+		rts2core::ValueDouble *corrCacheStep;
+		rts2core::ValueBool *corrCacheCheck;
+		rts2core::ValueDouble *corrCacheLimit;
+		rts2core::ValueDouble *corrCacheError;
+
+		/**
+		 * Apply precession, nutation and aberation, as configured by CAL_ values.
+		 */
+		void applyAstrometry (struct ln_equ_posn *pos, double JD, bool writeValues);
+
+		/**
+		 * Calculate nodes of the correction cache for the position.
+		 */
+		void refreshCorrectionCache (struct ln_equ_posn *pos, double JD, int mask, bool writeValues);
+
 		rts2core::StringArray *cupolas;
 
 		rts2core::StringArray *rotators;
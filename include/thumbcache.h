@@ -0,0 +1,169 @@
+/*
+ * On-disk cache of image thumbnails.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_THUMBCACHE__
+#define __RTS2_THUMBCACHE__
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace rts2core
+{
+
+/**
+ * Content-addressed cache of rendered image previews, stored as files in a
+ * cache directory. Cache file name is a hash of key, which describes the
+ * source file and parameters used to render the preview. Least recently
+ * used files are removed when total size of the cache exceeds its byte
+ * budget.
+ *
+ * As files are named only by their key, several processes can share a
+ * cache directory - e.g. rts2-imgproc pre-generates previews of processed
+ * images, which are then served by rts2-httpd. Files added by other
+ * processes are found on first lookup.
+ *
+ * Methods can be called from multiple threads.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ThumbnailCache
+{
+	public:
+		/**
+		 * @param _dir     cache directory; created by init if it does not exist
+		 * @param _budget  maximal size of the cache in bytes
+		 */
+		ThumbnailCache (const char *_dir, size_t _budget);
+
+		~ThumbnailCache ();
+
+		/**
+		 * Create cache directory and load list of cached files.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int init ();
+
+		/**
+		 * Construct key for preview of a file. File is identified by
+		 * its device, inode, modification time and size, so the key
+		 * stays valid when file is renamed (e.g. moved to archive),
+		 * and becomes invalid when file is modified.
+		 *
+		 * @param st             stat of the source file
+		 * @param prevsize       preview size, 0 for full size image
+		 * @param label          label written to the preview
+		 * @param quantiles      quantiles used for image scaling
+		 * @param chan           image channel, -1 for all channels
+		 * @param colourVariant  colour variant
+		 */
+		static std::string makeKey (const struct stat &st, int prevsize, const char *label, float quantiles, int chan, int colourVariant);
+
+		/**
+		 * Open cached data.
+		 *
+		 * @param key     cache key
+		 * @param length  returns length of the cached data
+		 *
+		 * @return file descriptor opened for reading, -1 if data are not in the cache
+		 */
+		int get (const std::string &key, size_t &length);
+
+		/**
+		 * Store data in the cache. Data are written to temporary file,
+		 * which is renamed to the cache file, so readers never see
+		 * partial data.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int put (const std::string &key, const void *data, size_t length);
+
+		/**
+		 * Set new budget. Evicts files if needed.
+		 */
+		void setBudget (size_t _budget);
+
+		size_t getBudget () { return budget; }
+
+		/**
+		 * Switch cache to another directory. Index of cached files
+		 * is reloaded from the new directory.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int setDirectory (const char *_dir);
+
+		/**
+		 * Total size of cached files, in bytes.
+		 */
+		size_t getSize ();
+
+		size_t getEntries ();
+
+		unsigned long getHits ();
+		unsigned long getMisses ();
+
+		const char *getDirectory () { return dir.c_str (); }
+
+	private:
+		struct Entry
+		{
+			size_t length;
+			std::list <std::string>::iterator lru;
+		};
+
+		std::string dir;
+
+		// protects all members below
+		pthread_mutex_t mutex;
+
+		size_t budget;
+		size_t size;
+
+		unsigned long hits;
+		unsigned long misses;
+
+		std::map <std::string, Entry> entries;
+		// cache file names, most recently used first
+		std::list <std::string> lru;
+
+		/**
+		 * Returns cache file name (without directory) for a key.
+		 */
+		static std::string fileName (const std::string &key);
+
+		std::string filePath (const std::string &name) { return dir + "/" + name; }
+
+		void add (const std::string &name, size_t length);
+		void remove (std::map <std::string, Entry>::iterator iter);
+
+		/**
+		 * Remove least recently used files until cache fits into budget.
+		 */
+		void evict ();
+};
+
+}
+
+#endif // !__RTS2_THUMBCACHE__
@@ -0,0 +1,138 @@
+/*
+ * Indexed timer queue.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_TIMERQUEUE__
+#define __RTS2_TIMERQUEUE__
+
+#include "event.h"
+
+#include <list>
+#include <map>
+#include <vector>
+
+namespace rts2core
+{
+
+/**
+ * Timer handle, returned from TimerQueue::add. 0 is never used as valid handle.
+ */
+typedef unsigned long timer_id_t;
+
+/**
+ * Queue of timed events. Events are stored in binary heap ordered by
+ * their time (and insertion order for events with the same time). Every
+ * entry is indexed by its handle and by its event type, so events can be
+ * cancelled without traversing the whole queue.
+ *
+ * Queue owns events added to it - cancelled events and events pending at
+ * queue destruction are deleted.
+ *
+ * @ingroup RTS2Block
+ */
+class TimerQueue
+{
+	public:
+		TimerQueue ();
+		~TimerQueue ();
+
+		/**
+		 * Add event to queue.
+		 *
+		 * @param t      time (ctime, with fractional seconds) when the event shall be triggered
+		 * @param event  event to trigger
+		 *
+		 * @return handle of the timer
+		 */
+		timer_id_t add (double t, Event *event);
+
+		/**
+		 * Cancel timer with given handle and delete its event.
+		 *
+		 * @return true if timer was found in the queue
+		 */
+		bool cancel (timer_id_t id);
+
+		/**
+		 * Cancel all timers with events of given type, delete their events.
+		 *
+		 * @return number of cancelled timers
+		 */
+		int cancelType (int event_type);
+
+		bool empty () { return heap.empty (); }
+
+		size_t size () { return heap.size (); }
+
+		/**
+		 * Time of the first timer. Queue must not be empty.
+		 */
+		double nextTime () { return heap.front ()->t; }
+
+		/**
+		 * Remove first event from the queue, if it should be triggered
+		 * before given time. Caller takes ownership of the returned event.
+		 *
+		 * @param now        current time
+		 * @param scheduled  time for which returned event was scheduled
+		 *
+		 * @return NULL if no timer is due, otherwise event which should be triggered
+		 */
+		Event *popDue (double now, double &scheduled);
+
+	private:
+		struct TimerEntry
+		{
+			double t;
+			timer_id_t id;
+			size_t pos;
+			Event *event;
+			std::list <TimerEntry *>::iterator typeIter;
+		};
+
+		// heap of timers, ordered by time and id
+		std::vector <TimerEntry *> heap;
+
+		std::map <timer_id_t, TimerEntry *> ids;
+		std::map <int, std::list <TimerEntry *> > types;
+
+		timer_id_t lastId;
+
+		bool before (TimerEntry *a, TimerEntry *b)
+		{
+			return a->t < b->t || (a->t == b->t && a->id < b->id);
+		}
+
+		void place (TimerEntry *entry, size_t pos)
+		{
+			heap[pos] = entry;
+			entry->pos = pos;
+		}
+
+		void siftUp (size_t pos);
+		void siftDown (size_t pos);
+
+		/**
+		 * Remove entry from heap and indices. Does not delete entry's event.
+		 */
+		void remove (TimerEntry *entry);
+};
+
+}
+
+#endif // !__RTS2_TIMERQUEUE__
@@ -84,6 +84,11 @@ class StringArray: public ValueArray
 
 		size_t size () { return value.size (); }
 
+		void clear () {
+			value.clear ();
+			changed ();
+		}
+
 		/**
 		 * Returns true if given string is present in the array.
 		 *
@@ -23,6 +23,7 @@
 #include "value.h"
 
 #include <deque>
+#include <set>
 
 namespace rts2core
 {
@@ -75,18 +76,21 @@ class ValueDoubleStat:public ValueDouble
 
 		double getStdev () { return stdev; }
 
-		std::deque < double >&getMesList () { return valueList; }
+		/**
+		 * Return list of measurements, in order they were added. The
+		 * list must not be modified directly, as sorted copy of the
+		 * values and running sums are kept for calculation of the
+		 * statistics.
+		 */
+		const std::deque < double >&getMesList () { return valueList; }
 
 		/**
-		 * Add value to the measurement values.
+		 * Add value to the measurement values. NaN values are ignored,
+		 * as they cannot be ordered.
 		 *
 		 * @param in_val Value which will be added.
 		 */
-		void addValue (double in_val)
-		{
-			valueList.push_back (in_val);
-			changed ();
-		}
+		void addValue (double in_val);
 
 		/**
 		 * Add value to the measurement values. If queue size is greater than
@@ -95,12 +99,8 @@ class ValueDoubleStat:public ValueDouble
 		 * @param in_val        Value which will be added.
 		 * @param maxQueSize    Maximal queue size.
 		 */
-		void addValue (double in_val, size_t maxQueSize)
-		{
-			while (valueList.size () >= maxQueSize)
-				valueList.pop_front ();
-			addValue (in_val);
-		}
+		void addValue (double in_val, size_t maxQueSize);
+
 		std::deque <double>::iterator valueBegin () { return valueList.begin (); }
 		std::deque <double>::iterator valueEnd () { return valueList.end (); }
 	private:
@@ -110,6 +110,32 @@ class ValueDoubleStat:public ValueDouble
 		double max;
 		double stdev;
 		std::deque < double >valueList;
+
+		// sorted values - lower half (including median for odd number of values) and upper half
+		std::multiset < double >lowerHalf;
+		std::multiset < double >upperHalf;
+
+		// running sums of values and squares of values, offseted by shift to avoid loss of precision
+		double shift;
+		double sum;
+		double sum2;
+		// number of values removed since sums were last recalculated
+		size_t removed;
+
+		void insertSorted (double in_val);
+		void eraseSorted (double in_val);
+
+		/**
+		 * Keep lowerHalf and upperHalf sizes equal, or lowerHalf one
+		 * element larger.
+		 */
+		void balanceSorted ();
+
+		/**
+		 * Recalculate running sums from value list, so rounding
+		 * errors do not accumulate.
+		 */
+		void resetSums ();
 };
 
 /**
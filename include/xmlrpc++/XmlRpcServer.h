@@ -27,6 +27,11 @@
 #include "XmlRpcSource.h"
 
 
+// return values of XmlRpcServer::offloadGet
+#define OFFLOAD_INLINE      0
+#define OFFLOAD_QUEUED      1
+#define OFFLOAD_BUSY        2
+
 namespace XmlRpc
 {
 
@@ -129,6 +134,21 @@ namespace XmlRpc
 			//! Remove a connection from the dispatcher
 			virtual void removeConnection(XmlRpcServerConnection*);
 
+			/**
+			 * Called before GET request is executed. Server can execute
+			 * the request outside of the main loop, e.g. on a worker
+			 * thread. Queued connection waits until
+			 * XmlRpcServerConnection::offloadFinished is called from the
+			 * main loop.
+			 *
+			 * @param source   connection which received the request
+			 * @param request  request handler
+			 * @param heavy    true if handler marked the request as heavy
+			 *
+			 * @return OFFLOAD_INLINE to execute request immediately, OFFLOAD_QUEUED if request was queued, OFFLOAD_BUSY if it cannot be accepted now
+			 */
+			virtual int offloadGet(XmlRpcServerConnection* source, XmlRpcServerGetRequest* request, bool heavy) { return OFFLOAD_INLINE; }
+
 		protected:
 
 			//! Accept a client connection request
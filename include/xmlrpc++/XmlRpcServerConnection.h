@@ -24,6 +24,8 @@ namespace XmlRpc
 	// The server waits for client connections and provides methods
 	class XmlRpcServer;
 	class XmlRpcServerMethod;
+	class XmlRpcServerGetRequest;
+	class HttpParams;
 
 	//! A class to handle XML RPC requests from a particular client
 	class XmlRpcServerConnection : public XmlRpcSource
@@ -89,6 +91,36 @@ namespace XmlRpc
 			// Set response
 			void setResponse(char *_response, size_t _response_length);
 
+			/**
+			 * Send part of file as response to GET request. Data are
+			 * written directly from file to socket (with sendfile, when
+			 * available), so file content is never loaded to memory. Range
+			 * requests are resolved against the file part. Connection takes
+			 * ownership of the file descriptor and closes it once response
+			 * was sent.
+			 *
+			 * @param fd      open file descriptor
+			 * @param offset  offset of the first byte to send
+			 * @param length  number of bytes to send
+			 */
+			void setResponseFile(int fd, off_t offset, size_t length);
+
+			/**
+			 * Execute GET request and prepare response. Called from
+			 * executeGet, or from worker thread for requests offloaded by
+			 * the server.
+			 *
+			 * @param request  request handler, NULL if there is no handler for the path
+			 */
+			void executeGetRequest(XmlRpcServerGetRequest* request);
+
+			/**
+			 * Resume connection waiting for offloaded GET request. Writes
+			 * response if the request was executed, otherwise executes the
+			 * request again. Must be called from the main loop.
+			 */
+			void offloadFinished();
+
 			// Switch connection to chunged response mode.
 			void goChunked () { _contentLength = -1; }
 
@@ -104,6 +136,9 @@ namespace XmlRpc
 			bool writeResponse();
 			bool writeAsyncReponse();
 
+			// Write next part of GET response body, returns -1 on error
+			int writeGetResponse();
+
 			// Parses the request, runs the method, generates the response xml.
 			virtual void executeRequest();
 
@@ -168,6 +203,20 @@ namespace XmlRpc
 			char *_get_response;
 			size_t _get_response_length;
 
+			// Response for GET request - file descriptor (-1 if response is in _get_response) and offset of the data
+			int _get_response_file;
+			off_t _get_response_offset;
+
+			// Requested byte range; -1 if not specified, _rangeFrom is -2 for suffix range (last _rangeTo bytes)
+			long long _rangeFrom;
+			long long _rangeTo;
+
+			// State in which GET request was received (GET_REQUEST or POST_REQUEST), restored after offloaded request finished
+			ServerConnectionState _requestState;
+
+			// True if GET response was prepared
+			bool _getExecuted;
+
 			// Number of bytes written for GET header and response so far
 			size_t _getHeaderWritten;
 			size_t _getWritten;
@@ -183,6 +232,17 @@ namespace XmlRpc
 #endif
 			// prepare to receive next data
 			void prepareForNext ();
+
+			void closeResponseFile ();
+
+			// Apply requested range to file response, returns HTTP code
+			int applyRange ();
+
+			// Split GET request to path and parameters
+			void parseGet (XmlRpcServerGetRequest *request, std::string &path, HttpParams &params);
+
+			// Fill GET response header
+			void generateGetHeader (int http_code, const char *response_type);
 	};
 
 
@@ -19,8 +19,11 @@
 #include "XmlRpcServerConnection.h"
 
 #define HTTP_OK              200
+#define HTTP_PARTIAL_CONTENT 206
 #define HTTP_BAD_REQUEST     400
 #define HTTP_UNAUTHORIZED    401
+#define HTTP_RANGE_NOT_SATISFIABLE 416
+#define HTTP_SERVICE_UNAVAILABLE   503
 
 namespace XmlRpc
 {
@@ -112,6 +115,18 @@ namespace XmlRpc
 			//! Returns 401 page
 			virtual void authorizePage(int &http_code, const char* &response_type, char* &response, size_t &response_length);
 
+			/**
+			 * Returns true if request is expensive to execute - renders
+			 * images or plots, or runs long database queries. Server can
+			 * execute such requests outside of its main loop, see
+			 * XmlRpcServer::offloadGet. Heavy requests must not send
+			 * asynchronous or chunked responses.
+			 *
+			 * @param path    request path, excluding prefix
+			 * @param params  request parameters
+			 */
+			virtual bool isHeavy (const std::string &path, HttpParams *params) { return false; }
+
 			void setConnection (XmlRpcServerConnection *_connection) { connection = _connection; }
 
 			//! Send JSON to XmlRpcSource connection. Re-enables read mask (as async call finished)
@@ -126,6 +141,21 @@ namespace XmlRpc
 			XmlRpcServerConnection *connection;
 
 			void addExtraHeader (const char *name, const char *value) { connection->addExtraHeader (name, value); }
+
+			/**
+			 * Send file as response. Connection takes ownership of the file
+			 * descriptor. Sets response to NULL and response_length to file length,
+			 * so execute methods can call it instead of filling the response buffer.
+			 *
+			 * @param fd      open file descriptor, positioned anywhere
+			 * @param length  file length
+			 */
+			void setResponseFile (int fd, size_t length, char* &response, size_t &response_length)
+			{
+				connection->setResponseFile (fd, 0, length);
+				response = NULL;
+				response_length = length;
+			}
 			/**
 			 * Specify max age in seconds. For this time cached response will be valid. This method
 			 * is provide for convinient setting of cache timeout.
@@ -22,6 +22,9 @@ extern "C"
 }
 #endif
 
+//! Maximal number of file bytes written in one call to XmlRpcSocket::nbSendFile
+#define SEND_FILE_WINDOW    (1024 * 1024)
+
 namespace XmlRpc
 {
 
@@ -36,6 +39,9 @@ namespace XmlRpc
 			//! Closes a socket.
 			static void close(int socket);
 
+			//! Sets function called before a socket is closed, so an event loop can forget the descriptor.
+			static void setCloseHook(void (*closeHook) (int));
+
 			//! Sets a stream (TCP) socket to perform non-blocking IO. Returns false on failure.
 			static bool setNonBlocking(int socket);
 
@@ -51,6 +57,15 @@ namespace XmlRpc
 			//! Write buffer to the specified socket. Returns false on error.
 			static size_t nbWriteBuf(int socket, const char *buf, size_t buf_len, size_t *bytesSoFar, bool sendfull = true, bool retry = true);
 
+			//! Write part of file to the specified socket, using sendfile when available.
+			//! Writes at most SEND_FILE_WINDOW bytes, does not wait for socket to become writable.
+			//!   @param file        file descriptor
+			//!   @param offset      offset of the first byte to send
+			//!   @param length      number of bytes to send
+			//!   @param bytesSoFar  bytes already written, updated by number of bytes written
+			//! Returns -1 on error, 0 on success (including no data written).
+			static int nbSendFile(int socket, int file, off_t offset, size_t length, size_t *bytesSoFar);
+
 			// The next four methods are appropriate for servers.
 
 			//! Allow the port the specified socket is bound to to be re-bound immediately 
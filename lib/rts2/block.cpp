@@ -39,6 +39,7 @@
 
 #include "imghdr.h"
 #include "centralstate.h"
+#include "option.h"
 
 //* Null terminated list of names for different device types.
 const char *type_names[] = 
@@ -61,8 +62,19 @@ Block::Block (int in_argc, char **in_argv):App (in_argc, in_argv)
 	fds = new struct pollfd[pollsize];
 	npolls = 0;
 
+	useEpoll = false;
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	epfd = -1;
+
+	addOption (OPT_EPOLL, "epoll", 0, "use epoll instead of ppoll to wait for events on connections");
+#endif
+
 	signal (SIGPIPE, SIG_IGN);
 
+	timersTriggered = 0;
+	timersLatenessSum = 0;
+	timersLatenessMax = 0;
+
 	masterState = SERVERD_HARD_OFF;
 	stateMasterConn = NULL;
 	// allocate ports dynamically
@@ -92,6 +104,25 @@ Block::~Block (void)
 		delete *iu;
 	delete[] fds;
 	blockUsers.clear ();
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (epfd >= 0)
+		close (epfd);
+#endif
+}
+
+int Block::processOption (int in_opt)
+{
+	switch (in_opt)
+	{
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+		case OPT_EPOLL:
+			useEpoll = true;
+			break;
+#endif
+		default:
+			return App::processOption (in_opt);
+	}
+	return 0;
 }
 
 void Block::setPort (int in_port)
@@ -107,7 +138,7 @@ int Block::getPort (void)
 void Block::addPollSocks ()
 {
 	connections_t::iterator iter;
-	npolls = 0;
+	clearPollFDs ();
 	for (iter = connections.begin (); iter != connections.end (); iter++)
 		(*iter)->add (this);
 	for (iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
@@ -285,24 +316,21 @@ int Block::idle ()
 	}
 
 	// test for any pending timers..
-	std::map <double, Event *>::iterator iter_t = timers.begin ();
-	while (iter_t != timers.end () && iter_t->first < getNow ())
-	{
-		if (pushToDelete (iter_t))
-		{
-			Event *sec = iter_t->second;
-		 	if (sec->getArg () != NULL)
-			  	((Object *)sec->getArg ())->postEvent (sec);
-			else
-				postEvent (sec);
-		}
-		iter_t++;
-	}
-
-	// delete timers queue for delete
-	for (std::vector <std::map <double, Event *>::iterator>::iterator iter_d = toDelete.begin (); iter_d != toDelete.end (); iter_d = toDelete.erase (iter_d))
+	double now = getNow ();
+	double scheduled;
+	Event *sec;
+	while ((sec = timers.popDue (now, scheduled)) != NULL)
 	{
-		timers.erase (*iter_d);
+		double lateness = now - scheduled;
+		timersTriggered++;
+		timersLatenessSum += lateness;
+		if (lateness > timersLatenessMax)
+			timersLatenessMax = lateness;
+
+	 	if (sec->getArg () != NULL)
+		  	((Object *)sec->getArg ())->postEvent (sec);
+		else
+			postEvent (sec);
 	}
 
 	return 0;
@@ -379,7 +407,7 @@ void Block::oneRunLoop ()
 	struct timespec read_tout;
 	double t_diff;
 
-	if (timers.begin () != timers.end () && (USEC_SEC * (t_diff = (timers.begin ()->first - getNow ()))) < idle_timeout)
+	if (!timers.empty () && (USEC_SEC * (t_diff = (timers.nextTime () - getNow ()))) < idle_timeout)
 	{
 		if (t_diff <= 0)
 		{
@@ -406,8 +434,15 @@ void Block::oneRunLoop ()
 		}
 	}
 
+	// renew write budgets of connections for this iteration
+	connections_t::iterator iter;
+	for (iter = connections.begin (); iter != connections.end (); iter++)
+		(*iter)->resetWriteBudget ();
+	for (iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
+		(*iter)->resetWriteBudget ();
+
 	addPollSocks ();
-	if (ppoll (fds, npolls, &read_tout, NULL) > 0)
+	if (waitPollFDs (&read_tout) > 0)
 		pollSuccess ();
 	ret = idle ();
 	if (ret == -1)
@@ -511,23 +546,186 @@ void Block::addPollFD (int fd, short events)
 		memcpy ((void *) npollfds, (void *) fds, sizeof (struct pollfd) * npolls);
 		delete[] fds;
 		fds = npollfds;
+		pollsize = npolls + POLLS_SIZE;
 	}
 	fds[npolls].fd = fd;
 	fds[npolls].events = events;
 	fds[npolls].revents = 0;
 	npolls++;
+
+	if (fd < 0)
+		return;
+	if ((size_t) fd >= pollIndex.size ())
+		pollIndex.resize (fd + POLLS_SIZE, 0);
+	// getPollEvents returns events of the first entry, as linear search did
+	if (pollIndex[fd] == 0)
+		pollIndex[fd] = npolls;
+}
+
+void Block::pollFDClosed (int fd)
+{
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (fd < 0 || (size_t) fd >= epollRegistered.size () || epollRegistered[fd] == 0)
+		return;
+	// descriptor is already removed from epoll set by close call, just forget it
+	epollRegistered[fd] = 0;
+	std::vector <int>::iterator iter = std::find (epollFds.begin (), epollFds.end (), fd);
+	if (iter != epollFds.end ())
+		epollFds.erase (iter);
+#endif
 }
 
-short Block::getPollEvents (int fd)
+void Block::clearPollFDs ()
 {
 	for (nfds_t i = 0; i < npolls; i++)
 	{
-		if (fds[i].fd == fd)
-			return fds[i].revents;
+		if (fds[i].fd >= 0 && (size_t) fds[i].fd < pollIndex.size ())
+			pollIndex[fds[i].fd] = 0;
 	}
-	return 0;
+	npolls = 0;
+}
+
+int Block::waitPollFDs (const struct timespec *read_tout)
+{
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (useEpoll)
+	{
+		if (epfd < 0)
+		{
+			epfd = epoll_create1 (EPOLL_CLOEXEC);
+			if (epfd < 0)
+			{
+				logStream (MESSAGE_ERROR) << "cannot create epoll descriptor, falling back to ppoll: " << strerror (errno) << sendLog;
+				useEpoll = false;
+			}
+		}
+		if (epfd >= 0)
+		{
+			int ret = epollWait (read_tout);
+			if (ret != -2)
+				return ret;
+		}
+	}
+#endif
+	return ppoll (fds, npolls, read_tout, NULL);
 }
 
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+int Block::epollWait (const struct timespec *read_tout)
+{
+	nfds_t i;
+	int fd;
+	bool duplicates = false;
+	struct epoll_event ev;
+
+	// compute events requested for each descriptor, merge duplicate entries
+	std::vector <int> requested;
+	for (i = 0; i < npolls; i++)
+	{
+		fd = fds[i].fd;
+		if (fd < 0)
+			continue;
+		if ((size_t) fd >= epollRegistered.size ())
+		{
+			epollRegistered.resize (fd + POLLS_SIZE, 0);
+			epollRequested.resize (fd + POLLS_SIZE, 0);
+		}
+		if (pollIndex[fd] == i + 1)
+			requested.push_back (fd);
+		else
+			duplicates = true;
+		epollRequested[fd] |= fds[i].events | EPOLLERR | EPOLLHUP;
+	}
+
+	// remove descriptors which are no longer polled
+	for (std::vector <int>::iterator iter = epollFds.begin (); iter != epollFds.end (); iter++)
+	{
+		fd = *iter;
+		if (epollRequested[fd] != 0)
+			continue;
+		epoll_ctl (epfd, EPOLL_CTL_DEL, fd, &ev);
+		epollRegistered[fd] = 0;
+	}
+
+	epollFds.clear ();
+
+	int ret = 0;
+
+	// add new descriptors and modify changed
+	for (std::vector <int>::iterator iter = requested.begin (); iter != requested.end (); iter++)
+	{
+		fd = *iter;
+		ev.events = epollRequested[fd];
+		ev.data.fd = fd;
+		epollRequested[fd] = 0;
+		if (ret)
+		{
+			// keep track of descriptors still registered after failure
+			if (epollRegistered[fd] != 0)
+				epollFds.push_back (fd);
+			continue;
+		}
+		if (epollRegistered[fd] == 0)
+		{
+			ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fd, &ev);
+			if (ret && errno == EEXIST)
+				ret = epoll_ctl (epfd, EPOLL_CTL_MOD, fd, &ev);
+		}
+		else if (epollRegistered[fd] != ev.events)
+		{
+			ret = epoll_ctl (epfd, EPOLL_CTL_MOD, fd, &ev);
+			// descriptor was closed and reopened without pollFDClosed call
+			if (ret && errno == ENOENT)
+				ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fd, &ev);
+		}
+		if (ret)
+		{
+			// regular files and some devices cannot be used with epoll
+			epollRegistered[fd] = 0;
+			continue;
+		}
+		epollRegistered[fd] = ev.events;
+		epollFds.push_back (fd);
+	}
+
+	if (ret)
+		return -2;
+
+	if (epollReady.size () <= epollFds.size ())
+		epollReady.resize (epollFds.size () + 1);
+
+	int tout_ms = read_tout->tv_sec * 1000 + (read_tout->tv_nsec + 999999) / 1000000;
+
+	ret = epoll_wait (epfd, &(epollReady[0]), epollReady.size (), tout_ms);
+	if (ret <= 0)
+		return ret;
+
+	// epoll and poll event flags have the same values
+	if (duplicates)
+	{
+		for (int j = 0; j < ret; j++)
+			epollRequested[epollReady[j].data.fd] = epollReady[j].events;
+		for (i = 0; i < npolls; i++)
+		{
+			fd = fds[i].fd;
+			if (fd >= 0)
+				fds[i].revents = epollRequested[fd] & (fds[i].events | POLLERR | POLLHUP);
+		}
+		for (int j = 0; j < ret; j++)
+			epollRequested[epollReady[j].data.fd] = 0;
+	}
+	else
+	{
+		for (int j = 0; j < ret; j++)
+		{
+			fd = epollReady[j].data.fd;
+			fds[pollIndex[fd] - 1].revents = epollReady[j].events;
+		}
+	}
+	return ret;
+}
+#endif
+
 bool Block::centralServerInState (rts2_status_t state)
 {
 	for (connections_t::iterator iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
@@ -988,17 +1186,22 @@ bool Block::commandOriginatorPending (Object * object, Connection * exclude_conn
 	return false;
 }
 
-void Block::deleteTimers (int event_type)
+int Block::getTimersLateness (double &avg, double &max)
 {
-	for (std::map <double, Event *>::iterator iter = timers.begin (); iter != timers.end (); )
+	int ret = timersTriggered;
+	if (timersTriggered > 0)
 	{
-		if (iter->second->getType () == event_type)
-		{
-			if (pushToDelete (iter))
-				delete (iter->second);
-		}
-		iter++;
+		avg = timersLatenessSum / timersTriggered;
+		max = timersLatenessMax;
+	}
+	else
+	{
+		avg = max = NAN;
 	}
+	timersTriggered = 0;
+	timersLatenessSum = 0;
+	timersLatenessMax = 0;
+	return ret;
 }
 
 void Block::valueMaskError (Value *val, int32_t err)
@@ -1010,17 +1213,6 @@ void Block::valueMaskError (Value *val, int32_t err)
 	}
 }
 
-bool Block::pushToDelete (const std::map <double, Event *>::iterator &iter)
-{
-	// only push unique iterators
-	if (std::find (toDelete.begin (), toDelete.end (), iter) == toDelete.end ())
-	{
-		toDelete.push_back (iter);
-		return true;
-	}
-	return false;
-}
-
 bool isCentraldName (const char *_name)
 {
 	return !strcmp (_name, "..") || !strcmp (_name, "centrald");
@@ -1036,3 +1228,8 @@ short getMasterGetEvents (int fd)
 	return ((Block *) getMasterApp ())->getPollEvents (fd);
 }
 
+void getMasterPollFDClosed (int fd)
+{
+	((Block *) getMasterApp ())->pollFDClosed (fd);
+}
+
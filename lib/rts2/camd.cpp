@@ -164,8 +164,6 @@ long Camera::isExposing ()
 
 int Camera::endExposure (int ret)
 {
-	if (modeCount)
-		memset (modeCount, 0, modeCountSize * sizeof (uint32_t));
 	if (exposureConn)
 	{
 		logStream (MESSAGE_INFO) << "end exposure for " << exposureConn->getName () << sendLog;
@@ -321,6 +319,9 @@ void Camera::startImageData (rts2core::Connection * conn)
 		currentImageData = conn->startBinaryData (dataType->getValueInteger (), chnTot, chansize);
 		currentImageTransfer = TCPIP;
 	}
+	// image data are written from the main loop, in chunks limited by the budget
+	if (currentImageTransfer == TCPIP)
+		conn->setWriteBudget (dataBudget->getValueLong () > 0 ? dataBudget->getValueLong () : 0);
 	exposureConn = conn;
 }
 
@@ -353,10 +354,13 @@ int Camera::sendFirstLine (int chan, int pchan)
 	focusingHeader->channel = htons (pchan);
 
 	sum->setValueDouble (0);
+	sumSquares = 0;
 	average->setValueDouble (0);
 	max->setValueDouble (-LONG_MAX);
 	min->setValueDouble (LONG_MAX);
 	computedPix->setValueLong (0);
+	// also clears histogram
+	histogram.setBins (histogramBins->getValueInteger ());
 
 	switch (currentImageTransfer)
 	{
@@ -462,15 +466,26 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 	calculateStatistics->addSelVal ("no");
 	calculateStatistics->setValueInteger (STATISTIC_YES);
 
+	createValue (dataBudget, "data_budget", "maximal size of image data written to client in one loop iteration; 0 for no limit", false, RTS2_VALUE_WRITABLE | RTS2_DT_BYTESIZE);
+	dataBudget->setValueLong (1024 * 1024);
+
 	createValue (average, "average", "image average", false);
 	createValue (max, "max", "maximum pixel value", false);
 	createValue (min, "min", "minimal pixel value", false);
 	createValue (sum, "sum", "sum of pixels readed out", false);
 	createValue (image_mode, "image_mode", "mode (most often pixel value)", false);
-
-	// mode histogram
-	modeCount = NULL;
-	modeCountSize = 0;
+	createValue (stdev, "stdev", "standard deviation of pixels readed out", false);
+	sumSquares = 0;
+	createValue (image_median, "image_median", "image median", false);
+	createValue (quantiles, "quantiles", "quantiles calculated from image histogram", false, RTS2_VALUE_WRITABLE);
+	quantiles->addValue (0.05);
+	quantiles->addValue (0.25);
+	quantiles->addValue (0.75);
+	quantiles->addValue (0.95);
+	createValue (image_quantiles, "image_quantiles", "values of image quantiles", false);
+
+	createValue (histogramBins, "histogram_bins", "number of bins of histogram used to calculate mode, median and quantiles", false, RTS2_VALUE_WRITABLE);
+	histogramBins->setValueInteger (histogram.getBins ());
 
 	createValue (computedPix, "computed", "number of pixels so far computed", false);
 
@@ -582,8 +597,6 @@ Camera::~Camera ()
 
 	delete[] dataBuffers;
 	delete[] dataWritten;
-	
-	delete[] modeCount;
 }
 
 int Camera::willConnect (rts2core::NetworkAddress * in_addr)
@@ -996,23 +1009,22 @@ int Camera::sendReadoutData (char *data, size_t dataSize, int chan)
 		}
 		computedPix->setValueLong (computedPix->getValueLong () + totPix);
 		average->setValueDouble (sum->getValueDouble () / computedPix->getValueLong ());
+		stdev->setValueDouble (sqrt (fabs (sumSquares / computedPix->getValueLong () - average->getValueDouble () * average->getValueDouble ())));
 
-		// find maximal mode value
-		if (modeCount != NULL)
+		if (histogram.getCount () > 0)
 		{
-			uint32_t modeNum = 0;
-			for (unsigned int i = 0; i < modeCountSize; i++)
-			{
-				if (modeCount[i] > modeNum)
-				{
-					image_mode->setValueInteger (i);
-					modeNum = modeCount[i];
-				}
-			}
+			image_mode->setValueDouble (histogram.getMode ());
+			image_median->setValueDouble (histogram.getMedian ());
+			image_quantiles->clear ();
+			for (size_t i = 0; i < quantiles->size (); i++)
+				image_quantiles->addValue (histogram.getQuantile ((*quantiles)[i]));
 			sendValueAll (image_mode);
+			sendValueAll (image_median);
+			sendValueAll (image_quantiles);
 		}
 
 		sendValueAll (average);
+		sendValueAll (stdev);
 		sendValueAll (max);
 		sendValueAll (min);
 		sendValueAll (sum);
@@ -1360,6 +1372,12 @@ void Camera::checkReadouts ()
 	int ret;
 	if ((getStateChip (0) & CAM_MASK_READING) != CAM_READING)
 		return;
+	// client does not read image data fast enough, do not produce more until queued data are sent
+	if (exposureConn && currentImageTransfer == TCPIP && exposureConn->getBinaryQueuedSize () > WRITE_BUFFER_BINARY_MAX)
+	{
+		setTimeout (USEC_SEC / 100);
+		return;
+	}
 	ret = doReadout ();
 	if (ret >= 0)
 	{
@@ -1398,6 +1416,21 @@ int Camera::setValue (rts2core::Value * old_value, rts2core::Value * new_value)
 			offsetForFilter (new_value->getValueInteger (), camFilterVals.end ());
 		return ret;
 	}
+	if (old_value == histogramBins)
+	{
+		// bins are allocated at readout start
+		return (new_value->getValueInteger () >= 2 && new_value->getValueInteger () <= (1 << 24)) ? 0 : -2;
+	}
+	if (old_value == quantiles)
+	{
+		rts2core::DoubleArray *nq = (rts2core::DoubleArray *) new_value;
+		for (size_t i = 0; i < nq->size (); i++)
+		{
+			if ((*nq)[i] < 0 || (*nq)[i] > 1)
+				return -2;
+		}
+		return 0;
+	}
 	int i = 0;
 	for (std::list <FilterVal>::iterator iter = camFilterVals.begin (); iter != camFilterVals.end (); iter++, i++)
 	{
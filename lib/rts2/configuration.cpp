@@ -57,6 +57,8 @@ int Configuration::getSpecialValues ()
 
 	getString ("observatory", "header_replace", obs_header_replace, "");
 
+	writeQueue = getIntegerDefault ("observatory", "write_queue", 2);
+
 	getString ("observatory", "target_path", targetDir, RTS2_PREFIX "/etc/rts2/targets");
 	masterConsFile = targetDir + "/constraints.xml";
 
@@ -96,6 +98,7 @@ Configuration::Configuration (bool defaultSection):IniParser (defaultSection)
 	checker = NULL;
 	// default to 120 seconds
 	astrometryTimeout = 120;
+	writeQueue = 0;
 	targetConstraintsWithName = false;
 	showMilliseconds = true;
 }
@@ -29,6 +29,7 @@
 #include "valuerectangle.h"
 #include "valuearray.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <errno.h>
@@ -95,6 +96,12 @@ Connection::Connection (Block * in_master):Object ()
 	activeReadData = -1;
 	dataConn = 0;
 
+	writeBufferStart = 0;
+	writeBinaryEnd = 0;
+	writeBudget = 0;
+	writtenInLoop = 0;
+	binaryQueued = 0;
+
 	sharedReadMemory = NULL;
 }
 
@@ -137,13 +144,26 @@ Connection::Connection (int in_sock, Block * in_master):Object ()
 	activeReadData = -1;
 	dataConn = 0;
 
+	writeBufferStart = 0;
+	writeBinaryEnd = 0;
+	writeBudget = 0;
+	writtenInLoop = 0;
+	binaryQueued = 0;
+
 	sharedReadMemory = NULL;
 }
 
 Connection::~Connection (void)
 {
 	if (sock >= 0)
+	{
+		// try to deliver last messages (e.g. reply to exit command)
+		if (writeBufferSize () > 0 && !isConnState (CONN_INPROGRESS) && !isConnState (CONN_CONNECTING))
+			send (sock, writeBuffer.data () + writeBufferStart, writeBufferSize (), MSG_NOSIGNAL | MSG_DONTWAIT);
 		close (sock);
+		if (master)
+			master->pollFDClosed (sock);
+	}
 	delete serverState;
 	delete bopState;
 	queClear ();
@@ -154,10 +174,13 @@ Connection::~Connection (void)
 
 int Connection::add (Block *block)
 {
+	// write messages produced in the last loop iteration
+	if (sock >= 0 && writeBufferSize () > 0 && !isConnState (CONN_INPROGRESS) && !isConnState (CONN_CONNECTING))
+		flushWriteBuffer ();
 	if (sock >= 0)
 	{
 		short events = POLLIN | POLLPRI;
-		if (isConnState (CONN_INPROGRESS))
+		if (isConnState (CONN_INPROGRESS) || writeBufferSize () > 0)
 			events |= POLLOUT;
 		block->addPollFD (sock, events);
 	}
@@ -590,6 +613,7 @@ int Connection::acceptConn ()
 	else
 	{
 		close (sock);
+		master->pollFDClosed (sock);
 		sock = new_sock;
 		#ifdef DEBUG_EXTRA
 		logStream (MESSAGE_DEBUG) << "Connection::acceptConn connection accepted" << sendLog;
@@ -1082,6 +1106,10 @@ int Connection::writable (Block *block)
 			connConnected ();
 		}
 	}
+	else if (sock >= 0 && (block->getPollEvents (sock) & POLLOUT) && writeBufferSize () > 0 && !isConnState (CONN_CONNECTING))
+	{
+		return flushWriteBuffer ();
+	}
 	return 0;
 }
 
@@ -1477,8 +1505,6 @@ int Connection::commandReturn ()
 
 int Connection::sendMsg (const char *msg)
 {
-	int len;
-	int ret;
 	if (sock == -1)
 	{
 		#ifdef DEBUG_ALL
@@ -1486,44 +1512,131 @@ int Connection::sendMsg (const char *msg)
 		#endif
 		return -1;
 	}
-	len = strlen (msg) + 1;
-	char *mbuf = new char[len + 1];
-	strcpy (mbuf, msg);
 	#ifdef DEBUG_ALL
 	std::cout << "Connection::sendMsg will send " << msg << std::endl;
 	#endif
-	strcat (mbuf, "\n");
-	// ignore EINTR
-	do
+	// queued binary data do not count to the limit
+	if (writeTextSize () > WRITE_BUFFER_MAX)
 	{
-		ret = write (sock, mbuf, len);
-	} while (ret == -1 && errno == EINTR);
+		syslog (LOG_ERR, "Cannot send msg: %s to sock %i, %li bytes are waiting to be send", msg, sock, (long) writeBufferSize ());
+		logStream (MESSAGE_ERROR) << "other side of connection " << getName () << " does not read data, closing connection" << sendLog;
+		connectionError (-1);
+		return -1;
+	}
+	writeBuffer.append (msg);
+	writeBuffer.append (1, '\n');
 
-	if (ret != len)
+	if (writeTextSize () > WRITE_BUFFER_FLUSH && !isConnState (CONN_INPROGRESS) && !isConnState (CONN_CONNECTING))
+		return flushWriteBuffer ();
+	return 0;
+}
+
+int Connection::flushWriteBuffer ()
+{
+	while (sock >= 0)
 	{
-		syslog (LOG_ERR, "Cannot send msg: %s to sock %i with len %i, ret %i errno %i message %m",
-			msg, sock, len, ret, errno);
-		#ifdef DEBUG_EXTRA
-		logStream (MESSAGE_ERROR)
-			<< "Connection::sendMsg [" << getCentraldId () << ":" << conn_state << "] error "
-			<< sock << " state: " << ret << " sending " << msg << ":" << strerror (errno)
-			<< sendLog;
+		// keep queued binary data flowing as the buffer drains
+		if (binaryQueued > 0 && writeBufferSize () < WRITE_BUFFER_FLUSH)
+			feedBinaryData ();
+		if (writeBufferSize () == 0)
+			break;
+		const char *wb = writeBuffer.data () + writeBufferStart;
+		size_t len = writeBufferSize ();
+		if (writeBudget > 0)
+		{
+			if (writtenInLoop >= writeBudget)
+				break;
+			len = std::min (len, writeBudget - writtenInLoop);
+		}
+		ssize_t ret = send (sock, wb, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (ret == -1 && errno == ENOTSOCK)
+			ret = write (sock, wb, len);
+		if (ret == -1)
+		{
+			// ignore EINTR
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			syslog (LOG_ERR, "Cannot send %li bytes to sock %i, ret %li errno %i message %m", (long) len, sock, (long) ret, errno);
+			#ifdef DEBUG_EXTRA
+			logStream (MESSAGE_ERROR)
+				<< "Connection::flushWriteBuffer [" << getCentraldId () << ":" << conn_state << "] error "
+				<< sock << " state: " << ret << ":" << strerror (errno)
+				<< sendLog;
+			#endif
+			connectionError (ret);
+			return -1;
+		}
+		#ifdef DEBUG_ALL
+		std::cout << "Connection::flushWriteBuffer " << getName ()
+			<< " [" << getCentraldId () << ":" << sock << "] send " << ret << " of " << len << " bytes"
+			<< std::endl;
 		#endif
-		connectionError (ret);
-		delete[] mbuf;
-		return -1;
+		writeBufferStart += ret;
+		writtenInLoop += ret;
+		successfullSend ();
 	}
-	#ifdef DEBUG_ALL
-	std::cout << "Connection::sendMsg " << getName ()
-		<< " [" << getCentraldId () << ":" << sock << "] send " << ret << ": " << msg
-		<< std::endl;
-	#endif
-
-	delete[] mbuf;
-	successfullSend ();
+	if (writeBufferStart >= writeBuffer.length ())
+	{
+		writeBuffer.clear ();
+		writeBufferStart = 0;
+		writeBinaryEnd = 0;
+	}
+	// do not let already written data occupy buffer
+	else if (writeBufferStart > writeBuffer.length () / 2)
+	{
+		writeBuffer.erase (0, writeBufferStart);
+		writeBinaryEnd = writeBinaryEnd > writeBufferStart ? writeBinaryEnd - writeBufferStart : 0;
+		writeBufferStart = 0;
+	}
+	// budget was set for image transfer, do not throttle other messages
+	if (writeBudget > 0 && writeChannels.empty () && writeBinaryEnd <= writeBufferStart)
+		writeBudget = 0;
 	return 0;
 }
 
+void Connection::feedBinaryData ()
+{
+	std::map <int, DataAbstractWrite *>::iterator iter = writeChannels.begin ();
+	while (iter != writeChannels.end () && writeBufferSize () < WRITE_BUFFER_FLUSH)
+	{
+		DataWrite *dw = dynamic_cast <DataWrite *> (iter->second);
+		if (dw == NULL)
+		{
+			iter++;
+			continue;
+		}
+		if (dw->getQueuedSize () > 0)
+		{
+			int chan;
+			const char *data;
+			size_t len = std::min (dw->getQueued (chan, data), (size_t) WRITE_BUFFER_BINARY_BLOCK);
+
+			std::ostringstream _os;
+			_os << PROTO_DATA " " << iter->first << " " << chan << " " << len << "\n";
+			writeBuffer.append (_os.str ());
+			writeBuffer.append (data, len);
+			writeBinaryEnd = writeBuffer.length ();
+
+			dw->queuedWritten (len);
+			binaryQueued -= len;
+			if (dw->getQueuedSize () > 0)
+				continue;
+		}
+		// all data of the image are in the output buffer
+		if (dw->getDataSize () == 0)
+		{
+			delete dw;
+			writeChannels.erase (iter++);
+		}
+		else
+		{
+			iter++;
+		}
+	}
+}
+
 int Connection::sendMsg (std::string msg)
 {
 	return sendMsg (msg.c_str ());
@@ -1551,50 +1664,34 @@ int Connection::startBinaryData (int dataType, int channum, size_t *chansize)
 
 int Connection::sendBinaryData (int data_conn, int chan, char *data, size_t dataSize)
 {
-	char *binaryWriteTop, *binaryWriteBuff;
-	binaryWriteTop = binaryWriteBuff = data;
-	char *binaryEnd = data + dataSize;
+	if (sock < 0)
+		return -1;
 
-	std::ostringstream _os;
-	_os << PROTO_DATA " " << data_conn << " " << chan << " " << dataSize;
-	int ret;
-	ret = sendMsg (_os);
-	if (ret)
-		return ret;
+	std::map <int, DataAbstractWrite *>::iterator iter = writeChannels.find (data_conn);
+	DataWrite *dw = iter == writeChannels.end () ? NULL : dynamic_cast <DataWrite *> (iter->second);
+	if (dw == NULL)
+	{
+		logStream (MESSAGE_ERROR) << "Attempt to send data on unknown data connection " << data_conn << sendLog;
+		return -1;
+	}
 
-	while (binaryWriteTop < binaryEnd)
+	if (dataSize > getWriteBinaryDataSize (data_conn))
 	{
-		if (dataSize > getWriteBinaryDataSize (data_conn))
-		{
-			logStream (MESSAGE_ERROR) << "Attemp to send too much data on channel " << chan << " - "
-				<< dataSize << " bytes, but there are only " << getWriteBinaryDataSize (data_conn) << " bytes remain to be send" << sendLog;
-			dataSize = getWriteBinaryDataSize (data_conn);
-		}
-		ret = send (sock, binaryWriteTop, dataSize, 0);
-		if (ret == -1)
-		{
-			if (errno != EINTR)
-			{
-				connectionError (ret);
-				return -1;
-			}
-		}
-		else
-		{
-			binaryWriteTop += ret;
-			dataSize -= ret;
-			std::map <int, DataAbstractWrite *>::iterator iter = writeChannels.find (data_conn);
-			if (iter != writeChannels.end ())
-			{
-				((*iter).second)->dataWritten (chan, ret);
-				if (((*iter).second)->getDataSize () <= 0)
-				{
-					delete ((*iter).second);
-					writeChannels.erase (iter);
-				}
-			}
-		}
+		logStream (MESSAGE_ERROR) << "Attemp to send too much data on channel " << chan << " - "
+			<< dataSize << " bytes, but there are only " << getWriteBinaryDataSize (data_conn) << " bytes remain to be send" << sendLog;
+		dataSize = getWriteBinaryDataSize (data_conn);
 	}
+
+	dw->dataWritten (chan, dataSize);
+	// caller can reuse data buffer, keep a copy until data can be written
+	dw->queueData (chan, data, dataSize);
+	binaryQueued += dataSize;
+
+	feedBinaryData ();
+
+	// write what can be written now, rest will be written from main loop
+	if (!isConnState (CONN_INPROGRESS) && !isConnState (CONN_CONNECTING))
+		return flushWriteBuffer ();
 	return 0;
 }
 
@@ -1602,6 +1699,10 @@ void Connection::endBinaryData (int data_conn)
 {
 	std::ostringstream _os;
 	_os << PROTO_BINARY_KILLED " " << data_conn;
+	DataWrite *dw = dynamic_cast <DataWrite *> (writeChannels[data_conn]);
+	// data already moved to the output buffer are complete blocks, drop only the rest
+	if (dw)
+		binaryQueued -= dw->getQueuedSize ();
 	delete writeChannels[data_conn];
 	writeChannels.erase (data_conn);
 	sendMsg (_os);
@@ -1679,12 +1780,25 @@ void Connection::connConnected ()
 void Connection::connectionError (int last_data_size)
 {
 	activeReadData = -1;
+	writeBuffer.clear ();
+	writeBufferStart = 0;
+	writeBinaryEnd = 0;
+	for (std::map <int, DataAbstractWrite *>::iterator iter = writeChannels.begin (); iter != writeChannels.end (); iter++)
+	{
+		DataWrite *dw = dynamic_cast <DataWrite *> (iter->second);
+		if (dw)
+			dw->clearQueued ();
+	}
+	binaryQueued = 0;
 	if (canDelete ())
 		setConnState (CONN_DELETE);
 	else
 		setConnState (CONN_BROKEN);
 	if (sock >= 0)
+	{
 		close (sock);
+		master->pollFDClosed (sock);
+	}
 	sock = -1;
 	if (strlen (getName ()))
 		master->deleteAddress (getCentraldNum (), getName ());
@@ -2087,6 +2201,8 @@ int Connection::metaInfo (int rts2Type, std::string m_name, std::string desc)
 		{
 			existing_value->setFlags (rts2Type);
 			existing_value->setDescription (desc);
+			if (getOtherDevClient ())
+				getOtherDevClient ()->valueMetaChanged (existing_value);
 			return -1;
 		}
 		eiter = values.removeValue (m_name.c_str ());
@@ -2144,6 +2260,8 @@ int Connection::metaInfo (int rts2Type, std::string m_name, std::string desc)
 			return -2;
 	}
 	addValue (new_value, eiter);
+	if (getOtherDevClient ())
+		getOtherDevClient ()->valueMetaChanged (new_value);
 	return -1;
 }
 
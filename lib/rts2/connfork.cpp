@@ -52,9 +52,15 @@ ConnFork::~ConnFork ()
 	if (childPid > 0)
 		kill (-childPid, SIGINT);
 	if (sockerr > 0)
+	{
+		getMaster ()->pollFDClosed (sockerr);
 		close (sockerr);
+	}
 	if (sockwrite > 0)
+	{
+		getMaster ()->pollFDClosed (sockwrite);
 		close (sockwrite);
+	}
 	delete[]exePath;
 }
 
@@ -133,6 +139,7 @@ int ConnFork::receive (Block *block)
 			}
 			else if (data_size == 0)
 			{
+				block->pollFDClosed (sockerr);
 				close (sockerr);
 				sockerr = -1;
 				connectionError (0);
@@ -166,6 +173,7 @@ int ConnFork::writable (Block *block)
 				if (errno == EINTR)
 				{
 					logStream (MESSAGE_ERROR) << "rts2core::ConnFork while writing to sockwrite: " << strerror (errno) << sendLog;
+					block->pollFDClosed (sockwrite);
 					close (sockwrite);
 					sockwrite = -1;
 					return -1;
@@ -176,6 +184,7 @@ int ConnFork::writable (Block *block)
 			input = input.substr (write_size);
 			if (input.length () == 0)
 			{
+				block->pollFDClosed (sockwrite);
 				write_size = close (sockwrite);
 				if (write_size < 0)
 					logStream (MESSAGE_ERROR) << "rts2core::ConnFork error while closing write descriptor: " << strerror (errno) << sendLog;
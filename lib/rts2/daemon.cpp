@@ -96,6 +96,9 @@ Daemon::Daemon (int _argc, char **_argv, int _init_state):rts2core::Block (_argc
 
 	info_time = new ValueTime (RTS2_VALUE_INFOTIME, "time of last update", false);
 
+	createValue (timerLateness, "timer_lateness", "[s] average delay of timers triggered since last info", false, RTS2_DT_TIMEINTERVAL);
+	createValue (timerLatenessMax, "timer_lateness_max", "[s] maximal delay of timers triggered since last info", false, RTS2_DT_TIMEINTERVAL);
+
 	idleInfoInterval = -1;
 
 	addOption ('i', NULL, 0, "run in interactive mode, don't loose console");
@@ -962,6 +965,11 @@ int Daemon::sendBaseInfo (Connection * conn)
 
 int Daemon::info ()
 {
+	double avg, max;
+	getTimersLateness (avg, max);
+	timerLateness->setValueDouble (avg);
+	timerLatenessMax->setValueDouble (max);
+
 	updateInfoTime ();
 	return 0;
 }
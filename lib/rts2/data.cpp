@@ -123,6 +123,7 @@ DataWrite::DataWrite (int _channum, size_t *chansizes):DataAbstractWrite ()
 	binaryWriteDataSize = new size_t[channum];
 	for (int i = 0; i < channum; i++)
 		binaryWriteDataSize[i] = chansizes[i];
+	queuedSize = 0;
 }
 
 DataWrite::~DataWrite ()
@@ -138,6 +139,34 @@ size_t DataWrite::getDataSize ()
 	return ret;
 }
 
+void DataWrite::queueData (int chan, const char *data, size_t size)
+{
+	if (size == 0)
+		return;
+	queued.push_back (QueuedBlock ());
+	queued.back ().chan = chan;
+	queued.back ().data.assign (data, size);
+	queued.back ().start = 0;
+	queuedSize += size;
+}
+
+size_t DataWrite::getQueued (int &chan, const char *&data)
+{
+	if (queued.empty ())
+		return 0;
+	chan = queued.front ().chan;
+	data = queued.front ().data.data () + queued.front ().start;
+	return queued.front ().data.length () - queued.front ().start;
+}
+
+void DataWrite::queuedWritten (size_t size)
+{
+	queued.front ().start += size;
+	queuedSize -= size;
+	if (queued.front ().start >= queued.front ().data.length ())
+		queued.pop_front ();
+}
+
 struct SharedDataHeader *DataSharedWrite::create (int numseg, size_t segsize)
 {
 	shm_id = shmget (IPC_PRIVATE, sizeof (struct SharedDataHeader) + numseg * (sizeof (struct SharedDataSegment) + segsize), 0666);
@@ -17,8 +17,11 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+#include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <syslog.h>
+#include <unistd.h>
 #include <sys/socket.h>
 
 #include <rts2-config.h>
@@ -496,6 +499,19 @@ Device::Device (int in_argc, char **in_argv, int in_device_type, const char *def
 
 	last_weathermsg = NULL;
 
+	mainThread = pthread_self ();
+	pthread_mutex_init (&threadMessagesMutex, NULL);
+	if (pipe (threadMessagesPipe))
+	{
+		threadMessagesPipe[0] = -1;
+		threadMessagesPipe[1] = -1;
+	}
+	else
+	{
+		fcntl (threadMessagesPipe[0], F_SETFL, O_NONBLOCK);
+		fcntl (threadMessagesPipe[1], F_SETFL, O_NONBLOCK);
+	}
+
 	// now add options..
 	addOption (OPT_NOAUTH, "noauth", 0, "allow unauthorized connections");
 	addOption (OPT_NOTCHECKNULL, "notcheck", 0, "ignore if some recomended values are not set");
@@ -508,6 +524,12 @@ Device::~Device (void)
 {
 	delete[] last_weathermsg;
 	delete[] device_host;
+	if (threadMessagesPipe[0] >= 0)
+	{
+		close (threadMessagesPipe[0]);
+		close (threadMessagesPipe[1]);
+	}
+	pthread_mutex_destroy (&threadMessagesMutex);
 }
 
 DevConnection * Device::createConnection (int in_sock)
@@ -751,6 +773,7 @@ void Device::beforeRun ()
 	int ret = doDaemonize ();
 	if (ret)
 		exit (ret);
+	mainThread = pthread_self ();
 #ifndef RTS2_HAVE_FLOCK
 	// reopen..
 	ret = checkLockFile (s.c_str ());
@@ -762,6 +785,20 @@ void Device::beforeRun ()
 		exit (ret);
 }
 
+void Device::addPollSocks ()
+{
+	Daemon::addPollSocks ();
+	if (threadMessagesPipe[0] >= 0)
+		addPollFD (threadMessagesPipe[0], POLLIN | POLLPRI);
+}
+
+void Device::pollSuccess ()
+{
+	if (threadMessagesPipe[0] >= 0 && isForRead (threadMessagesPipe[0]))
+		sendThreadMessages ();
+	Daemon::pollSuccess ();
+}
+
 int Device::authorize (int centrald_num, DevConnection * conn)
 {
 	connections_t::iterator iter;
@@ -791,6 +828,16 @@ void Device::centraldConnRunning (Connection *conn)
 
 void Device::sendMessage (messageType_t in_messageType, const char *in_messageString)
 {
+	if (!pthread_equal (pthread_self (), mainThread) && threadMessagesPipe[1] >= 0)
+	{
+		pthread_mutex_lock (&threadMessagesMutex);
+		threadMessages.push_back (std::pair <messageType_t, std::string> (in_messageType, std::string (in_messageString)));
+		pthread_mutex_unlock (&threadMessagesMutex);
+		// pipe full means main loop was already notified
+		if (write (threadMessagesPipe[1], "", 1) < 0 && errno != EAGAIN)
+			syslog (LOG_ERR, "cannot notify main loop about thread message: %s", strerror (errno));
+		return;
+	}
 	Daemon::sendMessage (in_messageType, in_messageString);
 	for (connections_t::iterator iter = getCentraldConns ()->begin (); iter != getCentraldConns ()->end (); iter++)
 	{
@@ -799,6 +846,19 @@ void Device::sendMessage (messageType_t in_messageType, const char *in_messageSt
 	}
 }
 
+void Device::sendThreadMessages ()
+{
+	char buf[50];
+	while (read (threadMessagesPipe[0], buf, sizeof (buf)) > 0)
+		;
+	std::list <std::pair <messageType_t, std::string> > msgs;
+	pthread_mutex_lock (&threadMessagesMutex);
+	msgs.swap (threadMessages);
+	pthread_mutex_unlock (&threadMessagesMutex);
+	for (std::list <std::pair <messageType_t, std::string> >::iterator iter = msgs.begin (); iter != msgs.end (); iter++)
+		sendMessage (iter->first, iter->second.c_str ());
+}
+
 int Device::killAll (bool callScriptEnd)
 {
 	// remove all queued changes - do not perform them
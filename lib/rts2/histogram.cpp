@@ -0,0 +1,145 @@
+/*
+ * Fixed-size streaming histogram.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "histogram.h"
+#include "nan.h"
+
+#include <math.h>
+
+using namespace rts2core;
+
+Histogram::Histogram (size_t bins)
+{
+	setBins (bins);
+}
+
+void Histogram::setBins (size_t bins)
+{
+	if (bins < 2)
+		bins = 2;
+	// grow needs even number of bins
+	bins += bins % 2;
+	counts.resize (bins);
+	clear ();
+}
+
+void Histogram::clear ()
+{
+	counts.assign (counts.size (), 0);
+	total = 0;
+	modeBin = 0;
+	low = 0;
+	width = 0;
+	integer = false;
+}
+
+double Histogram::getMode ()
+{
+	if (total == 0)
+		return NAN;
+	return binValue (modeBin);
+}
+
+double Histogram::getQuantile (double q)
+{
+	if (total == 0)
+		return NAN;
+	if (q < 0)
+		q = 0;
+	if (q > 1)
+		q = 1;
+	double target = q * total;
+	uint64_t cum = 0;
+	size_t i;
+	for (i = 0; i < counts.size () - 1; i++)
+	{
+		if (cum + counts[i] >= target && counts[i] > 0)
+			break;
+		cum += counts[i];
+	}
+	// values inside integer bin one unit wide are all the same
+	if (integer && width == 1)
+		return low + i;
+	double frac = counts[i] > 0 ? (target - cum) / counts[i] : 0;
+	if (integer)
+		return floor (low + i * width + frac * (width - 1) + 0.5);
+	return low + (i + frac) * width;
+}
+
+void Histogram::extend (double dmin, double dmax, bool int_data)
+{
+	size_t nb = counts.size ();
+	if (width == 0)
+	{
+		integer = int_data;
+		if (integer)
+		{
+			low = dmin;
+			width = 1;
+			while (dmax - low >= nb * width)
+				width *= 2;
+		}
+		else
+		{
+			low = dmin;
+			width = (dmax - dmin) / nb;
+			// avoid single value falling to the upper edge
+			if (width == 0)
+				width = fabs (dmin) > 1 ? fabs (dmin) * 1e-6 : 1e-6;
+			else
+				width *= 1 + 1e-9;
+		}
+		return;
+	}
+	while (dmin < low)
+		grow (true);
+	while (dmax >= low + nb * width)
+		grow (false);
+}
+
+void Histogram::grow (bool down)
+{
+	size_t half = counts.size () / 2;
+	size_t i;
+	if (down)
+	{
+		// merged bins go to the upper half
+		for (i = half; i > 0; i--)
+			counts[half + i - 1] = counts[2 * i - 2] + counts[2 * i - 1];
+		for (i = 0; i < half; i++)
+			counts[i] = 0;
+		low -= counts.size () * width;
+		modeBin = half + modeBin / 2;
+	}
+	else
+	{
+		for (i = 0; i < half; i++)
+			counts[i] = counts[2 * i] + counts[2 * i + 1];
+		for (i = half; i < counts.size (); i++)
+			counts[i] = 0;
+		modeBin = modeBin / 2;
+	}
+	width *= 2;
+	// merged neighbour can be fuller than the bin which held the mode
+	for (i = 0; i < counts.size (); i++)
+	{
+		if (counts[i] > counts[modeBin])
+			modeBin = i;
+	}
+}
@@ -0,0 +1,515 @@
+/*
+ * Pixel statistics kernels.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "pixelstats.h"
+
+#include <float.h>
+#include <limits>
+
+// SIMD kernels are compiled with target attributes, so the rest of the code does not need -mavx2
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define PIXELSTATS_X86
+#include <immintrin.h>
+#endif
+
+using namespace rts2core;
+
+#define KERNEL_UNKNOWN    0
+#define KERNEL_SCALAR     1
+#define KERNEL_SSE2       2
+#define KERNEL_AVX2       3
+
+static int kernel = KERNEL_UNKNOWN;
+
+static int getKernel ()
+{
+	if (kernel == KERNEL_UNKNOWN)
+	{
+		int k = KERNEL_SCALAR;
+#ifdef PIXELSTATS_X86
+		__builtin_cpu_init ();
+		if (__builtin_cpu_supports ("avx2"))
+			k = KERNEL_AVX2;
+		else if (__builtin_cpu_supports ("sse2"))
+			k = KERNEL_SSE2;
+#endif
+		kernel = k;
+	}
+	return kernel;
+}
+
+// 16-bit statistics, with values xored by flip, calculated in integers
+struct Sums16
+{
+	uint64_t sum;
+	uint64_t sum2;
+	unsigned int min;
+	unsigned int max;
+};
+
+static void stats16Scalar (const uint16_t *data, size_t n, uint16_t flip, Sums16 &s)
+{
+	for (const uint16_t *d = data; d < data + n; d++)
+	{
+		unsigned int v = *d ^ flip;
+		s.sum += v;
+		s.sum2 += (uint64_t) v * v;
+		s.min = v < s.min ? v : s.min;
+		s.max = v > s.max ? v : s.max;
+	}
+}
+
+// 32-bit partial sums receive two values per iteration, so they can hold 2^15 iterations
+#define BLOCK16  16384
+
+#ifdef PIXELSTATS_X86
+
+__attribute__ ((target ("sse2"))) static void stats16SSE2 (const uint16_t *data, size_t n, uint16_t flip, Sums16 &s)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	// SSE2 has only signed 16-bit min/max
+	const __m128i sign = _mm_set1_epi16 ((short) 0x8000);
+	const __m128i vflip = _mm_set1_epi16 ((short) flip);
+	__m128i vmin = _mm_set1_epi16 (0x7fff);
+	__m128i vmax = sign;
+	__m128i s64 = zero;
+	__m128i q64 = zero;
+	size_t i = 0;
+	while (n - i >= 8)
+	{
+		size_t end = n - i > 8 * BLOCK16 ? i + 8 * BLOCK16 : n;
+		__m128i s32 = zero;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m128i v = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (data + i)), vflip);
+			__m128i sv = _mm_xor_si128 (v, sign);
+			vmin = _mm_min_epi16 (vmin, sv);
+			vmax = _mm_max_epi16 (vmax, sv);
+			__m128i lo = _mm_unpacklo_epi16 (v, zero);
+			__m128i hi = _mm_unpackhi_epi16 (v, zero);
+			s32 = _mm_add_epi32 (s32, _mm_add_epi32 (lo, hi));
+			// squares of even and odd 32-bit lanes
+			__m128i lo1 = _mm_srli_epi64 (lo, 32);
+			__m128i hi1 = _mm_srli_epi64 (hi, 32);
+			q64 = _mm_add_epi64 (q64, _mm_add_epi64 (_mm_mul_epu32 (lo, lo), _mm_mul_epu32 (lo1, lo1)));
+			q64 = _mm_add_epi64 (q64, _mm_add_epi64 (_mm_mul_epu32 (hi, hi), _mm_mul_epu32 (hi1, hi1)));
+		}
+		s64 = _mm_add_epi64 (s64, _mm_add_epi64 (_mm_unpacklo_epi32 (s32, zero), _mm_unpackhi_epi32 (s32, zero)));
+	}
+
+	uint64_t b[2];
+	_mm_storeu_si128 ((__m128i *) b, s64);
+	s.sum += b[0] + b[1];
+	_mm_storeu_si128 ((__m128i *) b, q64);
+	s.sum2 += b[0] + b[1];
+
+	uint16_t mi[8];
+	uint16_t ma[8];
+	_mm_storeu_si128 ((__m128i *) mi, _mm_xor_si128 (vmin, sign));
+	_mm_storeu_si128 ((__m128i *) ma, _mm_xor_si128 (vmax, sign));
+	for (int j = 0; j < 8; j++)
+	{
+		s.min = mi[j] < s.min ? mi[j] : s.min;
+		s.max = ma[j] > s.max ? ma[j] : s.max;
+	}
+
+	stats16Scalar (data + i, n - i, flip, s);
+}
+
+__attribute__ ((target ("avx2"))) static void stats16AVX2 (const uint16_t *data, size_t n, uint16_t flip, Sums16 &s)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	const __m256i vflip = _mm256_set1_epi16 ((short) flip);
+	__m256i vmin = _mm256_set1_epi16 ((short) 0xffff);
+	__m256i vmax = zero;
+	__m256i s64 = zero;
+	__m256i q64 = zero;
+	size_t i = 0;
+	while (n - i >= 16)
+	{
+		size_t end = n - i > 16 * BLOCK16 ? i + 16 * BLOCK16 : n;
+		__m256i s32 = zero;
+		for (; i + 16 <= end; i += 16)
+		{
+			__m256i v = _mm256_xor_si256 (_mm256_loadu_si256 ((const __m256i *) (data + i)), vflip);
+			vmin = _mm256_min_epu16 (vmin, v);
+			vmax = _mm256_max_epu16 (vmax, v);
+			__m256i lo = _mm256_unpacklo_epi16 (v, zero);
+			__m256i hi = _mm256_unpackhi_epi16 (v, zero);
+			s32 = _mm256_add_epi32 (s32, _mm256_add_epi32 (lo, hi));
+			// square of 16-bit value fits to 32 bits
+			__m256i lq = _mm256_mullo_epi32 (lo, lo);
+			__m256i hq = _mm256_mullo_epi32 (hi, hi);
+			q64 = _mm256_add_epi64 (q64, _mm256_add_epi64 (_mm256_unpacklo_epi32 (lq, zero), _mm256_unpackhi_epi32 (lq, zero)));
+			q64 = _mm256_add_epi64 (q64, _mm256_add_epi64 (_mm256_unpacklo_epi32 (hq, zero), _mm256_unpackhi_epi32 (hq, zero)));
+		}
+		s64 = _mm256_add_epi64 (s64, _mm256_add_epi64 (_mm256_unpacklo_epi32 (s32, zero), _mm256_unpackhi_epi32 (s32, zero)));
+	}
+
+	uint64_t b[4];
+	_mm256_storeu_si256 ((__m256i *) b, s64);
+	s.sum += b[0] + b[1] + b[2] + b[3];
+	_mm256_storeu_si256 ((__m256i *) b, q64);
+	s.sum2 += b[0] + b[1] + b[2] + b[3];
+
+	uint16_t mi[16];
+	uint16_t ma[16];
+	_mm256_storeu_si256 ((__m256i *) mi, vmin);
+	_mm256_storeu_si256 ((__m256i *) ma, vmax);
+	for (int j = 0; j < 16; j++)
+	{
+		s.min = mi[j] < s.min ? mi[j] : s.min;
+		s.max = ma[j] > s.max ? ma[j] : s.max;
+	}
+
+	stats16Scalar (data + i, n - i, flip, s);
+}
+
+__attribute__ ((target ("sse2"))) static void statsFloatSSE2 (const float *data, size_t n, PixelStats &ps)
+{
+	__m128d s0 = _mm_setzero_pd ();
+	__m128d s1 = s0;
+	__m128d q0 = s0;
+	__m128d q1 = s0;
+	// min and max return second operand if the first is NaN, so NaNs are skipped
+	__m128 vmin = _mm_set1_ps (std::numeric_limits <float>::infinity ());
+	__m128 vmax = _mm_set1_ps (-std::numeric_limits <float>::infinity ());
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128 v = _mm_loadu_ps (data + i);
+		vmin = _mm_min_ps (v, vmin);
+		vmax = _mm_max_ps (v, vmax);
+		__m128d lo = _mm_cvtps_pd (v);
+		__m128d hi = _mm_cvtps_pd (_mm_movehl_ps (v, v));
+		s0 = _mm_add_pd (s0, lo);
+		s1 = _mm_add_pd (s1, hi);
+		q0 = _mm_add_pd (q0, _mm_mul_pd (lo, lo));
+		q1 = _mm_add_pd (q1, _mm_mul_pd (hi, hi));
+	}
+
+	double b[2];
+	_mm_storeu_pd (b, _mm_add_pd (s0, s1));
+	ps.sum += b[0] + b[1];
+	_mm_storeu_pd (b, _mm_add_pd (q0, q1));
+	ps.sum2 += b[0] + b[1];
+
+	float mi[4];
+	float ma[4];
+	_mm_storeu_ps (mi, vmin);
+	_mm_storeu_ps (ma, vmax);
+	for (int j = 0; j < 4; j++)
+	{
+		ps.min = mi[j] < ps.min ? mi[j] : ps.min;
+		ps.max = ma[j] > ps.max ? ma[j] : ps.max;
+	}
+	ps.n += i;
+
+	pixelStatsScalar (data + i, n - i, ps);
+}
+
+__attribute__ ((target ("avx2"))) static void statsFloatAVX2 (const float *data, size_t n, PixelStats &ps)
+{
+	__m256d s0 = _mm256_setzero_pd ();
+	__m256d s1 = s0;
+	__m256d q0 = s0;
+	__m256d q1 = s0;
+	__m256 vmin = _mm256_set1_ps (std::numeric_limits <float>::infinity ());
+	__m256 vmax = _mm256_set1_ps (-std::numeric_limits <float>::infinity ());
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_loadu_ps (data + i);
+		vmin = _mm256_min_ps (v, vmin);
+		vmax = _mm256_max_ps (v, vmax);
+		__m256d lo = _mm256_cvtps_pd (_mm256_castps256_ps128 (v));
+		__m256d hi = _mm256_cvtps_pd (_mm256_extractf128_ps (v, 1));
+		s0 = _mm256_add_pd (s0, lo);
+		s1 = _mm256_add_pd (s1, hi);
+		q0 = _mm256_add_pd (q0, _mm256_mul_pd (lo, lo));
+		q1 = _mm256_add_pd (q1, _mm256_mul_pd (hi, hi));
+	}
+
+	double b[4];
+	_mm256_storeu_pd (b, _mm256_add_pd (s0, s1));
+	ps.sum += b[0] + b[1] + b[2] + b[3];
+	_mm256_storeu_pd (b, _mm256_add_pd (q0, q1));
+	ps.sum2 += b[0] + b[1] + b[2] + b[3];
+
+	float mi[8];
+	float ma[8];
+	_mm256_storeu_ps (mi, vmin);
+	_mm256_storeu_ps (ma, vmax);
+	for (int j = 0; j < 8; j++)
+	{
+		ps.min = mi[j] < ps.min ? mi[j] : ps.min;
+		ps.max = ma[j] > ps.max ? ma[j] : ps.max;
+	}
+	ps.n += i;
+
+	pixelStatsScalar (data + i, n - i, ps);
+}
+
+__attribute__ ((target ("sse2"))) static void threshold16SSE2 (const uint16_t *row, size_t w, unsigned int thr, double *colSums, double &rowSum, int &npix, unsigned int &rmax)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i sign = _mm_set1_epi16 ((short) 0x8000);
+	// v >= thr is evaluated as signed (v ^ 0x8000) > ((thr - 1) ^ 0x8000)
+	const __m128i vthr = _mm_set1_epi16 ((short) ((thr - 1) ^ 0x8000));
+	__m128i vmax = sign;
+	__m128d rs = _mm_setzero_pd ();
+	size_t col = 0;
+	for (; col + 8 <= w; col += 8)
+	{
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (row + col));
+		__m128i ge = thr == 0 ? _mm_cmpeq_epi16 (v, v) : _mm_cmpgt_epi16 (_mm_xor_si128 (v, sign), vthr);
+		int mask = _mm_movemask_epi8 (ge);
+		if (mask == 0)
+			continue;
+		npix += __builtin_popcount (mask) / 2;
+		__m128i m = _mm_and_si128 (v, ge);
+		vmax = _mm_max_epi16 (vmax, _mm_xor_si128 (m, sign));
+		__m128i lo = _mm_unpacklo_epi16 (m, zero);
+		__m128i hi = _mm_unpackhi_epi16 (m, zero);
+		__m128d d0 = _mm_cvtepi32_pd (lo);
+		__m128d d1 = _mm_cvtepi32_pd (_mm_shuffle_epi32 (lo, _MM_SHUFFLE (3, 2, 3, 2)));
+		__m128d d2 = _mm_cvtepi32_pd (hi);
+		__m128d d3 = _mm_cvtepi32_pd (_mm_shuffle_epi32 (hi, _MM_SHUFFLE (3, 2, 3, 2)));
+		_mm_storeu_pd (colSums + col, _mm_add_pd (_mm_loadu_pd (colSums + col), d0));
+		_mm_storeu_pd (colSums + col + 2, _mm_add_pd (_mm_loadu_pd (colSums + col + 2), d1));
+		_mm_storeu_pd (colSums + col + 4, _mm_add_pd (_mm_loadu_pd (colSums + col + 4), d2));
+		_mm_storeu_pd (colSums + col + 6, _mm_add_pd (_mm_loadu_pd (colSums + col + 6), d3));
+		rs = _mm_add_pd (rs, _mm_add_pd (_mm_add_pd (d0, d1), _mm_add_pd (d2, d3)));
+	}
+
+	double b[2];
+	_mm_storeu_pd (b, rs);
+	rowSum = b[0] + b[1];
+
+	uint16_t ma[8];
+	_mm_storeu_si128 ((__m128i *) ma, _mm_xor_si128 (vmax, sign));
+	for (int j = 0; j < 8; j++)
+		rmax = ma[j] > rmax ? ma[j] : rmax;
+
+	for (; col < w; col++)
+	{
+		if (row[col] >= thr)
+		{
+			colSums[col] += row[col];
+			rowSum += row[col];
+			rmax = row[col] > rmax ? row[col] : rmax;
+			npix++;
+		}
+	}
+}
+
+#endif // PIXELSTATS_X86
+
+static void stats16 (const uint16_t *data, size_t n, uint16_t flip, PixelStats &ps)
+{
+	if (n == 0)
+		return;
+
+	Sums16 s;
+	s.sum = 0;
+	s.sum2 = 0;
+	s.min = 0xffff;
+	s.max = 0;
+
+	switch (getKernel ())
+	{
+#ifdef PIXELSTATS_X86
+		case KERNEL_AVX2:
+			stats16AVX2 (data, n, flip, s);
+			break;
+		case KERNEL_SSE2:
+			stats16SSE2 (data, n, flip, s);
+			break;
+#endif
+		default:
+			stats16Scalar (data, n, flip, s);
+	}
+
+	if (flip)
+	{
+		// signed data were shifted by 32768; arithmetic is modulo 2^64, result is exact
+		ps.sum += (double) ((int64_t) s.sum - ((int64_t) n << 15));
+		ps.sum2 += (double) (s.sum2 - (s.sum << 16) + ((uint64_t) n << 30));
+		ps.min = (double) s.min - 32768 < ps.min ? (double) s.min - 32768 : ps.min;
+		ps.max = (double) s.max - 32768 > ps.max ? (double) s.max - 32768 : ps.max;
+	}
+	else
+	{
+		ps.sum += (double) s.sum;
+		ps.sum2 += (double) s.sum2;
+		ps.min = s.min < ps.min ? s.min : ps.min;
+		ps.max = s.max > ps.max ? s.max : ps.max;
+	}
+	ps.n += n;
+}
+
+void PixelStats::clear ()
+{
+	sum = 0;
+	sum2 = 0;
+	min = DBL_MAX;
+	max = -DBL_MAX;
+	n = 0;
+}
+
+double PixelStats::getStdev ()
+{
+	if (n == 0)
+		return 0;
+	double avg = sum / n;
+	double var = sum2 / n - avg * avg;
+	return var > 0 ? sqrt (var) : 0;
+}
+
+const char *rts2core::pixelKernelName ()
+{
+	switch (getKernel ())
+	{
+		case KERNEL_AVX2:
+			return "avx2";
+		case KERNEL_SSE2:
+			return "sse2";
+	}
+	return "scalar";
+}
+
+void rts2core::pixelKernelScalar (bool scalar)
+{
+	kernel = scalar ? KERNEL_SCALAR : KERNEL_UNKNOWN;
+}
+
+void rts2core::pixelStats (const uint8_t *data, size_t n, PixelStats &ps)
+{
+	pixelStatsScalar (data, n, ps);
+}
+
+void rts2core::pixelStats (const int8_t *data, size_t n, PixelStats &ps)
+{
+	pixelStatsScalar (data, n, ps);
+}
+
+void rts2core::pixelStats (const uint16_t *data, size_t n, PixelStats &ps)
+{
+	stats16 (data, n, 0, ps);
+}
+
+void rts2core::pixelStats (const int16_t *data, size_t n, PixelStats &ps)
+{
+	stats16 ((const uint16_t *) data, n, 0x8000, ps);
+}
+
+void rts2core::pixelStats (const uint32_t *data, size_t n, PixelStats &ps)
+{
+	pixelStatsScalar (data, n, ps);
+}
+
+void rts2core::pixelStats (const int32_t *data, size_t n, PixelStats &ps)
+{
+	pixelStatsScalar (data, n, ps);
+}
+
+void rts2core::pixelStats (const int64_t *data, size_t n, PixelStats &ps)
+{
+	pixelStatsScalar (data, n, ps);
+}
+
+void rts2core::pixelStats (const float *data, size_t n, PixelStats &ps)
+{
+	switch (getKernel ())
+	{
+#ifdef PIXELSTATS_X86
+		case KERNEL_AVX2:
+			statsFloatAVX2 (data, n, ps);
+			return;
+		case KERNEL_SSE2:
+			statsFloatSSE2 (data, n, ps);
+			return;
+#endif
+		default:
+			pixelStatsScalar (data, n, ps);
+	}
+}
+
+void rts2core::pixelStats (const double *data, size_t n, PixelStats &ps)
+{
+	pixelStatsScalar (data, n, ps);
+}
+
+void rts2core::thresholdRow (const uint8_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const int8_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const uint16_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+#ifdef PIXELSTATS_X86
+	// NaN threshold or threshold above data range are handled by scalar code
+	if (getKernel () != KERNEL_SCALAR && threshold <= 0xffff)
+	{
+		unsigned int thr = threshold > 0 ? (unsigned int) ceil (threshold) : 0;
+		int np = 0;
+		unsigned int ma = 0;
+		threshold16SSE2 (row, w, thr, colSums, rowSum, np, ma);
+		npix += np;
+		rmax = np > 0 ? ma : NAN;
+		return;
+	}
+#endif
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const int16_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const uint32_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const int32_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const int64_t *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const float *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
+
+void rts2core::thresholdRow (const double *row, size_t w, double threshold, double *colSums, double &rowSum, int &npix, double &rmax)
+{
+	thresholdRowScalar (row, w, threshold, colSums, rowSum, npix, rmax);
+}
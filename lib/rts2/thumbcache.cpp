@@ -0,0 +1,303 @@
+/*
+ * On-disk cache of image thumbnails.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "thumbcache.h"
+#include "utilsfunc.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// length of cache file name - two 64 bit hashes and extension
+#define THUMB_NAME_LEN   36
+
+using namespace rts2core;
+
+static std::string stripSlashes (const char *_dir)
+{
+	std::string ret (_dir);
+	while (ret.length () > 1 && ret[ret.length () - 1] == '/')
+		ret.erase (ret.length () - 1);
+	return ret;
+}
+
+ThumbnailCache::ThumbnailCache (const char *_dir, size_t _budget)
+{
+	dir = stripSlashes (_dir);
+	budget = _budget;
+	size = 0;
+	hits = 0;
+	misses = 0;
+	pthread_mutex_init (&mutex, NULL);
+}
+
+ThumbnailCache::~ThumbnailCache ()
+{
+	pthread_mutex_destroy (&mutex);
+}
+
+int ThumbnailCache::init ()
+{
+	if (mkpath ((dir + "/").c_str (), 0777))
+		return -1;
+
+	DIR *d = opendir (dir.c_str ());
+	if (d == NULL)
+		return -1;
+
+	std::vector <std::pair <time_t, std::pair <std::string, size_t> > > found;
+
+	struct dirent *de;
+	while ((de = readdir (d)) != NULL)
+	{
+		size_t l = strlen (de->d_name);
+		// temporary files have extra suffix
+		if (l != THUMB_NAME_LEN || strcmp (de->d_name + l - 4, ".jpg"))
+			continue;
+		struct stat st;
+		if (stat (filePath (de->d_name).c_str (), &st) || !S_ISREG (st.st_mode))
+			continue;
+		found.push_back (std::pair <time_t, std::pair <std::string, size_t> > (st.st_mtime, std::pair <std::string, size_t> (de->d_name, st.st_size)));
+	}
+	closedir (d);
+
+	// modification time is updated on every cache hit
+	std::sort (found.begin (), found.end ());
+	pthread_mutex_lock (&mutex);
+	for (std::vector <std::pair <time_t, std::pair <std::string, size_t> > >::iterator iter = found.begin (); iter != found.end (); iter++)
+		add (iter->second.first, iter->second.second);
+
+	evict ();
+	pthread_mutex_unlock (&mutex);
+	return 0;
+}
+
+std::string ThumbnailCache::makeKey (const struct stat &st, int prevsize, const char *label, float quantiles, int chan, int colourVariant)
+{
+	std::ostringstream os;
+	os << st.st_dev << ":" << st.st_ino << ":" << st.st_mtime << ":" << st.st_size
+		<< ":" << prevsize << ":" << chan << ":" << colourVariant << ":" << std::setprecision (6) << quantiles
+		<< ":" << (label ? label : "");
+	return os.str ();
+}
+
+int ThumbnailCache::get (const std::string &key, size_t &length)
+{
+	std::string name = fileName (key);
+
+	// file might be added by other process, so try to open it even if it is not in index
+	int fd = open (filePath (name).c_str (), O_RDONLY);
+	struct stat st;
+	if (fd >= 0 && fstat (fd, &st))
+	{
+		close (fd);
+		fd = -1;
+	}
+
+	pthread_mutex_lock (&mutex);
+	std::map <std::string, Entry>::iterator iter = entries.find (name);
+	if (fd < 0)
+	{
+		// file was removed
+		if (iter != entries.end ())
+			remove (iter);
+		misses++;
+		pthread_mutex_unlock (&mutex);
+		return -1;
+	}
+
+	length = st.st_size;
+
+	if (iter == entries.end ())
+	{
+		add (name, length);
+		evict ();
+	}
+	else
+	{
+		lru.splice (lru.begin (), lru, iter->second.lru);
+	}
+
+	hits++;
+	pthread_mutex_unlock (&mutex);
+
+	// keep LRU order for next init
+	futimens (fd, NULL);
+
+	return fd;
+}
+
+int ThumbnailCache::put (const std::string &key, const void *data, size_t length)
+{
+	std::string name = fileName (key);
+	std::string tmp = filePath (name) + ".XXXXXX";
+	char tmpname[tmp.length () + 1];
+	strcpy (tmpname, tmp.c_str ());
+
+	int fd = mkstemp (tmpname);
+	if (fd < 0)
+		return -1;
+	// cache can be shared by processes running under different users
+	fchmod (fd, 0644);
+
+	size_t written = 0;
+	while (written < length)
+	{
+		ssize_t ret = write (fd, ((const char *) data) + written, length - written);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			close (fd);
+			unlink (tmpname);
+			return -1;
+		}
+		written += ret;
+	}
+
+	if (close (fd) || rename (tmpname, filePath (name).c_str ()))
+	{
+		unlink (tmpname);
+		return -1;
+	}
+
+	pthread_mutex_lock (&mutex);
+	add (name, length);
+	evict ();
+	pthread_mutex_unlock (&mutex);
+	return 0;
+}
+
+void ThumbnailCache::setBudget (size_t _budget)
+{
+	pthread_mutex_lock (&mutex);
+	budget = _budget;
+	evict ();
+	pthread_mutex_unlock (&mutex);
+}
+
+int ThumbnailCache::setDirectory (const char *_dir)
+{
+	std::string d = stripSlashes (_dir);
+	pthread_mutex_lock (&mutex);
+	if (d == dir)
+	{
+		pthread_mutex_unlock (&mutex);
+		return 0;
+	}
+	dir = d;
+	entries.clear ();
+	lru.clear ();
+	size = 0;
+	pthread_mutex_unlock (&mutex);
+	return init ();
+}
+
+size_t ThumbnailCache::getSize ()
+{
+	pthread_mutex_lock (&mutex);
+	size_t ret = size;
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+size_t ThumbnailCache::getEntries ()
+{
+	pthread_mutex_lock (&mutex);
+	size_t ret = entries.size ();
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+unsigned long ThumbnailCache::getHits ()
+{
+	pthread_mutex_lock (&mutex);
+	unsigned long ret = hits;
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+unsigned long ThumbnailCache::getMisses ()
+{
+	pthread_mutex_lock (&mutex);
+	unsigned long ret = misses;
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+std::string ThumbnailCache::fileName (const std::string &key)
+{
+	// two FNV-1a hashes with different offsets
+	uint64_t h1 = 0xcbf29ce484222325ULL;
+	uint64_t h2 = 0x84222325cbf29ce4ULL;
+	for (std::string::const_iterator iter = key.begin (); iter != key.end (); iter++)
+	{
+		h1 = (h1 ^ (unsigned char) *iter) * 0x100000001b3ULL;
+		h2 = (h2 ^ (unsigned char) *iter) * 0x100000001b3ULL;
+	}
+	char buf[THUMB_NAME_LEN + 1];
+	snprintf (buf, sizeof (buf), "%016llx%016llx.jpg", (unsigned long long) h1, (unsigned long long) h2);
+	return std::string (buf);
+}
+
+void ThumbnailCache::add (const std::string &name, size_t length)
+{
+	std::map <std::string, Entry>::iterator iter = entries.find (name);
+	if (iter != entries.end ())
+	{
+		size -= iter->second.length;
+		iter->second.length = length;
+		lru.splice (lru.begin (), lru, iter->second.lru);
+	}
+	else
+	{
+		lru.push_front (name);
+		Entry e;
+		e.length = length;
+		e.lru = lru.begin ();
+		entries[name] = e;
+	}
+	size += length;
+}
+
+void ThumbnailCache::remove (std::map <std::string, Entry>::iterator iter)
+{
+	size -= iter->second.length;
+	lru.erase (iter->second.lru);
+	entries.erase (iter);
+}
+
+void ThumbnailCache::evict ()
+{
+	while (size > budget && !lru.empty ())
+	{
+		std::map <std::string, Entry>::iterator iter = entries.find (lru.back ());
+		unlink (filePath (iter->first).c_str ());
+		remove (iter);
+	}
+}
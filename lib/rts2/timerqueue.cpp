@@ -0,0 +1,151 @@
+/*
+ * Indexed timer queue.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "timerqueue.h"
+
+#include <stdlib.h>
+
+using namespace rts2core;
+
+TimerQueue::TimerQueue ()
+{
+	lastId = 0;
+}
+
+TimerQueue::~TimerQueue ()
+{
+	for (std::vector <TimerEntry *>::iterator iter = heap.begin (); iter != heap.end (); iter++)
+	{
+		delete (*iter)->event;
+		delete *iter;
+	}
+}
+
+timer_id_t TimerQueue::add (double t, Event *event)
+{
+	TimerEntry *entry = new TimerEntry;
+	entry->t = t;
+	entry->id = ++lastId;
+	entry->event = event;
+
+	std::list <TimerEntry *> &tl = types[event->getType ()];
+	entry->typeIter = tl.insert (tl.end (), entry);
+
+	ids[entry->id] = entry;
+
+	heap.push_back (entry);
+	entry->pos = heap.size () - 1;
+	siftUp (entry->pos);
+
+	return entry->id;
+}
+
+bool TimerQueue::cancel (timer_id_t id)
+{
+	std::map <timer_id_t, TimerEntry *>::iterator iter = ids.find (id);
+	if (iter == ids.end ())
+		return false;
+	TimerEntry *entry = iter->second;
+	remove (entry);
+	delete entry->event;
+	delete entry;
+	return true;
+}
+
+int TimerQueue::cancelType (int event_type)
+{
+	std::map <int, std::list <TimerEntry *> >::iterator ti = types.find (event_type);
+	if (ti == types.end ())
+		return 0;
+	// copy list, as remove modifies it
+	std::list <TimerEntry *> tl = ti->second;
+	for (std::list <TimerEntry *>::iterator iter = tl.begin (); iter != tl.end (); iter++)
+	{
+		remove (*iter);
+		delete (*iter)->event;
+		delete *iter;
+	}
+	return tl.size ();
+}
+
+Event *TimerQueue::popDue (double now, double &scheduled)
+{
+	if (heap.empty () || !(heap.front ()->t < now))
+		return NULL;
+	TimerEntry *entry = heap.front ();
+	remove (entry);
+	Event *ret = entry->event;
+	scheduled = entry->t;
+	delete entry;
+	return ret;
+}
+
+void TimerQueue::siftUp (size_t pos)
+{
+	TimerEntry *entry = heap[pos];
+	while (pos > 0)
+	{
+		size_t parent = (pos - 1) / 2;
+		if (!before (entry, heap[parent]))
+			break;
+		place (heap[parent], pos);
+		pos = parent;
+	}
+	place (entry, pos);
+}
+
+void TimerQueue::siftDown (size_t pos)
+{
+	TimerEntry *entry = heap[pos];
+	size_t n = heap.size ();
+	while (true)
+	{
+		size_t child = 2 * pos + 1;
+		if (child >= n)
+			break;
+		if (child + 1 < n && before (heap[child + 1], heap[child]))
+			child++;
+		if (!before (heap[child], entry))
+			break;
+		place (heap[child], pos);
+		pos = child;
+	}
+	place (entry, pos);
+}
+
+void TimerQueue::remove (TimerEntry *entry)
+{
+	std::map <int, std::list <TimerEntry *> >::iterator ti = types.find (entry->event->getType ());
+	ti->second.erase (entry->typeIter);
+	if (ti->second.empty ())
+		types.erase (ti);
+
+	ids.erase (entry->id);
+
+	size_t pos = entry->pos;
+	TimerEntry *last = heap.back ();
+	heap.pop_back ();
+	if (last == entry)
+		return;
+	place (last, pos);
+	if (pos > 0 && before (last, heap[(pos - 1) / 2]))
+		siftUp (pos);
+	else
+		siftDown (pos);
+}
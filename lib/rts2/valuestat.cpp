@@ -18,6 +18,7 @@
  */
 
 #include <algorithm>
+#include <math.h>
 
 #include "valuestat.h"
 #include "connection.h"
@@ -32,6 +33,9 @@ void ValueDoubleStat::clearStat ()
 	max = NAN;
 	stdev = NAN;
 	valueList.clear ();
+	lowerHalf.clear ();
+	upperHalf.clear ();
+	resetSums ();
 	changed ();
 }
 
@@ -39,31 +43,115 @@ void ValueDoubleStat::calculate ()
 {
 	if (valueList.size () == 0)
 		return;
-	std::deque < double >sorted = valueList;
-	std::sort (sorted.begin (), sorted.end ());
-	min = *(sorted.begin ());
-	max = *(--sorted.end ());
 	numMes = valueList.size ();
-	double sum = 0;
-	for (std::deque < double >::iterator iter = sorted.begin (); iter != sorted.end (); iter++)
+	min = *(lowerHalf.begin ());
+	max = upperHalf.empty () ? *(lowerHalf.rbegin ()) : *(upperHalf.rbegin ());
+	double avg = sum / numMes;
+	setValueDouble (shift + avg);
+	// variance from sums of squares, offset by shift cancels out
+	double var = sum2 / numMes - avg * avg;
+	stdev = var > 0 ? sqrt (var) : 0;
+	if ((numMes % 2) == 1)
+		mode = *(lowerHalf.rbegin ());
+	else
+		mode = (*(lowerHalf.rbegin ()) + *(upperHalf.begin ())) / 2.0;
+	changed ();
+}
+
+void ValueDoubleStat::addValue (double in_val)
+{
+	// NaN breaks ordering of sorted halves
+	if (isnan (in_val))
+		return;
+	if (valueList.empty ())
 	{
-		sum += (*iter);
+		shift = in_val;
+		sum = sum2 = 0;
+		removed = 0;
 	}
-	setValueDouble (sum / numMes);
-	// calculate stdev
-	stdev = 0;
-	for (std::deque < double >::iterator iter = sorted.begin (); iter != sorted.end (); iter++)
+	valueList.push_back (in_val);
+	insertSorted (in_val);
+	double d = in_val - shift;
+	sum += d;
+	sum2 += d * d;
+	changed ();
+}
+
+void ValueDoubleStat::addValue (double in_val, size_t maxQueSize)
+{
+	if (isnan (in_val))
+		return;
+	while (!valueList.empty () && valueList.size () >= maxQueSize)
 	{
-		sum = *iter - getValueDouble ();
-		sum *= sum;
-		stdev += sum;
+		double old = valueList.front ();
+		valueList.pop_front ();
+		eraseSorted (old);
+		double d = old - shift;
+		sum -= d;
+		sum2 -= d * d;
+		removed++;
 	}
-	stdev = sqrt (stdev / numMes);
-	if ((numMes % 2) == 1)
-		mode = sorted[numMes / 2];
+	// whole window was replaced since last recalculation
+	if (removed > valueList.size ())
+		resetSums ();
+	addValue (in_val);
+}
+
+void ValueDoubleStat::insertSorted (double in_val)
+{
+	if (lowerHalf.empty () || in_val <= *(lowerHalf.rbegin ()))
+		lowerHalf.insert (in_val);
 	else
-		mode = (sorted[numMes / 2 - 1] + sorted[numMes / 2]) / 2.0;
-	changed ();
+		upperHalf.insert (in_val);
+	balanceSorted ();
+}
+
+void ValueDoubleStat::eraseSorted (double in_val)
+{
+	std::multiset <double>::iterator iter;
+	if (!lowerHalf.empty () && in_val <= *(lowerHalf.rbegin ()))
+	{
+		iter = lowerHalf.find (in_val);
+		if (iter != lowerHalf.end ())
+			lowerHalf.erase (iter);
+	}
+	else
+	{
+		iter = upperHalf.find (in_val);
+		if (iter != upperHalf.end ())
+			upperHalf.erase (iter);
+	}
+	balanceSorted ();
+}
+
+void ValueDoubleStat::balanceSorted ()
+{
+	if (lowerHalf.size () > upperHalf.size () + 1)
+	{
+		std::multiset <double>::iterator iter = --lowerHalf.end ();
+		upperHalf.insert (*iter);
+		lowerHalf.erase (iter);
+	}
+	else if (upperHalf.size () > lowerHalf.size ())
+	{
+		std::multiset <double>::iterator iter = upperHalf.begin ();
+		lowerHalf.insert (*iter);
+		upperHalf.erase (iter);
+	}
+}
+
+void ValueDoubleStat::resetSums ()
+{
+	shift = valueList.empty () ? 0 : valueList.front ();
+	sum = 0;
+	sum2 = 0;
+	removed = 0;
+	for (std::deque < double >::iterator iter = valueList.begin (); iter != valueList.end (); iter++)
+	{
+		double d = *iter - shift;
+		sum += d;
+		sum2 += d * d;
+	}
 }
 
 ValueDoubleStat::ValueDoubleStat (std::string in_val_name):ValueDouble (in_val_name)
@@ -120,6 +208,11 @@ void ValueDoubleStat::setFromValue (Value * newValue)
 		max = ((ValueDoubleStat *) newValue)->getMax ();
 		stdev = ((ValueDoubleStat *) newValue)->getStdev ();
 		valueList = ((ValueDoubleStat *) newValue)->getMesList ();
+		lowerHalf.clear ();
+		upperHalf.clear ();
+		for (std::deque < double >::iterator iter = valueList.begin (); iter != valueList.end (); iter++)
+			insertSorted (*iter);
+		resetSums ();
 	}
 }
 
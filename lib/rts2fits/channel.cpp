@@ -25,6 +25,8 @@
 #include <malloc.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <iostream>
 
 using namespace rts2image;
@@ -86,77 +88,224 @@ Channel::~Channel ()
 	delete[] sizes;
 }
 
-template <typename pixel_type> void computeDataStatistics (pixel_type *data, long totalPixels, long double &pixelSum, double &average, double &stdev)
+/**
+ * Partial statistics of a block of pixels. Partials are merged with
+ * Chan et al. parallel variance formula.
+ */
+struct StatPartial
 {
-	// calculate average of all channels..
-	pixel_type *pixel = data;
-	pixel_type *fullTop = pixel + totalPixels;
+	long double sum;
+	double n;
+	double mean;
+	// sum of squared differences from the mean
+	double m2;
 
-	pixelSum = 0;
+	void clear ()
+	{
+		sum = 0;
+		n = 0;
+		mean = 0;
+		m2 = 0;
+	}
 
-	while (pixel < fullTop)
+	void merge (long double bsum, double bn, double bmean, double bm2)
 	{
-		pixelSum += *pixel;
-		pixel++;
+		if (bn == 0)
+			return;
+		double tn = n + bn;
+		double delta = bmean - mean;
+		sum += bsum;
+		mean += delta * bn / tn;
+		m2 += bm2 + delta * delta * n * bn / tn;
+		n = tn;
 	}
-	if (totalPixels > 0)
+};
+
+// pixels in block, summed with double accumulators relative to block first pixel
+#define STAT_BLOCK   4096
+
+template <typename pixel_type> void computeDataStatistics (const pixel_type *data, long totalPixels, StatPartial &partial)
+{
+	const pixel_type *fullTop = data + totalPixels;
+	for (const pixel_type *block = data; block < fullTop; block += STAT_BLOCK)
 	{
-		average = pixelSum / totalPixels;
-		// calculate stdev
-		pixel = data;
-		stdev = 0;
-		while (pixel < fullTop)
+		const pixel_type *top = block + STAT_BLOCK < fullTop ? block + STAT_BLOCK : fullTop;
+		double bn = top - block;
+		// shift by the first pixel, so sum of squares does not loose precision
+		double k = *block;
+		double s = 0;
+		double ss = 0;
+		for (const pixel_type *pixel = block; pixel < top; pixel++)
 		{
-			long double tmp_s = *pixel - average;
-			long double tmp_ss = tmp_s * tmp_s;
-			stdev += tmp_ss;
-			pixel++;
+			double d = *pixel - k;
+			s += d;
+			ss += d * d;
 		}
-		stdev = sqrt (stdev / totalPixels);
-	}
-	else
-	{
-		average = 0;
-		stdev = 0;
+		partial.merge ((long double) k * bn + s, bn, k + s / bn, ss - s * s / bn);
 	}
 }
 
-void Channel::computeStatistics (size_t _from, size_t _dataSize)
+/**
+ * Part of channel data, processed by one thread.
+ */
+struct StatTask
 {
-	if (_dataSize == 0)
-		_dataSize = getNPixels ();
-	switch (dataType)
+	int16_t dataType;
+	const char *data;
+	long nPixels;
+	StatPartial partial;
+};
+
+static void computeTaskStatistics (StatTask &task)
+{
+	task.partial.clear ();
+	switch (task.dataType)
 	{
 		case RTS2_DATA_BYTE:
-			computeDataStatistics ((unsigned char *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const unsigned char *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_SHORT:
-			computeDataStatistics ((int16_t *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const int16_t *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_LONG:
-			computeDataStatistics ((int32_t *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const int32_t *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_LONGLONG:
-			computeDataStatistics ((int64_t *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const int64_t *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_FLOAT:
-			computeDataStatistics ((float *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const float *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_DOUBLE:
-			computeDataStatistics ((double *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const double *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_SBYTE:
-			computeDataStatistics ((signed char *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const signed char *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_USHORT:
-			computeDataStatistics ((uint16_t *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const uint16_t *) task.data, task.nPixels, task.partial);
 			break;
 		case RTS2_DATA_ULONG:
-			computeDataStatistics ((uint32_t *) (getData ()) + _from, _dataSize, pixelSum, average, stdev);
+			computeDataStatistics ((const uint32_t *) task.data, task.nPixels, task.partial);
+			break;
+	}
+}
+
+struct StatWorkers
+{
+	std::vector <StatTask> *tasks;
+	pthread_mutex_t lock;
+	size_t next;
+};
+
+static void *statisticsWorker (void *arg)
+{
+	StatWorkers *w = (StatWorkers *) arg;
+	while (true)
+	{
+		pthread_mutex_lock (&(w->lock));
+		size_t i = w->next++;
+		pthread_mutex_unlock (&(w->lock));
+		if (i >= w->tasks->size ())
 			break;
-		default:
+		computeTaskStatistics ((*(w->tasks))[i]);
+	}
+	return NULL;
+}
+
+int Channels::statisticsThreads = 0;
+
+// do not split smaller parts between threads
+#define STAT_MIN_PIXELS  (1024 * 1024)
+
+int Channels::getStatisticsThreads ()
+{
+	if (statisticsThreads > 0)
+		return statisticsThreads;
+	long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? cpus : 1;
+}
+
+static void computeChannelsStatistics (std::vector <Channel *> &chs, size_t _from, size_t _dataSize, int nthreads)
+{
+	std::vector <StatTask> tasks;
+	// index of the first task of each channel
+	std::vector <size_t> firstTask;
+
+	for (std::vector <Channel *>::iterator iter = chs.begin (); iter != chs.end (); iter++)
+	{
+		Channel *ch = *iter;
+		long n = _dataSize == 0 ? ch->getNPixels () : _dataSize;
+		int ps = ch->getPixelByteSize ();
+		if (ps <= 0)
 			throw rts2core::Error ("unknow dataType");
+		long part = n / nthreads + 1;
+		if (part < STAT_MIN_PIXELS)
+			part = STAT_MIN_PIXELS;
+		firstTask.push_back (tasks.size ());
+		const char *d = ch->getData () + _from * ps;
+		for (long p = 0; p < n; p += part)
+		{
+			StatTask t;
+			t.dataType = ch->getDataType ();
+			t.data = d + p * ps;
+			t.nPixels = p + part < n ? part : n - p;
+			tasks.push_back (t);
+		}
+	}
+	firstTask.push_back (tasks.size ());
+
+	if (nthreads > (int) tasks.size ())
+		nthreads = tasks.size ();
+
+	if (nthreads <= 1)
+	{
+		for (std::vector <StatTask>::iterator iter = tasks.begin (); iter != tasks.end (); iter++)
+			computeTaskStatistics (*iter);
 	}
+	else
+	{
+		StatWorkers w;
+		w.tasks = &tasks;
+		w.next = 0;
+		pthread_mutex_init (&(w.lock), NULL);
+
+		std::vector <pthread_t> threads;
+		for (int i = 1; i < nthreads; i++)
+		{
+			pthread_t th;
+			if (pthread_create (&th, NULL, statisticsWorker, &w) == 0)
+				threads.push_back (th);
+		}
+		// calling thread works as well
+		statisticsWorker (&w);
+		for (std::vector <pthread_t>::iterator iter = threads.begin (); iter != threads.end (); iter++)
+			pthread_join (*iter, NULL);
+
+		pthread_mutex_destroy (&(w.lock));
+	}
+
+	int c = 0;
+	for (std::vector <Channel *>::iterator iter = chs.begin (); iter != chs.end (); iter++, c++)
+	{
+		StatPartial total;
+		total.clear ();
+		for (size_t i = firstTask[c]; i < firstTask[c + 1]; i++)
+			total.merge (tasks[i].partial.sum, tasks[i].partial.n, tasks[i].partial.mean, tasks[i].partial.m2);
+		(*iter)->setStatistics (total.sum, total.n > 0 ? total.mean : 0, total.n > 0 ? sqrt (total.m2 / total.n) : 0);
+	}
+}
+
+void Channel::computeStatistics (size_t _from, size_t _dataSize)
+{
+	std::vector <Channel *> chs;
+	chs.push_back (this);
+	computeChannelsStatistics (chs, _from, _dataSize, Channels::getStatisticsThreads ());
+}
+
+void Channels::computeStatistics (size_t _from, size_t _dataSize)
+{
+	computeChannelsStatistics (*this, _from, _dataSize, getStatisticsThreads ());
 }
 
 Channels::Channels ()
@@ -20,6 +20,7 @@
 #include <ctype.h>
 
 #include "rts2fits/devcliimg.h"
+#include "rts2fits/fitswriter.h"
 #include "iniparser.h"
 #include "configuration.h"
 #include "valuerectangle.h"
@@ -73,8 +74,23 @@ DevClientCameraImage::DevClientCameraImage (rts2core::Connection * in_connection
 		}
 	}
 
+	// tile compression of stored images
+	std::string compression;
+	config->getString (connection->getName (), "compression", compression, "none");
+	compressType = Image::getCompressionType (compression.c_str ());
+	if (compressType < 0)
+	{
+		logStream (MESSAGE_ERROR) << "unknown compression " << compression << " for camera " << connection->getName () << ", images will not be compressed" << sendLog;
+		compressType = 0;
+	}
+	config->getFloat (connection->getName (), "quantize", compressQuantize, 0);
+
 	actualImage = NULL;
 
+	// start writer thread, so images are written outside of the main loop
+	if (config->getWriteQueue () > 0)
+		FitsWriter::start (getMaster (), config->getWriteQueue ());
+
 	expNum = 0;
 
 	triggered = false;
@@ -82,6 +98,10 @@ DevClientCameraImage::DevClientCameraImage (rts2core::Connection * in_connection
 
 DevClientCameraImage::~DevClientCameraImage (void)
 {
+	for (std::map <unsigned long, CameraImage *>::iterator iter = writingImages.begin (); iter != writingImages.end (); iter++)
+	{
+		delete iter->second;
+	}
 	delete fitsTemplate;
 	delete actualImage;
 }
@@ -153,14 +173,38 @@ void DevClientCameraImage::postEvent (rts2core::Event * event)
 				delete iter->second;
 			}
 			images.clear ();
+			// images are still written by the writer, but will not be processed
+			for (std::map <unsigned long, CameraImage *>::iterator iter = writingImages.begin (); iter != writingImages.end (); iter++)
+			{
+				delete iter->second;
+			}
+			writingImages.clear ();
 			delete actualImage;
 			actualImage = NULL;
 			break;
 		case EVENT_NUMBER_OF_IMAGES:
-			*((int *)event->getArg ()) += images.size ();
+			*((int *)event->getArg ()) += images.size () + writingImages.size ();
 			if (actualImage)
 				*((int *)event->getArg ()) += 1;
 			break;
+		case EVENT_IMAGE_WRITTEN:
+			{
+				unsigned long job = ((FitsWriter::Job *) event->getArg ())->id;
+				std::map <unsigned long, CameraImage *>::iterator iter = writingImages.find (job);
+				if (iter != writingImages.end ())
+				{
+					processSavedImage (iter->second);
+					// processing might kill all images
+					iter = writingImages.find (job);
+					if (iter != writingImages.end ())
+					{
+						delete iter->second;
+						writingImages.erase (iter);
+						checkAllImagesWritten ();
+					}
+				}
+			}
+			break;
 		case EVENT_METADATA_TIMEOUT:
 			if (checkImages.size ())
 			{
@@ -181,6 +225,7 @@ void DevClientCameraImage::cameraMetadata (Image *image)
 {
 	double exposureTime = getConnection ()->getValueDouble ("exposure");
 	image->setTemplate (fitsTemplate);
+	image->setCompression (compressType, compressQuantize);
 
 	image->setExposureLength (exposureTime);
 	
@@ -525,6 +570,7 @@ void DevClientCameraImage::processCameraImage (CameraImages::iterator cis)
 	{
 		checkImages.erase (chi);
 	}
+	bool saved = true;
 	try
 	{
 		writeFilter (ci->image);
@@ -534,24 +580,53 @@ void DevClientCameraImage::processCameraImage (CameraImages::iterator cis)
 		{
 			// set filter..
 			// save us to the disk..
+			ci->image->setAsyncWrite (true);
 			ci->image->saveImage ();
+			if (FitsWriter::instance ())
+				getMaster ()->postEvent (new rts2core::Event (EVENT_WRITER_QUEUE, (void *) FitsWriter::instance ()));
+			// image is being written in the writer thread, processing will continue once it is on the disk
+			if (ci->image->getWriteJob ())
+			{
+				images.erase (cis);
+				writingImages[ci->image->getWriteJob ()] = ci;
+				return;
+			}
 		}
+	}
+	catch (rts2core::Error &ex)
+	{
+		logStream (MESSAGE_WARNING) << "Cannot save image " << ci->image->getAbsoluteFileName () << " " << ex << sendLog;
+		saved = false;
+	}
+	if (saved)
+		processSavedImage (ci);
+
+	delete ci;
+	images.erase (cis);
+	checkAllImagesWritten ();
+}
+
+void DevClientCameraImage::processSavedImage (CameraImage *ci)
+{
+	try
+	{
 		// do basic processing
 		imageProceRes res = processImage (ci->image);
 		if (res == IMAGE_KEEP_COPY)
 		{
-			setImage (ci->image, NULL);
+			ci->image = NULL;
 		}
 	}
 	catch (rts2core::Error &ex)
 	{
-		logStream (MESSAGE_WARNING) << "Cannot save image " << ci->image->getAbsoluteFileName () << " " << ex << sendLog;
+		logStream (MESSAGE_WARNING) << "Cannot process image " << ci->image->getAbsoluteFileName () << " " << ex << sendLog;
 	}
+}
 
-	delete ci;
-	images.erase (cis);
+void DevClientCameraImage::checkAllImagesWritten ()
+{
 	// send event that there aren't any images waiting to be written
-	if (images.size () == 0 && actualImage == NULL)
+	if (images.size () == 0 && writingImages.size () == 0 && actualImage == NULL)
 		getMaster ()->postEvent (new rts2core::Event (EVENT_ALL_IMAGES_WRITTEN));
 }
 
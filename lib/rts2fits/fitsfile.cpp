@@ -19,6 +19,7 @@
  */
 
 #include "rts2fits/fitsfile.h"
+#include "rts2fits/fitswriter.h"
 
 #include "configuration.h"
 
@@ -88,6 +89,8 @@ FitsFile::FitsFile ():rts2core::Expander ()
 	memOverwrite = false;
 	memsize = NULL;
 	imgbuf = NULL;
+	asyncWrite = false;
+	writeJob = 0;
 	ffile = NULL;
 	fileName = NULL;
 	absoluteFileName = NULL;
@@ -111,6 +114,9 @@ FitsFile::FitsFile (FitsFile * _fitsfile):rts2core::Expander (_fitsfile)
 	_fitsfile->memsize = NULL;
 	_fitsfile->imgbuf = NULL;
 
+	asyncWrite = _fitsfile->asyncWrite;
+	writeJob = _fitsfile->writeJob;
+
 	setFileName (_fitsfile->getFileName ());
 
 	fits_status = _fitsfile->fits_status;
@@ -123,6 +129,8 @@ FitsFile::FitsFile (const char *_fileName, bool _overwrite):rts2core::Expander (
 	memOverwrite = false;
 	memsize = NULL;
 	imgbuf = NULL;
+	asyncWrite = false;
+	writeJob = 0;
 	fileName = NULL;
 	absoluteFileName = NULL;
 	fits_status = 0;
@@ -138,6 +146,8 @@ FitsFile::FitsFile (const struct timeval *_tv):rts2core::Expander (_tv)
 	memOverwrite = false;
 	memsize = NULL;
 	imgbuf = NULL;
+	asyncWrite = false;
+	writeJob = 0;
 	ffile = NULL;
 	fileName = NULL;
 	absoluteFileName = NULL;
@@ -151,6 +161,8 @@ FitsFile::FitsFile (const char *_expression, const struct timeval *_tv, bool _ov
 	memOverwrite = false;
 	memsize = NULL;
 	imgbuf = NULL;
+	asyncWrite = false;
+	writeJob = 0;
 	fileName = NULL;
 	absoluteFileName = NULL;
 	fits_status = 0;
@@ -211,6 +223,20 @@ int FitsFile::closeFile ()
 		{
 			memFile = false;
 			// only save file if its path was specified
+			if (getFileName () && asyncWrite && FitsWriter::instance ())
+			{
+				writeJob = FitsWriter::instance ()->queue (getFitsFile (), imgbuf, memsize, getFileName (), memOverwrite);
+				if (writeJob)
+				{
+					// writer now owns memory file and its buffer
+					imgbuf = NULL;
+					memsize = NULL;
+					flags &= ~IMAGE_SAVE;
+					setFitsFile (NULL);
+					return 0;
+				}
+				FitsWriter::instance ()->overflow ();
+			}
 			if (getFileName ())
 			{
 				fitsfile *ofptr = getFitsFile ();
@@ -698,6 +724,40 @@ void FitsFile::getValues (const char *name, long *values, int num, bool required
 	fitsStatusGetValue (name, required);
 }
 
+void FitsFile::getImageSize (long *sizes, int num)
+{
+	if (!getFitsFile ())
+		throw ErrorOpeningFitsFile (getFileName ());
+
+	fits_status = 0;
+	int current;
+	fits_get_hdu_num (getFitsFile (), &current);
+
+	int tothdu = getTotalHDUs ();
+	bool found = false;
+	for (int hdu = 1; hdu <= tothdu && !found; hdu++)
+	{
+		int hdutype;
+		int naxis = 0;
+		fits_movabs_hdu (getFitsFile (), hdu, &hdutype, &fits_status);
+		if (fits_status == 0 && hdutype == IMAGE_HDU)
+			fits_get_img_dim (getFitsFile (), &naxis, &fits_status);
+		if (fits_status)
+			break;
+		if (naxis >= num)
+		{
+			fits_get_img_size (getFitsFile (), num, sizes, &fits_status);
+			found = fits_status == 0;
+		}
+	}
+
+	int ret = fits_status;
+	fits_status = 0;
+	fits_movabs_hdu (getFitsFile (), current, NULL, &fits_status);
+	if (ret || !found)
+		throw KeyNotFound (this, "NAXIS");
+}
+
 void FitsFile::getValues (const char *name, double *values, int num, bool required, int nstart)
 {
 	if (!getFitsFile ())
@@ -0,0 +1,250 @@
+/*
+ * Background writer of in-memory FITS files.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2fits/fitswriter.h"
+#include "block.h"
+#include "utilsfunc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace rts2image;
+
+FitsWriter *FitsWriter::pInstance = NULL;
+
+FitsWriter::FitsWriter (rts2core::Block *_master, int _maxQueue, int notifyFd):rts2core::ConnNoSend (notifyFd, _master)
+{
+	maxQueue = _maxQueue;
+	notifyWrite = -1;
+
+	lastId = 0;
+	inFlight = 0;
+	bytesPending = 0;
+	overflows = 0;
+	failed = 0;
+
+	running = false;
+	stop = false;
+
+	pthread_mutex_init (&mutex, NULL);
+	pthread_cond_init (&cond, NULL);
+}
+
+FitsWriter::~FitsWriter ()
+{
+	if (running)
+	{
+		// let the thread finish queued images
+		pthread_mutex_lock (&mutex);
+		stop = true;
+		pthread_cond_broadcast (&cond);
+		pthread_mutex_unlock (&mutex);
+
+		pthread_join (thread, NULL);
+	}
+
+	for (std::list <Job>::iterator iter = finished.begin (); iter != finished.end (); iter++)
+	{
+		if (iter->failed)
+			logStream (MESSAGE_ERROR) << "cannot write " << iter->fileName << sendLog;
+	}
+
+	if (notifyWrite >= 0)
+		close (notifyWrite);
+
+	pthread_cond_destroy (&cond);
+	pthread_mutex_destroy (&mutex);
+
+	if (pInstance == this)
+		pInstance = NULL;
+}
+
+FitsWriter *FitsWriter::start (rts2core::Block *master, int maxQueue)
+{
+	if (pInstance)
+		return pInstance;
+
+	if (!fits_is_reentrant ())
+	{
+		logStream (MESSAGE_WARNING) << "cfitsio library is not thread safe, images will be written synchronously" << sendLog;
+		return NULL;
+	}
+
+	int notifyPipe[2];
+	if (pipe (notifyPipe))
+	{
+		logStream (MESSAGE_ERROR) << "cannot create FITS writer pipe: " << strerror (errno) << sendLog;
+		return NULL;
+	}
+	fcntl (notifyPipe[0], F_SETFL, O_NONBLOCK);
+	fcntl (notifyPipe[1], F_SETFL, O_NONBLOCK);
+
+	FitsWriter *writer = new FitsWriter (master, maxQueue, notifyPipe[0]);
+	writer->notifyWrite = notifyPipe[1];
+
+	int ret = pthread_create (&(writer->thread), NULL, writeImages, (void *) writer);
+	if (ret)
+	{
+		logStream (MESSAGE_ERROR) << "cannot start FITS writer thread: " << strerror (ret) << sendLog;
+		delete writer;
+		return NULL;
+	}
+	writer->running = true;
+
+	master->addConnection (writer);
+	pInstance = writer;
+	return pInstance;
+}
+
+unsigned long FitsWriter::queue (fitsfile *memFile, void **imgbuf, size_t *memsize, const char *fileName, bool overwrite)
+{
+	if (inFlight >= (size_t) maxQueue)
+		return 0;
+
+	Job job;
+	job.id = ++lastId;
+	job.memFile = memFile;
+	job.imgbuf = imgbuf;
+	job.memsize = memsize;
+	job.fileName = std::string (fileName);
+	job.overwrite = overwrite;
+	job.size = *memsize;
+	job.failed = false;
+
+	inFlight++;
+	bytesPending += job.size;
+
+	pthread_mutex_lock (&mutex);
+	pending.push_back (job);
+	pthread_cond_signal (&cond);
+	pthread_mutex_unlock (&mutex);
+
+	return job.id;
+}
+
+int FitsWriter::receive (rts2core::Block *block)
+{
+	if (sock < 0 || !(block->getPollEvents (sock) & (POLLIN | POLLPRI)))
+		return 0;
+
+	char notify[100];
+	while (read (sock, notify, sizeof (notify)) > 0)
+		;
+
+	std::list <Job> done;
+	pthread_mutex_lock (&mutex);
+	done.swap (finished);
+	pthread_mutex_unlock (&mutex);
+
+	for (std::list <Job>::iterator iter = done.begin (); iter != done.end (); iter++)
+	{
+		inFlight--;
+		bytesPending -= iter->size;
+		if (iter->failed)
+		{
+			failed++;
+			logStream (MESSAGE_ERROR) << "cannot write " << iter->fileName << sendLog;
+		}
+		block->postEvent (new rts2core::Event (EVENT_IMAGE_WRITTEN, (void *) &(*iter)));
+	}
+
+	if (!done.empty ())
+		block->postEvent (new rts2core::Event (EVENT_WRITER_QUEUE, (void *) this));
+
+	return 0;
+}
+
+void *FitsWriter::writeImages (void *arg)
+{
+	FitsWriter *writer = (FitsWriter *) arg;
+
+	pthread_mutex_lock (&writer->mutex);
+	while (true)
+	{
+		while (writer->pending.empty () && !writer->stop)
+			pthread_cond_wait (&writer->cond, &writer->mutex);
+		// finish writing queued images before stopping
+		if (writer->pending.empty ())
+			break;
+
+		Job job = writer->pending.front ();
+		writer->pending.pop_front ();
+		pthread_mutex_unlock (&writer->mutex);
+
+		writer->writeJob (job);
+
+		pthread_mutex_lock (&writer->mutex);
+		writer->finished.push_back (job);
+		// wake up main loop; if the pipe is full, main loop will be woken up anyway
+		ssize_t ret = write (writer->notifyWrite, "", 1);
+		(void) ret;
+	}
+	pthread_mutex_unlock (&writer->mutex);
+	return NULL;
+}
+
+void FitsWriter::writeJob (Job &job)
+{
+	int fits_status = 0;
+	fitsfile *ofptr = NULL;
+
+	if (mkpath (job.fileName.c_str (), 0777))
+	{
+		job.failed = true;
+	}
+	else
+	{
+		if (job.overwrite)
+			unlink (job.fileName.c_str ());
+
+		fits_create_file (&ofptr, job.fileName.c_str (), &fits_status);
+		if (fits_status == 0)
+			fits_copy_file (job.memFile, ofptr, 1, 1, 1, &fits_status);
+		if (ofptr)
+			fits_close_file (ofptr, &fits_status);
+
+		if (fits_status)
+		{
+			job.failed = true;
+		}
+		else
+		{
+			// make sure data are on disk before image is reported as written
+			int fd = open (job.fileName.c_str (), O_RDONLY);
+			if (fd < 0 || fsync (fd))
+				job.failed = true;
+			if (fd >= 0)
+				close (fd);
+		}
+	}
+
+	// memfile MUST be closed before its memory is freed
+	fits_status = 0;
+	fits_close_file (job.memFile, &fits_status);
+	free (*(job.imgbuf));
+	delete job.imgbuf;
+	delete job.memsize;
+
+	job.memFile = NULL;
+	job.imgbuf = NULL;
+	job.memsize = NULL;
+}
@@ -115,6 +115,9 @@ void Image::initData ()
 
 	writeConnection = true;
 	writeRTS2Values = true;
+
+	compressType = 0;
+	quantize = 0;
 }
 
 
@@ -179,6 +182,9 @@ Image::Image (Image * in_image):FitsFile (in_image)
 
 	shutter = in_image->getShutter ();
 
+	compressType = in_image->compressType;
+	quantize = in_image->quantize;
+
 	// other image will be saved!
 	flags = in_image->flags;
 	//in_image->flags &= ~IMAGE_SAVE;
@@ -969,7 +975,7 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 
 	// either put it as a new extension, or keep it in primary..
 
-	if (nchan == 1)
+	if (nchan == 1 && compressType == 0)
 	{
 		if (dataType == RTS2_DATA_SBYTE)
 			fits_resize_img (getFitsFile (), RTS2_DATA_BYTE, 2, sizes, &fits_status);
@@ -981,8 +987,12 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 			return -1;
 		}
 	}
-	else if (nchan > 1)
+	else if (nchan >= 1)
 	{
+		// compressed images are always written to extensions
+		if (compressType)
+			setDataCompression ();
+
 		if (dataType == RTS2_DATA_SBYTE)
 		{
 			fits_create_img (getFitsFile (), RTS2_DATA_BYTE, 2, sizes, &fits_status);
@@ -1044,6 +1054,10 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 		}
 	}
 
+	// keep writing headers to the primary HDU, as with uncompressed image
+	if (nchan == 1 && compressType)
+		moveHDU (1);
+
 	if (writeRTS2Values)
 	{
 		ch->computeStatistics (0, pixelSize);
@@ -1054,6 +1068,44 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 	return ret;
 }
 
+int Image::getCompressionType (const char *name)
+{
+	if (name == NULL || *name == '\0' || !strcasecmp (name, "none"))
+		return 0;
+	if (!strcasecmp (name, "rice"))
+		return RICE_1;
+	if (!strcasecmp (name, "gzip"))
+		return GZIP_1;
+	if (!strcasecmp (name, "gzip2"))
+		return GZIP_2;
+	if (!strcasecmp (name, "hcompress"))
+		return HCOMPRESS_1;
+	if (!strcasecmp (name, "plio"))
+		return PLIO_1;
+	return -1;
+}
+
+void Image::setDataCompression ()
+{
+	int ct = compressType;
+	switch (dataType)
+	{
+		case RTS2_DATA_FLOAT:
+		case RTS2_DATA_DOUBLE:
+			// unquantized floating point data can be compressed only with gzip
+			if (quantize == 0 && ct != GZIP_1 && ct != GZIP_2)
+				ct = GZIP_2;
+			fits_set_quantize_level (getFitsFile (), quantize, &fits_status);
+			break;
+	}
+	fits_set_compression_type (getFitsFile (), ct, &fits_status);
+	if (fits_status)
+	{
+		logStream (MESSAGE_ERROR) << "cannot set image compression: " << getFitsErrors () << sendLog;
+		fits_status = 0;
+	}
+}
+
 void Image::getImgHeader (struct imghdr *im_h, int chan)
 {
 	int i;
@@ -1726,6 +1778,32 @@ void Image::writeAsBlob (Magick::Blob &blob, const char * label, float quantiles
 	}
 }
 
+void Image::writePreviewBlob (Magick::Blob &blob, int prevsize, const char * label, float quantiles, int chan, int colourVariant)
+{
+	Magick::Image *image = NULL;
+	try
+	{
+		image = getMagickImage (NULL, quantiles, chan, colourVariant);
+		if (prevsize > 0)
+		{
+			image->zoom (Magick::Geometry (prevsize, prevsize));
+			writeLabel (image, 0, image->size ().height (), 10, label);
+		}
+		else
+		{
+			writeLabel (image, 1, image->rows () - 2, 10, label);
+		}
+		image->write (&blob, "jpeg");
+		delete image;
+	}
+	catch (Magick::Exception &ex)
+	{
+		logStream (MESSAGE_ERROR) << "Cannot create preview " << ex.what () << sendLog;
+		delete image;
+		throw ex;
+	}
+}
+
 #endif /* RTS2_HAVE_LIBJPEG */
 
 double Image::getAstrometryErr ()
@@ -1868,10 +1946,10 @@ void Image::computeStatistics (size_t _from, size_t _dataSize)
 
 	avg_stdev = 0;
 
+	channels.computeStatistics (_from, _dataSize);
+
 	for (Channels::iterator iter = channels.begin (); iter != channels.end (); iter++)
 	{
-		(*iter)->computeStatistics (_from, _dataSize);
-
 		totalSize += (*iter)->getNPixels ();
 		pixelSum += (*iter)->getPixelSum ();
 		avg_stdev += (*iter)->getStDev ();
@@ -1926,9 +2004,15 @@ void Image::loadChannels ()
 		if (hdutype != IMAGE_HDU)
 			continue;
 
-		// check that it has some axis..
+		// check that it has some axis; NAXIS keywords of tile-compressed
+		// image describe table with compressed data, so image routines must be used
 		int naxis = 0;
-		getValue ("NAXIS", naxis, true);
+		fits_get_img_dim (getFitsFile (), &naxis, &fits_status);
+		if (fits_status)
+		{
+			logStream (MESSAGE_ERROR) << "cannot retrieve image dimensions: " << getFitsErrors () << sendLog;
+			return;
+		}
 		if (naxis == 0)
 			continue;
 
@@ -1952,7 +2036,12 @@ void Image::loadChannels ()
 
 		// get its size..
 		long sizes[naxis];
-		getValues ("NAXIS", sizes, naxis, true);
+		fits_get_img_size (getFitsFile (), naxis, sizes, &fits_status);
+		if (fits_status)
+		{
+			logStream (MESSAGE_ERROR) << "cannot retrieve image size: " << getFitsErrors () << sendLog;
+			return;
+		}
 
 		long pixelSize = sizes[0];
 		for (int i = 1; i < naxis; i++)
@@ -31,6 +31,7 @@ AsyncAPI::AsyncAPI (JSONRequest *_req, rts2core::Connection *_conn, XmlRpc::XmlR
 	conn = _conn;
 	source = _source;
 	ext = _ext;
+	dispatched = 0;
 }
 
 AsyncAPI::~AsyncAPI ()
@@ -108,22 +109,34 @@ void AsyncValueAPI::valueChanged (rts2core::Connection *_conn, rts2core::Value *
 	if (source == NULL)
 		return;
 
+	dispatched++;
+	sendValue (SubscriptionIndex <AsyncAPI *>::getDeviceName (_conn), _conn, _value);
+}
+
+void AsyncValueAPI::subscribe (SubscriptionIndex <AsyncAPI *> &index)
+{
+	for (std::vector <std::string>::iterator iter = devices.begin (); iter != devices.end (); iter++)
+		index.subscribe (iter->c_str (), NULL, this);
+	for (std::vector <std::pair <std::string, std::string> >::iterator iter = values.begin (); iter != values.end (); iter++)
+		index.subscribe (iter->first.c_str (), iter->second.c_str (), this);
+}
+
+std::string AsyncValueAPI::getSubscriptions ()
+{
+	std::ostringstream os;
 	for (std::vector <std::string>::iterator iter = devices.begin (); iter != devices.end (); iter++)
 	{
-		if (*iter == _conn->getName ())
-		{
-			sendValue (*iter, _value);
-			return;
-		}
+		if (iter != devices.begin ())
+			os << ",";
+		os << *iter << ".*";
 	}
 	for (std::vector <std::pair <std::string, std::string> >::iterator iter = values.begin (); iter != values.end (); iter++)
 	{
-		if (iter->first == _conn->getName () && _value->isValue (iter->second.c_str ()))
-		{
-			sendValue (iter->first, _value);
-			return;
-		}
+		if (iter != values.begin () || !devices.empty ())
+			os << ",";
+		os << iter->first << "." << iter->second;
 	}
+	return os.str ();
 }
 
 void AsyncValueAPI::sendAll (rts2core::Device *device)
@@ -159,26 +172,27 @@ void AsyncValueAPI::sendAll (rts2core::Device *device)
 
 		for (rts2core::ValueVector::iterator viter = _conn->valueBegin (); viter != _conn->valueEnd (); viter++)
 		{
-			sendValue (*iter, *viter);
+			sendValue (*iter, _conn, *viter);
 		}
 		return;
 	}
 	for (std::vector <std::pair <std::string, std::string> >::iterator iter = values.begin (); iter != values.end (); iter++)
 	{
+		rts2core::Connection *con = NULL;
 		if (iter->first == device->getDeviceName ())
 		{
 			val = device->getOwnValue (iter->second.c_str ());
 		}
 		else
 		{
-			rts2core::Connection *con = device->getOpenConnection (iter->first.c_str ());
+			con = device->getOpenConnection (iter->first.c_str ());
 			if (con == NULL)
 				throw XmlRpc::JSONException ("cannot find opened connection with name " + iter->first);
 			val = con->getValue (iter->second.c_str ());
 		}
 		if (val == NULL)
 			throw XmlRpc::JSONException ("cannot find value " + iter->first + "." + iter->second);
-		sendValue (iter->first, val);
+		sendValue (iter->first, con, val);
 	}
 }
 
@@ -201,12 +215,20 @@ void AsyncValueAPI::sendState (std::list <AsyncState>::iterator astate, rts2core
 	source->sendChunked (os.str ());
 }
 
-void AsyncValueAPI::sendValue (const std::string &device, rts2core::Value *_value)
+void AsyncValueAPI::sendValue (const std::string &device, rts2core::Connection *_conn, rts2core::Value *_value)
 {
 	std::ostringstream os;
 	os << std::fixed << "{\"d\":\"" << device << "\",\"t\":" << getNow () << ",\"v\":{";
-	rts2json::jsonValue (_value, true, os);
-	os << "}}";
+	rts2json::DevInterface *di = NULL;
+	if (_conn)
+		di = rts2json::getDevInterface (_conn);
+	if (di)
+		os << di->getJsonValue (_value, true) << "},\"g\":" << di->getGeneration () << "}";
+	else
+	{
+		rts2json::jsonValue (_value, true, os);
+		os << "}}";
+	}
 	if (source == NULL || source->sendChunked (os.str ()) == false)
 		asyncFinished ();
 }
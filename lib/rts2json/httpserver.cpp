@@ -26,6 +26,7 @@ using namespace rts2json;
 void HTTPServer::registerAPI (AsyncAPI *a)
 {
 	asyncAPIs.push_back (a);
+	a->subscribe (subscriptions);
 	if (sumAsync)
 	{
 		sumAsync->inc ();
@@ -45,6 +46,7 @@ void HTTPServer::asyncIdle ()
 	{
 		if ((*iter)->idle ())
 		{
+			subscriptions.unsubscribe (*iter);
 			delete *iter;
 			iter = asyncAPIs.erase (iter);
 			numberAsyncAPIs->setValueInteger (asyncAPIs.size ());
@@ -71,10 +71,11 @@
  * @subsection Example
  *
  * http://localhost:8889/fits/images/2011.1210/0001.fits
+ * http://localhost:8889/fits/images/2011.1210/0001.fits?uncompress=1
  *
  * @subsection Parameters
  *
- * None.
+ *  - <i><b>uncompress</b> if true, tile-compressed images are uncompressed before the file is sent. Default to false, file is sent as it is stored on the disk.</i>
  *
  * @subsection Return
  *
@@ -110,6 +111,11 @@
 
 using namespace rts2json;
 
+bool rts2json::fitsReentrant ()
+{
+	return fits_is_reentrant ();
+}
+
 const char *Previewer::style ()
 {
 	return ".normal { border: 5px solid white; } .hig { border: 5px solid navy; }";
@@ -225,12 +231,24 @@ void Previewer::pageLink (std::ostringstream& _os, int i, int pagesiz, int prevs
 #include <Magick++.h>
 using namespace Magick;
 
+/**
+ * Open cached preview. Returns file descriptor of cached JPEG, or -1 if
+ * preview is not cached; then key holds cache key for the new preview (or
+ * is empty if cache is not used).
+ */
+static int getCachedPreview (rts2core::ThumbnailCache *cache, const char *path, int prevsize, const char *label, float quantiles, int chan, int colourVariant, std::string &key, size_t &length)
+{
+	struct stat st;
+	key = "";
+	if (cache == NULL || stat (path, &st))
+		return -1;
+	key = rts2core::ThumbnailCache::makeKey (st, prevsize, label, quantiles, chan, colourVariant);
+	return cache->get (key, length);
+}
+
 void JpegImageRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
 {
 	response_type = "image/jpeg";
-	rts2image::Image image;
-	image.openFile (path.c_str (), true, false);
-	Blob blob;
 
 	const char * label = params->getString ("lb", getServer ()->getDefaultImageLabel ());
 
@@ -238,16 +256,30 @@ void JpegImageRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::str
 	int chan = params->getInteger ("chan", getServer ()->getDefaultChannel ());
 	int colourVariant = params->getInteger ("cv", DEFAULT_COLOURVARIANT);
 
-	Magick::Image *mimage = image.getMagickImage (label, quantiles, chan, colourVariant);
-
 	cacheMaxAge (CACHE_MAX_STATIC);
 
-	mimage->write (&blob, "jpeg");
+	// full images are rendered differently from previews, use -1 as preview size in cache key
+	rts2core::ThumbnailCache *cache = getServer ()->getThumbnailCache ();
+	std::string key;
+	int fd = getCachedPreview (cache, path.c_str (), -1, label, quantiles, chan, colourVariant, key, response_length);
+	if (fd >= 0)
+	{
+		setResponseFile (fd, response_length, response, response_length);
+		return;
+	}
+
+	rts2image::Image image;
+	image.openFile (path.c_str (), true, false);
+	Blob blob;
+
+	image.writeAsBlob (blob, label, quantiles, chan, colourVariant);
+
 	response_length = blob.length();
 	response = new char[response_length];
 	memcpy (response, blob.data(), response_length);
 
-	delete mimage;
+	if (key.length () > 0)
+		cache->put (key, blob.data (), blob.length ());
 }
 
 void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
@@ -275,29 +307,29 @@ void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string p
 	{
 		response_type = "image/jpeg";
 
-		rts2image::Image image;
-		image.openFile (absPath, true, false);
-		Blob blob;
+		cacheMaxAge (CACHE_MAX_STATIC);
 
-		Magick::Image *mimage = image.getMagickImage (NULL, quantiles, chan, colourVariant);
-		if (prevsize > 0)
+		rts2core::ThumbnailCache *cache = getServer ()->getThumbnailCache ();
+		std::string key;
+		int fd = getCachedPreview (cache, absPath, prevsize, label, quantiles, chan, colourVariant, key, response_length);
+		if (fd >= 0)
 		{
-			mimage->zoom (Magick::Geometry (prevsize, prevsize));
-			image.writeLabel (mimage, 0, mimage->size ().height (), 10, label);
-		}
-		else
-		{
-			image.writeLabel (mimage, 1, mimage->rows () - 2, 10, label);
+			setResponseFile (fd, response_length, response, response_length);
+			return;
 		}
 
-		cacheMaxAge (CACHE_MAX_STATIC);
+		rts2image::Image image;
+		image.openFile (absPath, true, false);
+		Blob blob;
+
+		image.writePreviewBlob (blob, prevsize, label, quantiles, chan, colourVariant);
 
-		mimage->write (&blob, "jpeg");
 		response_length = blob.length();
 		response = new char[response_length];
 		memcpy (response, blob.data(), response_length);
 
-		delete mimage;
+		if (key.length () > 0)
+			cache->put (key, blob.data (), blob.length ());
 		return;
 	}
 
@@ -411,28 +443,76 @@ void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string p
 
 #endif /* RTS2_HAVE_LIBJPEG */
 
+// write copy of the file with tile-compressed images uncompressed, returns descriptor of the unlinked copy
+static int uncompressFits (const char *path)
+{
+	int status = 0;
+	fitsfile *infptr = NULL;
+	fitsfile *outfptr = NULL;
+
+	fits_open_diskfile (&infptr, path, READONLY, &status);
+	if (status)
+		throw XmlRpc::XmlRpcException ("Cannot open file");
+
+	char tmpname[] = "/tmp/rts2-fits-XXXXXX";
+	int tfd = mkstemp (tmpname);
+	if (tfd < 0)
+	{
+		fits_close_file (infptr, &status);
+		throw XmlRpc::XmlRpcException ("Cannot create temporary file for uncompressed image");
+	}
+	close (tfd);
+
+	// ! tells cfitsio to overwrite file created by mkstemp
+	fits_create_file (&outfptr, (std::string ("!") + tmpname).c_str (), &status);
+
+	int hdunum = 0;
+	fits_get_num_hdus (infptr, &hdunum, &status);
+	for (int i = 1; i <= hdunum && status == 0; i++)
+	{
+		fits_movabs_hdu (infptr, i, NULL, &status);
+		if (fits_is_compressed_image (infptr, &status))
+			fits_img_decompress (infptr, outfptr, &status);
+		else
+			fits_copy_hdu (infptr, outfptr, 0, &status);
+	}
+
+	int ret = status;
+	status = 0;
+	fits_close_file (infptr, &status);
+	if (outfptr)
+		fits_close_file (outfptr, &status);
+
+	int f = -1;
+	if (ret == 0 && status == 0)
+		f = open (tmpname, O_RDONLY);
+	unlink (tmpname);
+	if (f == -1)
+		throw XmlRpc::XmlRpcException ("Cannot uncompress file");
+	return f;
+}
+
 void FitsImageRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
 {
 	response_type = "image/fits";
-	int f = open (path.c_str (), O_RDONLY);
+	int f;
+	if (params->getBoolean ("uncompress", false))
+		f = uncompressFits (path.c_str ());
+	else
+		f = open (path.c_str (), O_RDONLY);
 	if (f == -1)
 	{
 		throw XmlRpc::XmlRpcException ("Cannot open file");
 	}
 	struct stat st;
 	if (fstat (f, &st) == -1)
-		throw XmlRpc::XmlRpcException ("Cannot get file properties");
-	
-	response_length = st.st_size;
-	response = new char[response_length];
-	ssize_t ret;
-	ret = read (f, response, response_length);
-	if (ret != (ssize_t) response_length)
 	{
-		delete[] response;
-		throw XmlRpc::XmlRpcException ("Cannot read data");
+		close (f);
+		throw XmlRpc::XmlRpcException ("Cannot get file properties");
 	}
-	close (f);
+
+	// file is send by the connection, without reading it to memory
+	setResponseFile (f, st.st_size, response, response_length);
 }
 
 void DownloadRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
@@ -450,24 +530,38 @@ void DownloadRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::stri
 	struct ::archive *a;
 	struct ::archive_entry *entry;
 
-        int ret;
+	int ret;
+
+	// archive is written to unlinked temporary file, which is then send by the connection
+	char tmpname[] = "/tmp/rts2-download-XXXXXX";
+	int tfd = mkstemp (tmpname);
+	if (tfd < 0)
+		throw XmlRpc::XmlRpcException ("Cannot create temporary file for archive");
+	unlink (tmpname);
 
 	a = archive_write_new ();
-        if (a == NULL)
-                throw XmlRpc::XmlRpcException ("Cannot create archive");
+	if (a == NULL)
+	{
+		close (tfd);
+		throw XmlRpc::XmlRpcException ("Cannot create archive");
+	}
 	archive_write_add_filter_bzip2 (a);
 	archive_write_set_format_ustar (a);
 	archive_write_set_bytes_in_last_block (a, 1);
 
-	ret = archive_write_open (a, this, &open_callback, &write_callback, &close_callback);
-        if (ret != ARCHIVE_OK)
-                throw XmlRpc::XmlRpcException (archive_error_string (a));
+	ret = archive_write_open_fd (a, tfd);
+	if (ret != ARCHIVE_OK)
+	{
+		std::string err (archive_error_string (a));
+		archive_write_free (a);
+		close (tfd);
+		throw XmlRpc::XmlRpcException (err);
+	}
 
 	for (XmlRpc::HttpParams::iterator iter = params->begin (); iter != params->end (); iter++)
 	{
 		if (!strcmp (iter->getName (), "files"))
 		{
-			entry = archive_entry_new ();
 			struct stat st;
 
 			char fn[strlen (iter->getValue ()) + 1];
@@ -475,14 +569,19 @@ void DownloadRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::stri
 
 			int fd = open (fn, O_RDONLY);
 			if (fd < 0)
+			{
+				archive_write_free (a);
+				close (tfd);
 				throw XmlRpc::XmlRpcException ("Cannot open file for packing");
+			}
+			entry = archive_entry_new ();
 			fstat (fd, &st);
 			archive_entry_copy_stat (entry, &st);
 			archive_entry_set_pathname (entry, basename (fn));
 			archive_write_header (a, entry);
 
 			int len;
-			char buff[8196];
+			char buff[65536];
 
 			while ((len = read (fd, buff, sizeof (buff))) > 0)
 				archive_write_data (a, buff, len);
@@ -492,45 +591,25 @@ void DownloadRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::stri
 		}
 	}
 
-        archive_write_close (a);
-        if (ret != ARCHIVE_OK)
-                throw XmlRpc::XmlRpcException (archive_error_string (a));
+	ret = archive_write_close (a);
+	if (ret != ARCHIVE_OK)
+	{
+		std::string err (archive_error_string (a));
+		archive_write_free (a);
+		close (tfd);
+		throw XmlRpc::XmlRpcException (err);
+	}
 
 	archive_write_free (a);
-        if (ret != ARCHIVE_OK)
-                throw XmlRpc::XmlRpcException (archive_error_string (a));
-
-	response_length = buf_size;
-	response = buf;
-
-	buf = NULL;
-}
-
-int open_callback (struct archive *a, void *client_data)
-{
-	DownloadRequest *dr = (DownloadRequest *) client_data;
-
-	if (dr->buf)
-		free (dr->buf);
-	dr->buf = NULL;
-	dr->buf_size = 0;
-
-	return ARCHIVE_OK;
-}
-
-ssize_t write_callback (struct archive *a, void *client_data, const void *buffer, size_t length)
-{
-	DownloadRequest * dr = (DownloadRequest *) client_data;
-	dr->buf = (char *) realloc (dr->buf, dr->buf_size + length);
-	memcpy (dr->buf + dr->buf_size, buffer, length);
-	dr->buf_size += length;
 
-	return length;
-}
+	struct stat tst;
+	if (fstat (tfd, &tst) == -1)
+	{
+		close (tfd);
+		throw XmlRpc::XmlRpcException ("Cannot get archive size");
+	}
 
-int close_callback (struct archive *a, void *client_data)
-{
-	return ARCHIVE_OK;
+	setResponseFile (tfd, tst.st_size, response, response_length);
 }
 
 #endif // RTS2_HAVE_LIBARCHIVE
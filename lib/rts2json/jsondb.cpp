@@ -28,6 +28,8 @@
 #include "rts2db/simbadtargetdb.h"
 #include "rts2db/messagedb.h"
 #include "rts2db/planset.h"
+#include "rts2db/records.h"
+#include "rts2db/recvals.h"
 #include "rts2db/target_auger.h"
 #include "rts2db/tletarget.h"
 #include "rts2db/targetres.h"
@@ -52,6 +54,22 @@ rts2db::Target * rts2json::getTarget (XmlRpc::HttpParams *params, const char *pa
 	return target;
 }
 
+// requests handled by dbJSON
+static const char *dbRequests[] = {"tbyname", "tbyid", "tbylabel", "tbydistance", "tbystring", "ibyoid", "labels", "consts", "violated", "satisfied",
+	"cnst_alt", "cnst_alt_v", "cnst_time", "cnst_time_v", "resolve", "create_target", "create_tle_target", "update_target", "change_script",
+	"change_constraints", "tlabs_list", "tlabs_delete", "tlabs_add", "tlabs_set", "obytid", "lastobs", "obyid", "stat_obylid", "plan",
+	"labellist", "messages", "graph", "auger", NULL};
+
+bool JSONDBRequest::isDBRequest (const std::string &name)
+{
+	for (const char **r = dbRequests; *r != NULL; r++)
+	{
+		if (name == *r)
+			return true;
+	}
+	return false;
+}
+
 void JSONDBRequest::dbJSON (const std::vector <std::string> vals, XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, std::ostringstream &os)
 {
 	// returns target information specified by target name
@@ -639,6 +657,45 @@ void JSONDBRequest::dbJSON (const std::vector <std::string> vals, XmlRpc::XmlRpc
 		}
 		os << "]";
 	}
+	// recorded values, downsampled to w buckets
+	else if (vals[0] == "graph")
+	{
+		int id = params->getInteger ("id", -1);
+		if (id < 0)
+		{
+			const char *device = params->getString ("d", "");
+			const char *value = params->getString ("v", "");
+			rts2db::RecvalsSet rvs;
+			rvs.load ();
+			rts2db::Recval *rv = rvs.searchByName (device, value);
+			if (rv == NULL)
+				throw XmlRpc::JSONException ("cannot find device/value pair with given name");
+			id = rv->getId ();
+		}
+		double to = params->getDouble ("to", getNow ());
+		double from = params->getDouble ("from", to - 86400);
+		int w = params->getInteger ("w", 800);
+		if (w <= 0 || w > 10000)
+			throw XmlRpc::JSONException ("invalid w parameter");
+
+		rts2db::RecordsSet rs (id);
+		rs.load (from, to, w);
+
+		os << "\"id\":" << id << ",\"h\":["
+			"{\"n\":\"Time\",\"t\":\"t\",\"c\":0},"
+			"{\"n\":\"Value\",\"t\":\"n\",\"c\":1},"
+			"{\"n\":\"Minimum\",\"t\":\"n\",\"c\":2},"
+			"{\"n\":\"Maximum\",\"t\":\"n\",\"c\":3}],"
+			"\"d\":[";
+
+		for (rts2db::RecordsSet::iterator iter = rs.begin (); iter != rs.end (); iter++)
+		{
+			if (iter != rs.begin ())
+				os << ",";
+			os << "[" << JsonDouble (iter->getRecTime ()) << "," << JsonDouble (iter->getValue ()) << "," << JsonDouble (iter->getMinimum ()) << "," << JsonDouble (iter->getMaximum ()) << "]";
+		}
+		os << "]";
+	}
 	else if (vals[0] == "auger")
 	{
 		int a_id = params->getInteger ("id", -1);
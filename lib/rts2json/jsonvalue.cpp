@@ -28,10 +28,57 @@ using namespace rts2json;
 
 double DevInterface::getValueChangedTime (rts2core::Value *value)
 {
-	std::map <rts2core::Value *, double>::iterator iter = changedTimes.find (value);
-	if (iter == changedTimes.end ())
+	std::map <rts2core::Value *, ValueCache>::iterator iter = cache.find (value);
+	if (iter == cache.end ())
 		return NAN;
-	return iter->second;
+	return iter->second.changed;
+}
+
+unsigned long DevInterface::getValueGeneration (rts2core::Value *value)
+{
+	std::map <rts2core::Value *, ValueCache>::iterator iter = cache.find (value);
+	if (iter == cache.end ())
+		return 0;
+	return iter->second.generation;
+}
+
+const std::string &DevInterface::getJsonValue (rts2core::Value *value, bool extended)
+{
+	ValueCache &vc = cache[value];
+	if (vc.flags != value->getFlags ())
+	{
+		vc.valid[0] = vc.valid[1] = false;
+		vc.flags = value->getFlags ();
+	}
+	if (vc.valid[extended] == false)
+	{
+		std::ostringstream os;
+		os << std::fixed;
+		jsonValue (value, extended, os);
+		vc.json[extended] = os.str ();
+		vc.valid[extended] = true;
+	}
+	return vc.json[extended];
+}
+
+void DevInterface::valueUpdated (rts2core::Value *value)
+{
+	ValueCache &vc = cache[value];
+	vc.changed = getNow ();
+	vc.generation = ++generation;
+	vc.valid[0] = vc.valid[1] = false;
+}
+
+void DevInterface::valueMetaUpdated (rts2core::Value *value)
+{
+	ValueCache &vc = cache[value];
+	vc.generation = ++generation;
+	vc.valid[0] = vc.valid[1] = false;
+}
+
+DevInterface *rts2json::getDevInterface (rts2core::Connection *conn)
+{
+	return dynamic_cast <DevInterface *> (conn->getOtherDevClient ());
 }
 
 void rts2json::sendArrayValue (rts2core::Value *value, std::ostringstream &os)
@@ -164,30 +211,38 @@ void rts2json::jsonValue (rts2core::Value *value, bool extended, std::ostringstr
 		os << "," << value->isError () << "," << value->isWarning () << ",\"" << value->getDescription () << "\"]";
 }
 
-void rts2json::sendConnectionValues (std::ostringstream & os, rts2core::Connection * conn, XmlRpc::HttpParams *params, double from, bool extended)
+void rts2json::sendConnectionValues (std::ostringstream & os, rts2core::Connection * conn, XmlRpc::HttpParams *params, double from, bool extended, unsigned long since)
 {
 	os << "\"d\":{" << std::fixed;
 	double mfrom = NAN;
 	bool first = true;
 	rts2core::ValueVector::iterator iter;
 
+	DevInterface *di = getDevInterface (conn);
+
 	for (iter = conn->valueBegin (); iter != conn->valueEnd (); iter++)
 	{
-		if ((isnan (from) || from > 0) && conn->getOtherDevClient ())
+		if ((isnan (from) || from > 0) && di)
 		{
-			double ch = ((DevInterface *) (conn->getOtherDevClient ()))->getValueChangedTime (*iter);
+			double ch = di->getValueChangedTime (*iter);
 			if (isnan (mfrom) || ch > mfrom)
 				mfrom = ch;
 			if (!isnan (from) && !isnan (ch) && ch < from)
 				continue;
 		}
 
+		if (since > 0 && di && di->getValueGeneration (*iter) <= since)
+			continue;
+
 		if (first)
 			first = false;
 		else
 			os << ",";
 
-		jsonValue (*iter, extended, os);
+		if (di)
+			os << di->getJsonValue (*iter, extended);
+		else
+			jsonValue (*iter, extended, os);
 	}
 	os << "},\"minmax\":{";
 
@@ -207,4 +262,6 @@ void rts2json::sendConnectionValues (std::ostringstream & os, rts2core::Connecti
 	}
 
 	os << "},\"idle\":" << conn->isIdle () << ",\"state\":" << conn->getState () << ",\"sstart\":" << rts2json::JsonDouble (conn->getProgressStart ()) << ",\"send\":" << rts2json::JsonDouble (conn->getProgressEnd ()) << ",\"f\":" << rts2json::JsonDouble (mfrom);
+	if (di)
+		os << ",\"g\":" << di->getGeneration ();
 }
@@ -246,6 +246,18 @@ void Targets::listTargets (XmlRpc::HttpParams *params, const char* &response_typ
 	memcpy (response, _os.str ().c_str (), response_length);
 }
 
+bool Targets::isHeavy (const std::string &path, XmlRpc::HttpParams *params)
+{
+#ifdef RTS2_HAVE_LIBJPEG
+	std::vector <std::string> vals = SplitStr (path, std::string ("/"));
+	if (vals.size () == 2 && vals[1] == "altplot")
+		return true;
+	if (vals.size () == 1 && vals[0] == "form" && !strcmp (params->getString ("plot", "xxx"), "Plot target altitude"))
+		return true;
+#endif /* RTS2_HAVE_LIBJPEG */
+	return false;
+}
+
 void Targets::processForm (XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
 {
 #ifdef RTS2_HAVE_LIBJPEG
@@ -44,9 +44,43 @@ ConnProcess::ConnProcess (rts2core::Block * in_master, const char *in_exe, int i
 #ifdef RTS2_HAVE_LIBJPEG
 	last_good_jpeg = NULL;
 	last_trash_jpeg = NULL;
+
+	thumbnailCache = NULL;
+	thumbnailSize = 128;
+	thumbnailLabel = NULL;
+	thumbnailChannel = 0;
 #endif
 }
 
+#ifdef RTS2_HAVE_LIBJPEG
+void ConnProcess::writeThumbnail (const char *path)
+{
+	if (thumbnailCache == NULL)
+		return;
+	struct stat st;
+	if (stat (path, &st))
+		return;
+	try
+	{
+		Image image;
+		image.openFile (path, true, false);
+		Magick::Blob blob;
+		// 0.005 quantiles and grey colours are defaults of web previews
+		image.writePreviewBlob (blob, thumbnailSize, thumbnailLabel, 0.005, thumbnailChannel, PSEUDOCOLOUR_VARIANT_GREY);
+		if (thumbnailCache->put (rts2core::ThumbnailCache::makeKey (st, thumbnailSize, thumbnailLabel, 0.005, thumbnailChannel, PSEUDOCOLOUR_VARIANT_GREY), blob.data (), blob.length ()))
+			logStream (MESSAGE_WARNING) << "cannot store preview of " << path << " in " << thumbnailCache->getDirectory () << ": " << strerror (errno) << sendLog;
+	}
+	catch (rts2core::Error &er)
+	{
+		logStream (MESSAGE_WARNING) << "cannot create preview of " << path << ": " << er << sendLog;
+	}
+	catch (Magick::Exception &ex)
+	{
+		logStream (MESSAGE_WARNING) << "cannot create preview of " << path << ": " << ex.what () << sendLog;
+	}
+}
+#endif
+
 int ConnProcess::init ()
 {
 	if (exePath[0] == '\0')
@@ -270,7 +304,14 @@ void ConnImgProcess::connectionError (int last_data_size)
 			else
 				master->postEvent (new rts2core::Event (EVENT_NOT_ASTROMETRY, (void *) image));
 		}
+#ifdef RTS2_HAVE_LIBJPEG
+		// image is saved when deleted, so preview is created from the final file
+		std::string finalPath (image->getAbsoluteFileName ());
 		delete image;
+		writeThumbnail (finalPath.c_str ());
+#else
+		delete image;
+#endif
 	}
 	catch (rts2core::Error &er)
 	{
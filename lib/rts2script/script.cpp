@@ -19,6 +19,7 @@
  */
 
 #include "rts2script/script.h"
+#include "rts2script/scriptcache.h"
 
 #include "elementexe.h"
 #include "elementhex.h"
@@ -992,11 +993,7 @@ double rts2script::getMaximalScriptDuration (Rts2Target *tar, rts2db::CamList &c
   	double md = 0;
 	for (rts2db::CamList::iterator cam = cameras.begin (); cam != cameras.end (); cam++)
 	{
-		std::string script_buf;
-		rts2script::Script script;
-		tar->getScript (cam->c_str(), script_buf);
-		script.setTarget (cam->c_str (), tar);
-		double d = script.getExpectedDuration (tel, runnum);
+		double d = ScriptCache::instance ()->getExpectedDuration (tar, cam->c_str (), tel, runnum);
 		if (d > md)
 			md = d;  
 	}
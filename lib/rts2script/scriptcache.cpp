@@ -0,0 +1,142 @@
+/*
+ * Cache of parsed target scripts.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2script/scriptcache.h"
+#include "rts2script/script.h"
+
+#include <sstream>
+
+using namespace rts2script;
+
+ScriptCache *ScriptCache::pInstance = NULL;
+
+// parse script, find filter= commands
+static void parseFilters (const std::string &scripttext, std::vector <std::string> &filters)
+{
+	Script script (scripttext.c_str ());
+	script.parseScript (NULL);
+	for (Script::iterator se = script.begin (); se != script.end (); se++)
+	{
+		std::ostringstream os;
+		(*se)->printScript (os);
+		if (os.str ().find ("filter=") == 0)
+			filters.push_back (((ElementChangeValue *) (*se))->getOperands ());
+	}
+}
+
+ScriptCache *ScriptCache::instance ()
+{
+	if (!pInstance)
+		pInstance = new ScriptCache ();
+	return pInstance;
+}
+
+ScriptCache::ScriptCache ()
+{
+	hits = 0;
+	misses = 0;
+}
+
+double ScriptCache::getExpectedDuration (Rts2Target *tar, const char *camera, struct ln_equ_posn *tel, int runnum)
+{
+	CacheEntry *entry = getEntry (tar, camera);
+	if (entry == NULL)
+	{
+		Script script;
+		script.setTarget (camera, tar);
+		return script.getExpectedDuration (tel, runnum);
+	}
+
+	// acquisition commands are parsed differently for acquired targets
+	std::pair <bool, int> key (tar->isAcquired (), runnum);
+	std::map <std::pair <bool, int>, double>::iterator iter = entry->durations.find (key);
+	double ret;
+	if (iter == entry->durations.end ())
+	{
+		misses++;
+		Script script;
+		script.setTarget (camera, tar);
+		ret = script.getExpectedDuration (NULL, runnum);
+		entry->durations[key] = ret;
+		entry->telescopeSettleTime = script.getTelescopeSettleTime ();
+		entry->telescopeSpeed = script.getTelescopeSpeed ();
+	}
+	else
+	{
+		hits++;
+		ret = iter->second;
+	}
+
+	// telescope movement depends on actual target position
+	if (tel)
+	{
+		struct ln_equ_posn target_pos;
+		tar->getPosition (&target_pos);
+		if (!isnan (target_pos.ra) && !isnan (target_pos.dec))
+			ret += entry->telescopeSettleTime + ln_get_angular_separation (tel, &target_pos) * entry->telescopeSpeed;
+	}
+	return ret;
+}
+
+void ScriptCache::getFilters (Rts2Target *tar, const char *camera, std::vector <std::string> &filters)
+{
+	CacheEntry *entry = getEntry (tar, camera);
+	if (entry == NULL)
+	{
+		std::string scripttext;
+		tar->getScript (camera, scripttext);
+		filters.clear ();
+		parseFilters (scripttext, filters);
+		return;
+	}
+	if (entry->filtersValid == false)
+	{
+		misses++;
+		parseFilters (entry->script, entry->filters);
+		entry->filtersValid = true;
+	}
+	else
+	{
+		hits++;
+	}
+	filters = entry->filters;
+}
+
+ScriptCache::CacheEntry *ScriptCache::getEntry (Rts2Target *tar, const char *camera)
+{
+	std::string scripttext;
+	// script is returned by parts, cannot cache it
+	if (tar->getScript (camera, scripttext))
+		return NULL;
+
+	std::pair <int, std::string> key (tar->getTargetID (), std::string (camera));
+	std::map <std::pair <int, std::string>, CacheEntry>::iterator iter = entries.find (key);
+	if (iter != entries.end () && iter->second.script == scripttext)
+		return &(iter->second);
+
+	// new or changed script
+	CacheEntry &entry = entries[key];
+	entry.script = scripttext;
+	entry.durations.clear ();
+	entry.telescopeSettleTime = 0;
+	entry.telescopeSpeed = 0;
+	entry.filtersValid = false;
+	entry.filters.clear ();
+	return &entry;
+}
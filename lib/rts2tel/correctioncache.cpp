@@ -0,0 +1,104 @@
+/*
+ * Interpolation cache of astrometric corrections.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "correctioncache.h"
+
+#include <math.h>
+
+// corrections are not cached close to poles, where RA derivatives are large
+#define MAX_DEC     89.0
+
+using namespace rts2teld;
+
+// difference of two RAs, in -180..180 range
+static double raDiff (double ra1, double ra2)
+{
+	double d = fmod (ra1 - ra2, 360.0);
+	if (d > 180.0)
+		d -= 360.0;
+	else if (d < -180.0)
+		d += 360.0;
+	return d;
+}
+
+CorrectionCache::Node CorrectionCache::makeNode (double ra, double dec, const double c[2], const double c_ra[2], const double c_dec[2])
+{
+	Node n;
+	n.ra = raDiff (c[0], ra);
+	n.dec = c[1] - dec;
+	n.ra_ra = (raDiff (c_ra[0], ra + CORR_CACHE_DELTA) - n.ra) / CORR_CACHE_DELTA;
+	n.dec_ra = (c_ra[1] - dec - n.dec) / CORR_CACHE_DELTA;
+	n.ra_dec = (raDiff (c_dec[0], ra) - n.ra) / CORR_CACHE_DELTA;
+	n.dec_dec = (c_dec[1] - (dec + CORR_CACHE_DELTA) - n.dec) / CORR_CACHE_DELTA;
+	return n;
+}
+
+void CorrectionCache::set (double ra, double dec, double JD, double _step, int _mask, const Node _nodes[3])
+{
+	ra0 = ra;
+	dec0 = dec;
+	JD0 = JD;
+	step = _step;
+	mask = _mask;
+	for (int i = 0; i < 3; i++)
+		nodes[i] = _nodes[i];
+	valid = true;
+}
+
+bool CorrectionCache::covers (double ra, double dec, double JD, int _mask, double radius)
+{
+	if (valid == false || _mask != mask)
+		return false;
+	if (JD < JD0 || JD > JD0 + step / 86400.0)
+		return false;
+	if (fabs (dec) > MAX_DEC)
+		return false;
+	return fabs (dec - dec0) <= radius && fabs (raDiff (ra, ra0) * cos (dec0 * M_PI / 180.0)) <= radius;
+}
+
+void CorrectionCache::apply (double &ra, double &dec, double JD)
+{
+	// Lagrange quadratic polynomial, nodes at x = 0, 1, 2
+	double x = (JD - JD0) * 86400.0 / (step / 2.0);
+	double l[3];
+	l[0] = (x - 1) * (x - 2) / 2.0;
+	l[1] = -x * (x - 2);
+	l[2] = x * (x - 1) / 2.0;
+
+	Node n;
+	n.ra = n.dec = n.ra_ra = n.ra_dec = n.dec_ra = n.dec_dec = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		n.ra += l[i] * nodes[i].ra;
+		n.dec += l[i] * nodes[i].dec;
+		n.ra_ra += l[i] * nodes[i].ra_ra;
+		n.ra_dec += l[i] * nodes[i].ra_dec;
+		n.dec_ra += l[i] * nodes[i].dec_ra;
+		n.dec_dec += l[i] * nodes[i].dec_dec;
+	}
+
+	double d_ra = raDiff (ra, ra0);
+	double d_dec = dec - dec0;
+
+	double c_ra = n.ra + n.ra_ra * d_ra + n.ra_dec * d_dec;
+	double c_dec = n.dec + n.dec_ra * d_ra + n.dec_dec * d_dec;
+
+	ra += c_ra;
+	dec += c_dec;
+}
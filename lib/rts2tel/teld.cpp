@@ -335,6 +335,17 @@ Telescope::Telescope (int in_argc, char **in_argv, bool diffTrack, bool hasTrack
 	createValue (calModel, "CAL_MODE", "if model calculations are included in target calcuations", false, RTS2_VALUE_WRITABLE);
 	calModel->setValueBool (false);
 
+	createValue (corrCacheStep, "corr_cache", "[s] interval for interpolation of precession, nutation and aberation; 0 to calculate them for every position", false, RTS2_VALUE_WRITABLE | RTS2_DT_TIMEINTERVAL);
+	corrCacheStep->setValueDouble (300);
+
+	createValue (corrCacheCheck, "corr_cache_check", "compare interpolated corrections with exact calculations", false, RTS2_VALUE_WRITABLE);
+	corrCacheCheck->setValueBool (false);
+
+	createValue (corrCacheLimit, "corr_cache_limit", "[arcsec] maximal interpolation error; interpolation interval is halved if check finds larger error", false, RTS2_VALUE_WRITABLE);
+	corrCacheLimit->setValueDouble (0.05);
+
+	createValue (corrCacheError, "corr_cache_error", "[arcsec] maximal interpolation error found by check", false);
+
 	createValue (cupolas, "cupolas", "Cupola(s) connected to telescope. They should sync as telescope moves.", false);
 
 	createValue (rotators, "rotators", "Rotator(s) connected to telescope.", false);
@@ -1700,15 +1711,80 @@ int Telescope::scriptEnds ()
 
 void Telescope::applyCorrections (struct ln_equ_posn *pos, double JD, bool writeValues)
 {
-	// apply all posible corrections
+	int mask = (calPrecession->getValueBool () ? 1 : 0) | (calNutation->getValueBool () ? 2 : 0) | (calAberation->getValueBool () ? 4 : 0);
+	double step = corrCacheStep->getValueDouble ();
+
+	if (mask == 0 || !(step > 0))
+	{
+		applyAstrometry (pos, JD, writeValues);
+	}
+	else
+	{
+		if (corrCache.getStep () != step)
+			corrCache.invalidate ();
+		// offsets and guiding corrections are small, larger move means new target
+		if (!corrCache.covers (pos->ra, pos->dec, JD, mask, 0.1))
+			refreshCorrectionCache (pos, JD, mask, writeValues);
+
+		struct ln_equ_posn exact;
+		exact.ra = pos->ra;
+		exact.dec = pos->dec;
+
+		corrCache.apply (pos->ra, pos->dec, JD);
+
+		if (corrCacheCheck->getValueBool ())
+		{
+			applyAstrometry (&exact, JD, false);
+			double err = 3600.0 * sqrt (pow (ln_range_degrees (exact.ra - pos->ra + 180.0) - 180.0, 2) * pow (cos (ln_deg_to_rad (exact.dec)), 2) + pow (exact.dec - pos->dec, 2));
+			if (isnan (corrCacheError->getValueDouble ()) || err > corrCacheError->getValueDouble ())
+				corrCacheError->setValueDouble (err);
+			if (err > corrCacheLimit->getValueDouble () && step > 1)
+			{
+				logStream (MESSAGE_WARNING) << "interpolated corrections differ by " << err << " arcsec, decreasing interpolation interval to " << (step / 2.0) << " seconds" << sendLog;
+				corrCacheStep->setValueDouble (step / 2.0);
+				corrCache.invalidate ();
+			}
+		}
+	}
+
+	if (calRefraction->getValueBool () == true)
+		applyRefraction (pos, JD, writeValues);
+}
+
+void Telescope::applyAstrometry (struct ln_equ_posn *pos, double JD, bool writeValues)
+{
 	if (calPrecession->getValueBool () == true)
 		applyPrecession (pos, JD, writeValues);
 	if (calNutation->getValueBool () == true)
 		applyNutation (pos, JD, writeValues);
 	if (calAberation->getValueBool () == true)
 		applyAberation (pos, JD, writeValues);
-	if (calRefraction->getValueBool () == true)
-		applyRefraction (pos, JD, writeValues);
+}
+
+void Telescope::refreshCorrectionCache (struct ln_equ_posn *pos, double JD, int mask, bool writeValues)
+{
+	double step = corrCacheStep->getValueDouble ();
+	CorrectionCache::Node nodes[3];
+	for (int i = 0; i < 3; i++)
+	{
+		double nJD = CorrectionCache::getNodeJD (JD, step, i);
+		struct ln_equ_posn c, c_ra, c_dec;
+		c.ra = c_ra.ra = c_dec.ra = pos->ra;
+		c.dec = c_ra.dec = c_dec.dec = pos->dec;
+		c_ra.ra += CORR_CACHE_DELTA;
+		c_dec.dec += CORR_CACHE_DELTA;
+
+		// intermediate values are updated when cache is refreshed
+		applyAstrometry (&c, nJD, writeValues && i == 0);
+		applyAstrometry (&c_ra, nJD, false);
+		applyAstrometry (&c_dec, nJD, false);
+
+		double a_c[2] = { c.ra, c.dec };
+		double a_ra[2] = { c_ra.ra, c_ra.dec };
+		double a_dec[2] = { c_dec.ra, c_dec.dec };
+		nodes[i] = CorrectionCache::makeNode (pos->ra, pos->dec, a_c, a_ra, a_dec);
+	}
+	corrCache.set (pos->ra, pos->dec, JD, step, mask, nodes);
 }
 
 void Telescope::applyCorrections (double &tar_ra, double &tar_dec, bool writeValues)
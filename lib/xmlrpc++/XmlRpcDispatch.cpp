@@ -220,6 +220,9 @@ void XmlRpcDispatch::processFds (short revents, SourceList::iterator thisIt, Xml
 	{
 		if (revents & (POLLIN | POLLPRI))
 			newMask &= (src == chunkWait) ? src->handleChunkEvent(ReadableEvent) : src->handleEvent(ReadableEvent);
+		// resumed connections execute requests on writable event
+		if (revents & POLLOUT)
+			newMask &= (src == chunkWait) ? src->handleChunkEvent(WritableEvent) : src->handleEvent(WritableEvent);
 	}
 	catch (const XmlRpcAsynchronous &async)
 	{
@@ -227,10 +230,9 @@ void XmlRpcDispatch::processFds (short revents, SourceList::iterator thisIt, Xml
 		// stop monitoring the source..
 		thisIt->getMask() = 0;
 		src->goAsync ();
+		return;
 	}
 
-	if (revents & POLLOUT)
-		newMask &= (src == chunkWait) ? src->handleChunkEvent(WritableEvent) : src->handleEvent(WritableEvent);
 	if (revents & (POLLRDHUP | POLLERR | POLLHUP | POLLNVAL))
 		newMask &= (src == chunkWait) ? src->handleChunkEvent(Exception) : src->handleEvent(Exception);
 
@@ -18,6 +18,7 @@
 #include <winsock2.h>
 #else
 #include <errno.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #endif
@@ -67,6 +68,14 @@ XmlRpcServerConnection::XmlRpcServerConnection(int fd, XmlRpcServer* server, boo
 
 	_get_response_length = 0;
 	_get_response = NULL;
+	_get_response_file = -1;
+	_get_response_offset = 0;
+
+	_rangeFrom = -1;
+	_rangeTo = -1;
+
+	_requestState = READ_HEADER;
+	_getExecuted = false;
 
 	memcpy (&_saddr, saddr, addrlen);
 	_addrlen = addrlen;
@@ -78,6 +87,8 @@ XmlRpcServerConnection::~XmlRpcServerConnection()
 	_server->removeConnection(this);
 
 	delete[] _get_response;
+	if (_get_response_file >= 0)
+		::close(_get_response_file);
 }
 
 // Handle input on the server socket by accepting the connection
@@ -134,6 +145,7 @@ bool XmlRpcServerConnection::readHeader()
 	char *lp = 0;				 // Start of content-length value
 	char *kp = 0;				 // Start of connection value
 	char *ap = 0;				 // Start of authorization header
+	char *rp = 0;				 // Start of range value
 
 	for (char *cp = hp; (bp == 0) && (cp < ep); ++cp)
 	{
@@ -147,6 +159,8 @@ bool XmlRpcServerConnection::readHeader()
 			kp = cp + 12;
 		else if ((ep - cp > 12) && (strncasecmp (cp, "Authorization: ", 15) == 0))
 			ap = cp + 15;
+		else if ((ep - cp > 7) && (cp == hp || cp[-1] == '\n') && (strncasecmp (cp, "Range: ", 7) == 0))
+			rp = cp + 7;
 		else if ((ep - cp >= 4) && (strncmp(cp, "\r\n\r\n", 4) == 0))
 			bp = cp + 4;
 		else if ((ep - cp >= 2) && (strncmp(cp, "\n\n", 2) == 0))
@@ -206,6 +220,42 @@ bool XmlRpcServerConnection::readHeader()
 	}
 	XmlRpcUtil::log(3, "KeepAlive: %d", _keepAlive);
 
+	// byte range, only single range is supported
+	_rangeFrom = _rangeTo = -1;
+	if (rp != 0)
+	{
+		while (isspace(*rp))
+			rp++;
+		if (ep - rp > 6 && strncasecmp (rp, "bytes=", 6) == 0)
+		{
+			char *rfe, *rte;
+			rp += 6;
+			long long rf = strtoll (rp, &rfe, 10);
+			if (*rfe == '-')
+			{
+				long long rt = strtoll (rfe + 1, &rte, 10);
+				// bytes=a-b, bytes=a- or bytes=-suffix
+				if (*rte != ',')
+				{
+					if (rfe == rp)
+					{
+						if (rte != rfe + 1)
+						{
+							_rangeFrom = -2;
+							_rangeTo = rt;
+						}
+					}
+					else
+					{
+						_rangeFrom = rf;
+						_rangeTo = rte == rfe + 1 ? -1 : rt;
+					}
+				}
+			}
+		}
+		XmlRpcUtil::log(3, "Range: %lld-%lld", _rangeFrom, _rangeTo);
+	}
+
 	// XML-RPC requests are POST. If we received GET request, then get request string and call it a day..
 	if (gp != 0)
 	{
@@ -314,17 +364,13 @@ bool XmlRpcServerConnection::readRequest()
 
 bool XmlRpcServerConnection::handleGet()
 {
+	// response might be already prepared by offloaded request
+	if (!_getExecuted)
+		executeGet();
 	if (_get_response_header.length () == 0 || _get_response_length == 0)
 	{
-		executeGet();
-		_getHeaderWritten = 0;
-		_getWritten = 0;
-		_bytesWritten = 0;
-		if (_get_response_header.length () == 0 || _get_response_length == 0)
-		{
-			XmlRpcUtil::error("XmlRpcServerConnection::handleGet: empty response.");
-			return false;
-		}
+		XmlRpcUtil::error("XmlRpcServerConnection::handleGet: empty response.");
+		return false;
 	}
 
 	if (_getHeaderWritten != _get_response_header.length ())
@@ -338,7 +384,7 @@ bool XmlRpcServerConnection::handleGet()
 	}
 	if (_getHeaderWritten == _get_response_header.length () && _getWritten != _get_response_length)
 	{
-		if ( XmlRpcSocket::nbWriteBuf(this->getfd(), _get_response, _get_response_length, &_getWritten, false, false) != 0 )
+		if ( writeGetResponse() != 0 )
 		{
 			XmlRpcUtil::error("XmlRpcServerConnection::handleGet: write error (%s).",XmlRpcSocket::getErrorMsg().c_str());
 			return false;
@@ -392,9 +438,16 @@ bool XmlRpcServerConnection::writeResponse()
 	return _keepAlive;			 // Continue monitoring this source if true
 }
 
+int XmlRpcServerConnection::writeGetResponse()
+{
+	if (_get_response_file >= 0)
+		return XmlRpcSocket::nbSendFile(this->getfd(), _get_response_file, _get_response_offset, _get_response_length, &_getWritten);
+	return XmlRpcSocket::nbWriteBuf(this->getfd(), _get_response, _get_response_length, &_getWritten, false, false);
+}
+
 bool XmlRpcServerConnection::writeAsyncReponse()
 {
-	if ( XmlRpcSocket::nbWriteBuf(this->getfd(), _get_response, _get_response_length, &_getWritten, false, false) != 0 )
+	if ( writeGetResponse() != 0 )
 	{
 		XmlRpcUtil::error("XmlRpcServerConnection::writeAsyncReponse %i: write error (%s).",this->getfd(), XmlRpcSocket::getErrorMsg().c_str());
 		return false;
@@ -436,15 +489,55 @@ void XmlRpcServerConnection::executeRequest()
 	}
 }
 
-// Run the method, generate _get_response buffer, fill _get_response_length
+// Find request, either execute it or pass it to the server for execution outside of main loop
 void XmlRpcServerConnection::executeGet()
+{
+	_requestState = _connectionState;
+
+	XmlRpcServerGetRequest* request = _server->findGetRequest(_get);
+	if (request != NULL)
+	{
+		bool heavy = false;
+		try
+		{
+			std::string path;
+			HttpParams params = HttpParams ();
+			parseGet (request, path, params);
+			heavy = request->isHeavy (path, &params);
+		}
+		catch (const std::exception&)
+		{
+			// invalid request, executeGetRequest will report the error
+		}
+
+		switch (_server->offloadGet (this, request, heavy))
+		{
+			case OFFLOAD_QUEUED:
+				XmlRpcUtil::log(3, "XmlRpcServerConnection::executeGet: request %s offloaded", _get.c_str());
+				throw XmlRpcAsynchronous ();
+			case OFFLOAD_BUSY:
+			{
+				XmlRpcUtil::log(2, "XmlRpcServerConnection::executeGet: server busy, rejecting %s", _get.c_str());
+				std::string body ("<html><head><title>Server busy</title></head><body><p>Server is busy, please try again later.</p></body></html>");
+				_get_response_length = body.length ();
+				_get_response = new char[_get_response_length];
+				memcpy (_get_response, body.c_str (), _get_response_length);
+				generateGetHeader (HTTP_SERVICE_UNAVAILABLE, "text/html");
+				return;
+			}
+		}
+	}
+
+	executeGetRequest(request);
+}
+
+// Run the method, generate _get_response buffer, fill _get_response_length
+void XmlRpcServerConnection::executeGetRequest(XmlRpcServerGetRequest* request)
 {
 	const char* response_type = "text/plain";
 
 	int http_code = HTTP_BAD_REQUEST;
-	const char *http_code_string = "Failed";
 
-	XmlRpcServerGetRequest* request = _server->findGetRequest(_get);
 	if (request == NULL)
 	{
 	  	// if we are on top page, generate list of pages..
@@ -489,22 +582,8 @@ void XmlRpcServerConnection::executeGet()
 	
 		try
 		{
-			std::string path = _get.substr (request->getPrefix ().length ()).c_str ();
-			// if there are any parameters..
-			std::string::size_type pi = path.find ('?');
-			if (pi != std::string::npos)
-			{
-				params.parse (path.substr (pi + 1));
-				path = path.substr (0, pi);
-			}
-			
-			// add params from _request for POST requests
-			if (_connectionState == POST_REQUEST)
-			{
-				params.parse (_request);
-			}
-
-			urldecode (path, true);
+			std::string path;
+			parseGet (request, path, params);
 
 			request->setConnection (this);
 
@@ -519,6 +598,7 @@ void XmlRpcServerConnection::executeGet()
 		catch (const JSONException& fault)
 		{
 			XmlRpcUtil::log(2, "XmlRpcServerConnection::executeRequest: JSON fault %s.", fault.getMessage().c_str());
+			closeResponseFile ();
 			if (isChunked ())
 			{
 				std::ostringstream os;
@@ -536,6 +616,7 @@ void XmlRpcServerConnection::executeGet()
 		}
 		catch (const std::exception& ex)
 		{
+			closeResponseFile ();
 			_get_response = new char[501];
 			response_type = "text/html";
 			_get_response_length = snprintf (_get_response, 500, "<html><head><title>Error</title></head><body><p>Bad request %s</p></body></html>", ex.what());
@@ -544,15 +625,62 @@ void XmlRpcServerConnection::executeGet()
 		}
 	}
 
+	if (_get_response_file >= 0 && http_code == HTTP_OK)
+		http_code = applyRange ();
+
+	generateGetHeader (http_code, response_type);
+}
+
+void XmlRpcServerConnection::offloadFinished()
+{
+	_connectionState = _requestState;
+	setSourceEvents (XmlRpcDispatch::WritableEvent);
+}
+
+void XmlRpcServerConnection::parseGet (XmlRpcServerGetRequest *request, std::string &path, HttpParams &params)
+{
+	path = _get.substr (request->getPrefix ().length ()).c_str ();
+	// if there are any parameters..
+	std::string::size_type pi = path.find ('?');
+	if (pi != std::string::npos)
+	{
+		params.parse (path.substr (pi + 1));
+		path = path.substr (0, pi);
+	}
+	
+	// add params from _request for POST requests
+	if (_requestState == POST_REQUEST)
+	{
+		params.parse (_request);
+	}
+
+	urldecode (path, true);
+}
+
+void XmlRpcServerConnection::generateGetHeader (int http_code, const char *response_type)
+{
+	const char *http_code_string = "Failed";
+
 	switch (http_code)
 	{
 		case HTTP_OK:
 			http_code_string = "OK";
 			break;
+		case HTTP_PARTIAL_CONTENT:
+			http_code_string = "Partial Content";
+			break;
+		case HTTP_RANGE_NOT_SATISFIABLE:
+			http_code_string = "Requested Range Not Satisfiable";
+			response_type = "text/html";
+			break;
 		case HTTP_UNAUTHORIZED:
 			http_code_string = "Authorization Required";
 			addExtraHeader ("WWW-Authenticate", "Basic realm=\"Your RTS2 login\"");
 			break;
+		case HTTP_SERVICE_UNAVAILABLE:
+			http_code_string = "Service Unavailable";
+			addExtraHeader ("Retry-After", "5");
+			break;
 		case HTTP_BAD_REQUEST:
 		default:
 			http_code_string = "Failed";
@@ -561,6 +689,11 @@ void XmlRpcServerConnection::executeGet()
 
 	_get_response_header = printHeaders (http_code, http_code_string, response_type, _get_response_length, _extra_headers);
 	printf ("%s", _get_response_header.c_str ());
+
+	_getHeaderWritten = 0;
+	_getWritten = 0;
+	_bytesWritten = 0;
+	_getExecuted = true;
 }
 
 // Parse the method name and the argument values from the request.
@@ -704,6 +837,66 @@ void XmlRpcServerConnection::setResponse(char *_set_response, size_t _response_l
 	_server->setSourceEvents(this, XmlRpcDispatch::WritableEvent);
 }
 
+void XmlRpcServerConnection::setResponseFile(int fd, off_t offset, size_t length)
+{
+	closeResponseFile ();
+	_get_response_file = fd;
+	_get_response_offset = offset;
+	_get_response_length = length;
+}
+
+void XmlRpcServerConnection::closeResponseFile()
+{
+	if (_get_response_file < 0)
+		return;
+	::close(_get_response_file);
+	_get_response_file = -1;
+	_get_response_offset = 0;
+}
+
+int XmlRpcServerConnection::applyRange()
+{
+	addExtraHeader ("Accept-Ranges", "bytes");
+	if (_rangeFrom == -1)
+		return HTTP_OK;
+
+	long long total = _get_response_length;
+	long long from = _rangeFrom;
+	long long to = _rangeTo;
+	// suffix range - last bytes of the file
+	if (from == -2)
+	{
+		from = total - to;
+		if (from < 0)
+			from = 0;
+		to = total - 1;
+	}
+	else if (to < 0 || to >= total)
+	{
+		to = total - 1;
+	}
+
+	std::ostringstream cr;
+	if (from >= total || from > to)
+	{
+		closeResponseFile ();
+		cr << "bytes */" << total;
+		addExtraHeader ("Content-Range", cr.str ());
+		std::ostringstream oss;
+		oss << "<html><head><title>Requested range not satisfiable</title></head><body><p>Requested range not satisfiable, file has " << total << " bytes</p></body></html>";
+		_get_response_length = oss.str ().length ();
+		_get_response = new char[_get_response_length];
+		memcpy (_get_response, oss.str ().c_str (), _get_response_length);
+		return HTTP_RANGE_NOT_SATISFIABLE;
+	}
+
+	cr << "bytes " << from << "-" << to << "/" << total;
+	addExtraHeader ("Content-Range", cr.str ());
+	_get_response_offset += from;
+	_get_response_length = to - from + 1;
+	return HTTP_PARTIAL_CONTENT;
+}
+
 void XmlRpcServerConnection::generateFaultResponse(std::string const& errorMsg, int errorCode)
 {
 	const char RESPONSE_1[] =
@@ -787,6 +980,10 @@ void XmlRpcServerConnection::prepareForNext ()
 	_get_response_length = 0;
 	delete[] _get_response;
 	_get_response = NULL;
+	closeResponseFile ();
+	_rangeFrom = -1;
+	_rangeTo = -1;
+	_getExecuted = false;
 	_response = "";
 	_connectionState = READ_HEADER;
 }
@@ -2,9 +2,15 @@
 #include "XmlRpcSocket.h"
 #include "XmlRpcUtil.h"
 
+#include "rts2-config.h"
+
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef RTS2_HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
 #ifndef MAKEDEPEND
 
 #if defined(_WINDOWS)
@@ -67,10 +73,21 @@ XmlRpcSocket::socket()
 }
 
 
+static void (*_closeHook) (int) = NULL;
+
+void
+XmlRpcSocket::setCloseHook(void (*closeHook) (int))
+{
+	_closeHook = closeHook;
+}
+
+
 void
 XmlRpcSocket::close(int fd)
 {
 	XmlRpcUtil::log(4, "XmlRpcSocket::close: fd %d.", fd);
+	if (_closeHook)
+		_closeHook(fd);
 	#if defined(_WINDOWS)
 	closesocket(fd);
 	#else
@@ -275,6 +292,54 @@ XmlRpcSocket::nbWriteBuf(int fd, const char *buf, size_t buf_len, size_t *bytesS
 }
 
 
+int
+XmlRpcSocket::nbSendFile(int fd, int file, off_t offset, size_t length, size_t *bytesSoFar)
+{
+	size_t nToWrite = length - *bytesSoFar;
+	if (nToWrite > SEND_FILE_WINDOW)
+		nToWrite = SEND_FILE_WINDOW;
+	if (nToWrite == 0)
+		return 0;
+
+	off_t off = offset + *bytesSoFar;
+#ifdef RTS2_HAVE_SYS_SENDFILE_H
+	ssize_t n = sendfile(fd, file, &off, nToWrite);
+	XmlRpcUtil::log(5, "XmlRpcSocket::nbSendFile: sendfile returned %d.", (int) n);
+	// some filesystems do not support sendfile
+	if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+#else
+	ssize_t n = -1;
+#endif
+	{
+		// copy data through small buffer
+		char buf[65536];
+		if (nToWrite > sizeof(buf))
+			nToWrite = sizeof(buf);
+		n = pread(file, buf, nToWrite, off);
+		if (n == 0)
+		{
+			XmlRpcUtil::error("XmlRpcSocket::nbSendFile: file is shorter than expected.");
+			return -1;
+		}
+		if (n > 0)
+			n = send(fd, buf, n, 0);
+	}
+
+	if (n > 0)
+	{
+		*bytesSoFar += n;
+		return 0;
+	}
+	// sendfile returns 0 at end of file, so the file was truncated
+	if (n == 0)
+	{
+		XmlRpcUtil::error("XmlRpcSocket::nbSendFile: file is shorter than expected.");
+		return -1;
+	}
+	if (nonFatalError())
+		return 0;
+	return -1;
+}
 
 // Returns last errno
 int
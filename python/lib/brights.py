@@ -25,9 +25,15 @@ import libnova
 
 __DS9 = 'brights'
 
+def data_hdu(hdu):
+	"""Returns HDU holding image data. RTS2 stores compressed images in the first extension, primary HDU then holds only header."""
+	if hdu[0].data is None and len(hdu) > 1:
+		return hdu[1]
+	return hdu[0]
+
 def find_brightest(fn, hdu, verbose = 0, useDS9 = False):
 	"""Find brightest star on the image. Returns tuple of X,Y,flux and ratio of the flux to the second brightest star."""
-	data = np.array(hdu[0].data,np.int32)
+	data = np.array(data_hdu(hdu).data,np.int32)
 	bkg = sep.Background(data)
 	bkg.subfrom(data)
 	thres = 1.5 * bkg.globalrms
@@ -113,7 +119,7 @@ def add_wcs(fn, asecpix, rotang, flip = '', verbose = 0, dss = False, useDS9 = F
 
 	wh = w.to_header()
 	for h in wh.items():
-		hdu[0].header.append((h[0], h[1], wh.comments[h[0]]))
+		data_hdu(hdu).header.append((h[0], h[1], wh.comments[h[0]]))
 	hdu.writeto('out.fits', clobber=True)
 
 	if d is not None:
@@ -138,7 +144,8 @@ def add_wcs(fn, asecpix, rotang, flip = '', verbose = 0, dss = False, useDS9 = F
 			d.set('regions export tsv {0}'.format(save_regions))
 
 	# calculate offsets..ra dec, and alt az
-	offsp = np.array([[x,y], [hdu[0].header['NAXIS1'] / 2.0, hdu[0].header['NAXIS2'] / 2.0]], np.float)
+	dh = data_hdu(hdu).header
+	offsp = np.array([[x,y], [dh['NAXIS1'] / 2.0, dh['NAXIS2'] / 2.0]], np.float)
 	radecoff = w.all_pix2world(offsp, 1)
 
 	off_ra = (radecoff[1][0] - radecoff[0][0] + 360.0) % 360.0
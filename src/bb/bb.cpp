@@ -43,6 +43,7 @@ BB::BB (int argc, char ** argv):
 	task_queue (this)
 {
 	rpcPort = 8889;
+	XmlRpcSocket::setCloseHook (&getMasterPollFDClosed);
 
 	createValue (queueSize, "queue_size", "task queue size", false);
 
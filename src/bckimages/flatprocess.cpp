@@ -85,7 +85,7 @@ void
 process_file (char *filename)
 {
 	fitsfile *fptr;
-	int status, nfound, anynull;
+	int status, nfound, nhdus, hdutype, anynull;
 	double median;
 	long naxes[4], fpixel, nbuffer, npixels, npix, ii;
 	char camera_name[80];
@@ -100,21 +100,7 @@ process_file (char *filename)
 		printerror (status);
 		return;
 	}
-	if (fits_read_keys_lng (fptr, (char *) "NAXIS", 1, 2, naxes, &nfound, &status))
-		goto err;
-	if (nfound < 1)
-	{
-		if (verbose)
-			printf ("No image found in %s\n", filename);
-		fits_close_file (fptr, &status);
-		check_unlink (filename);
-		return;
-	}
-	nfound--;
-	npixels = naxes[nfound];
-	for (; nfound > 0; nfound--)
-		npixels *= naxes[nfound];
-	npix = npixels;
+	// header is always in the primary HDU
 	if (fits_read_key_str (fptr, (char *) "CAM_NAME", camera_name, NULL, &status))
 	{
 		if (verbose)
@@ -144,6 +130,38 @@ process_file (char *filename)
 				max = INFINITY;
 		}
 	}
+	if (fits_get_img_dim (fptr, &nfound, &status))
+		goto err;
+	// compressed images are stored in the first extension, primary HDU is empty
+	if (nfound == 0)
+	{
+		if (fits_get_num_hdus (fptr, &nhdus, &status))
+			goto err;
+		if (nhdus > 1)
+		{
+			if (fits_movabs_hdu (fptr, 2, &hdutype, &status))
+				goto err;
+			if (hdutype == IMAGE_HDU && fits_get_img_dim (fptr, &nfound, &status))
+				goto err;
+		}
+	}
+	if (nfound < 1)
+	{
+		if (verbose)
+			printf ("No image found in %s\n", filename);
+		fits_close_file (fptr, &status);
+		check_unlink (filename);
+		return;
+	}
+	if (nfound > 2)
+		nfound = 2;
+	if (fits_get_img_size (fptr, nfound, naxes, &status))
+		goto err;
+	nfound--;
+	npixels = naxes[nfound];
+	for (; nfound > 0; nfound--)
+		npixels *= naxes[nfound];
+	npix = npixels;
 	if (verbose > 1)
 		printf ("%s: min %f, max %f, npix: %li\n", filename, min, max, npixels);
 	fpixel = 1;
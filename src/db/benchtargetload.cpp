@@ -0,0 +1,149 @@
+/*
+ * Benchmark of target loading.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2db/appdb.h"
+#include "rts2db/target.h"
+#include "rts2db/targetset.h"
+#include "configuration.h"
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <sys/time.h>
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Compares loading of all targets one by one, with a query for every target,
+ * with bulk load used by TargetSet. The first bulk load runs on cold caches,
+ * following runs measure warm load.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class BenchTargetLoad:public rts2db::AppDb
+{
+	public:
+		BenchTargetLoad (int argc, char **argv);
+
+	protected:
+		virtual int processOption (int in_opt);
+		virtual int doProcessing ();
+
+	private:
+		int runs;
+		const char *targetType;
+
+		double loadSingle (std::vector <int> &ids);
+		double loadBulk (size_t &loaded);
+};
+
+BenchTargetLoad::BenchTargetLoad (int argc, char **argv):rts2db::AppDb (argc, argv)
+{
+	runs = 3;
+	targetType = NULL;
+
+	addOption ('r', "runs", 1, "number of runs (default to 3); first run is on cold caches");
+	addOption ('t', "target_type", 1, "load only targets of given types");
+}
+
+int BenchTargetLoad::processOption (int in_opt)
+{
+	switch (in_opt)
+	{
+		case 'r':
+			runs = atoi (optarg);
+			if (runs < 1)
+				return -1;
+			break;
+		case 't':
+			targetType = optarg;
+			break;
+		default:
+			return rts2db::AppDb::processOption (in_opt);
+	}
+	return 0;
+}
+
+double BenchTargetLoad::loadSingle (std::vector <int> &ids)
+{
+	rts2core::Configuration *config = rts2core::Configuration::instance ();
+	double t = now ();
+	for (std::vector <int>::iterator iter = ids.begin (); iter != ids.end (); iter++)
+	{
+		try
+		{
+			delete createTarget (*iter, config->getObserver (), config->getObservatoryAltitude ());
+		}
+		catch (rts2core::Error &er)
+		{
+		}
+	}
+	return now () - t;
+}
+
+double BenchTargetLoad::loadBulk (size_t &loaded)
+{
+	double t = now ();
+	rts2db::TargetSet ts (targetType);
+	ts.load ();
+	loaded = ts.size ();
+	return now () - t;
+}
+
+int BenchTargetLoad::doProcessing ()
+{
+	std::vector <int> ids;
+	size_t loaded = 0;
+
+	// the first bulk load retrieves IDs for single loads and is the cold run
+	double t = now ();
+	{
+		rts2db::TargetSet ts (targetType);
+		ts.load ();
+		for (rts2db::TargetSet::iterator iter = ts.begin (); iter != ts.end (); iter++)
+			ids.push_back (iter->first);
+	}
+	t = now () - t;
+
+	std::cout << "loading " << ids.size () << " targets" << std::endl
+		<< std::fixed << std::setprecision (3)
+		<< std::setw (4) << "run" << std::setw (12) << "single [s]" << std::setw (12) << "bulk [s]" << std::setw (10) << "speedup" << std::endl
+		<< std::setw (4) << "cold" << std::setw (12) << "-" << std::setw (12) << t << std::setw (10) << "-" << std::endl;
+
+	for (int i = 1; i <= runs; i++)
+	{
+		double single = loadSingle (ids);
+		double bulk = loadBulk (loaded);
+		std::cout << std::setw (4) << i << std::setw (12) << single << std::setw (12) << bulk << std::setw (10) << std::setprecision (1) << (single / bulk) << std::setprecision (3) << std::endl;
+		if (loaded != ids.size ())
+			std::cerr << "bulk load returned " << loaded << " targets, expected " << ids.size () << std::endl;
+	}
+	return 0;
+}
+
+int main (int argc, char **argv)
+{
+	BenchTargetLoad app (argc, argv);
+	return app.run ();
+}
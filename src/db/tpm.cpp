@@ -258,7 +258,7 @@ int TPM::printImage (rts2image::Image * image, WorldCoor * wcs, std::ostream & _
 	float expo;
 	double aux0 = NAN;
 	double aux1 = NAN;
-	int num_pixels;
+	long num_pixels[2];
 	double x_pos, y_pos;
 
 	if (isnan (x_ref) || isnan (y_ref))
@@ -267,10 +267,9 @@ int TPM::printImage (rts2image::Image * image, WorldCoor * wcs, std::ostream & _
 	{
 		if (x_ref < 0.0 || y_ref < 0.0)	// use center of image
 		{
-			image->getValue ("NAXIS1", num_pixels, true);
-			x_ref = num_pixels / 2.0;
-			image->getValue ("NAXIS2", num_pixels, true);
-			y_ref = num_pixels / 2.0;
+			image->getImageSize (num_pixels, 2);
+			x_ref = num_pixels[0] / 2.0;
+			y_ref = num_pixels[1] / 2.0;
 		}
 		pix2wcs (wcs, x_ref, y_ref, &x_pos, &y_pos);
 		actual.setRa (x_pos);
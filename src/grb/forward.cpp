@@ -231,6 +231,7 @@ int Rts2ConnFwGrb::init_listen ()
 	if (gcn_listen_sock >= 0)
 	{
 		close (gcn_listen_sock);
+		getMaster ()->pollFDClosed (gcn_listen_sock);
 		gcn_listen_sock = -1;
 	}
 
@@ -312,6 +313,7 @@ int Rts2ConnFwGrb::receive (rts2core::Block *block)
 	{
 		// try to accept connection..
 		close (sock);			 // close previous connections..we support only one GCN connection
+		block->pollFDClosed (sock);
 		sock = -1;
 		struct sockaddr_in other_side;
 		socklen_t addr_size = sizeof (struct sockaddr_in);
@@ -123,6 +123,16 @@ void sendSelection (std::ostringstream &os, rts2core::ValueSelection *value)
 
 }
 
+bool API::isHeavy (const std::string &path, XmlRpc::HttpParams *params)
+{
+#ifdef RTS2_HAVE_PGSQL
+	std::vector <std::string> vals = SplitStr (path, std::string ("/"));
+	return vals.size () > 0 && isDBRequest (vals[0]) && params->getInteger ("ch", 0) == 0;
+#else
+	return false;
+#endif
+}
+
 void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
 {
 	std::vector <std::string> vals = SplitStr (path, std::string ("/"));
@@ -519,10 +529,11 @@ void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::H
 			{
 				bool ext = params->getInteger ("e", 0);
 				double from = params->getDouble ("from", 0);
+				long since = params->getLong ("g", 0);
 
 				// send centrald values
 				os << "\"centrald\":{";
-				rts2json::sendConnectionValues (os, master->getSingleCentralConn (), params, from, ext);
+				rts2json::sendConnectionValues (os, master->getSingleCentralConn (), params, from, ext, since);
 
 				// send own values first
 				os << "},\"" << ((HttpD *) getMasterApp ())->getDeviceName () << "\":{";
@@ -534,7 +545,7 @@ void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::H
 					if ((*iter)->getName ()[0] == '\0')
 						continue;
 					os << ",\"" << (*iter)->getName () << "\":{";
-					rts2json::sendConnectionValues (os, *iter, params, from, ext);
+					rts2json::sendConnectionValues (os, *iter, params, from, ext, since);
 					os << '}';
 				}
 			}
@@ -544,6 +555,7 @@ void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::H
 				const char *device = params->getString ("d","");
 				bool ext = params->getInteger ("e", 0);
 				double from = params->getDouble ("from", 0);
+				long since = params->getLong ("g", 0);
 				if (strcmp (device, ((HttpD *) getMasterApp ())->getDeviceName ()))
 				{
 					if (isCentraldName (device))
@@ -552,7 +564,7 @@ void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::H
 						conn = master->getOpenConnection (device);
 					if (conn == NULL)
 						throw JSONException ("cannot find device");
-					rts2json::sendConnectionValues (os, conn, params, from, ext);
+					rts2json::sendConnectionValues (os, conn, params, from, ext, since);
 				}
 				else
 				{
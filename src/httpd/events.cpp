@@ -134,18 +134,18 @@ void Events::parseValue (xmlNodePtr event, std::string deviceName)
 		}
 		else if (xmlStrEqual (action->name, (xmlChar *) "record"))
 		{
-			valueCommands.push_back (new ValueChangeRecord (master, deviceName, std::string ((char *) valueName->children->content), cadency, test));
+			valueCommands.addCommand (new ValueChangeRecord (master, deviceName, std::string ((char *) valueName->children->content), cadency, test));
 		}
 		else if (xmlStrEqual (action->name, (xmlChar *) "command"))
 		{
-			valueCommands.push_back (new ValueChangeCommand (master, deviceName, std::string ((char *) valueName->children->content), cadency, test, std::string ((char *) action->children->content)));
+			valueCommands.addCommand (new ValueChangeCommand (master, deviceName, std::string ((char *) valueName->children->content), cadency, test, std::string ((char *) action->children->content)));
 		}
 		else if (xmlStrEqual (action->name, (xmlChar *) "email"))
 		{
 			ValueChangeEmail *email = new ValueChangeEmail (master, deviceName, std::string ((char *) valueName->children->content), cadency, test);
 			email->parse (action, deviceName.c_str ());
 			// add to, subject, body,..
-			valueCommands.push_back (email);
+			valueCommands.addCommand (email);
 		}
 		else
 		{
@@ -184,11 +184,11 @@ void Events::parseMessage (xmlNodePtr event, std::string deviceName)
 		}
 /*		else if (xmlStrEqual (action->name, (xmlChar *) "record"))
 		{
-			valueCommands.push_back (new ValueChangeRecord (master, deviceName, std::string ((char *) valueName->children->content), cadency, test));
+			valueCommands.addCommand (new ValueChangeRecord (master, deviceName, std::string ((char *) valueName->children->content), cadency, test));
 		}
 		else if (xmlStrEqual (action->name, (xmlChar *) "command"))
 		{
-			valueCommands.push_back (new ValueChangeCommand (master, deviceName, std::string ((char *) valueName->children->content), cadency, test, std::string ((char *) action->children->content)));
+			valueCommands.addCommand (new ValueChangeCommand (master, deviceName, std::string ((char *) valueName->children->content), cadency, test, std::string ((char *) action->children->content)));
 		} */
 		else if (xmlStrEqual (action->name, (xmlChar *) "email"))
 		{
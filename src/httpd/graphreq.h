@@ -55,6 +55,8 @@ class AltAzTarget: public rts2json::GetRequestAuthorized
 		AltAzTarget (const char *prefix, rts2json::HTTPServer *_http_server, XmlRpc::XmlRpcServer *s):rts2json::GetRequestAuthorized (prefix, _http_server, "altitude target graph", s) {};
 
 		virtual void authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length);
+
+		virtual bool isHeavy (const std::string &path, XmlRpc::HttpParams *params) { return true; }
 };
 
 #endif /* RTS2_HAVE_LIBJPEG */ 
@@ -71,6 +73,8 @@ class Graph: public rts2json::GetRequestAuthorized
 
 		virtual void authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length);
 
+		virtual bool isHeavy (const std::string &path, XmlRpc::HttpParams *params) { return true; }
+
 	private:
 		void printDevices (const char* &response_type, char* &response, size_t &response_length);
 
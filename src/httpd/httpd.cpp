@@ -20,6 +20,7 @@
 
 #include "rts2db/constraints.h"
 #include "rts2script/connexe.h"
+#include "rts2script/scriptcache.h"
 #include "httpd.h"
 
 #ifdef RTS2_HAVE_PGSQL
@@ -87,7 +88,7 @@ void XmlDevInterface::stateChanged (rts2core::ServerState * state)
 
 void XmlDevInterface::valueChanged (rts2core::Value * value)
 {
-	changedTimes[value] = getNow ();
+	valueUpdated (value);
 	(getMaster ())->valueChangedEvent (getConnection (), value);
 }
 
@@ -453,6 +454,36 @@ rts2image::imageProceRes XmlDevCameraClient::processImage (rts2image::Image * im
 int HttpD::info ()
 {
 	bbQueueSize->setValueInteger (events.bbServers.queueSize ());
+#ifdef RTS2_HAVE_PGSQL
+	recordQueue->setValueInteger (valueRecorder->queueSize ());
+	recordFlush->setValueDouble (valueRecorder->getFlushDuration ());
+	recordRows->setValueLong (valueRecorder->getRows ());
+	recordErrors->setValueLong (valueRecorder->getErrors ());
+#endif
+	if (requestWorkers)
+	{
+		reqQueue->setValueInteger (requestWorkers->getQueueSize ());
+		reqRejected->setValueLong (requestWorkers->getRejected ());
+		reqEndpoints->clear ();
+		reqCount->clear ();
+		reqLatency->clear ();
+		for (std::map <std::string, RequestStat>::iterator iter = requestWorkers->getStats ().begin (); iter != requestWorkers->getStats ().end (); iter++)
+		{
+			reqEndpoints->addValue (iter->first);
+			reqCount->addValue (iter->second.requests);
+			reqLatency->addValue (iter->second.latency / iter->second.requests);
+		}
+	}
+	pushSubscriptions->clear ();
+	pushDispatched->clear ();
+	for (std::list <rts2json::AsyncAPI *>::iterator iter = asyncAPIs.begin (); iter != asyncAPIs.end (); iter++)
+	{
+		std::string subs = (*iter)->getSubscriptions ();
+		if (subs.empty ())
+			continue;
+		pushSubscriptions->addValue (subs);
+		pushDispatched->addValue ((*iter)->getDispatched ());
+	}
 #ifdef RTS2_HAVE_PGSQL
 	return DeviceDb::info ();
 #else
@@ -539,6 +570,10 @@ int HttpD::init ()
 	if (ret)
 		return ret;
 
+#ifdef RTS2_HAVE_PGSQL
+	valueRecorder = new ValueRecorder (this, recordBatch->getValueInteger (), recordInterval->getValueDouble ());
+#endif
+
 	addConnection (notifyConn);
 
 	if (printDebug ())
@@ -613,12 +648,57 @@ int HttpD::init ()
 	// auth_localhost
 	auth_localhost = Configuration::instance ()->getBoolean ("xmlrpcd", "auth_localhost", auth_localhost);
 
+	// preview cache
+	std::string thumbDir;
+	Configuration::instance ()->getString ("xmlrpcd", "thumbnail_cache", thumbDir, "");
+	if (thumbDir.length () > 0)
+	{
+		thumbnailCache = new rts2core::ThumbnailCache (thumbDir.c_str (), (size_t) Configuration::instance ()->getIntegerDefault ("xmlrpcd", "thumbnail_cache_size", 256) * 1024 * 1024);
+		if (thumbnailCache->init ())
+		{
+			logStream (MESSAGE_ERROR) << "cannot initialize thumbnail cache in " << thumbDir << ": " << strerror (errno) << sendLog;
+			delete thumbnailCache;
+			thumbnailCache = NULL;
+		}
+	}
+
 #ifdef RTS2_HAVE_LIBJPEG
 	Magick::InitializeMagick (".");
 #endif /* RTS2_HAVE_LIBJPEG */
+
 	return ret;
 }
 
+void HttpD::beforeRun ()
+{
+#ifdef RTS2_HAVE_PGSQL
+	DeviceDb::beforeRun ();
+#else
+	rts2core::Device::beforeRun ();
+#endif
+	// threads must be started in the daemonized process
+#ifdef RTS2_HAVE_PGSQL
+	if (valueRecorder->start ())
+	{
+		logStream (MESSAGE_ERROR) << "cannot start value recorder: " << strerror (errno) << sendLog;
+		exit (1);
+	}
+#endif
+
+	// threads for heavy requests
+	int workers = Configuration::instance ()->getIntegerDefault ("xmlrpcd", "request_workers", 0);
+	if (workers > 0)
+	{
+		requestWorkers = new RequestWorkers (this, workers, Configuration::instance ()->getIntegerDefault ("xmlrpcd", "request_queue", 50));
+		if (requestWorkers->init ())
+		{
+			logStream (MESSAGE_ERROR) << "cannot start request workers: " << strerror (errno) << sendLog;
+			exit (1);
+		}
+	}
+	reqWorkers->setValueInteger (workers);
+}
+
 void HttpD::addPollSocks ()
 {
 #ifdef RTS2_HAVE_PGSQL
@@ -626,6 +706,8 @@ void HttpD::addPollSocks ()
 #else
 	rts2core::Device::addPollSocks ();
 #endif
+	if (requestWorkers)
+		addPollFD (requestWorkers->getNotifyFd (), POLLIN | POLLPRI);
 	XmlRpcServer::addToFd (&getMasterAddPollFD);
 }
 
@@ -636,6 +718,8 @@ void HttpD::pollSuccess ()
 #else
 	rts2core::Device::pollSuccess ();
 #endif
+	if (requestWorkers && isForRead (requestWorkers->getNotifyFd ()))
+		requestWorkers->processFinished ();
 	XmlRpcServer::checkFd (&getMasterGetEvents);
 }
 
@@ -646,6 +730,8 @@ void HttpD::signaledHUP ()
 #else
 	rts2core::Device::signaledHUP ();
 #endif
+	// scheduling APIs cache script durations, which depend on configuration
+	rts2script::ScriptCache::instance ()->clear ();
 	reloadEventsFile ();
 }
 
@@ -662,6 +748,7 @@ void HttpD::connectionRemoved (rts2core::Connection *conn)
 	{
 		if ((*iter)->isForConnection (conn))
 		{
+			subscriptions.unsubscribe (*iter);
 			iter = asyncAPIs.erase (iter);
 			numberAsyncAPIs->setValueInteger (asyncAPIs.size ());
 			sendValueAll (numberAsyncAPIs);
@@ -671,6 +758,8 @@ void HttpD::connectionRemoved (rts2core::Connection *conn)
 			iter++;
 		}
 	}
+	subscriptions.connectionRemoved (conn);
+	events.valueCommands.index.connectionRemoved (conn);
 #ifdef RTS2_HAVE_PGSQL
 	DeviceDb::connectionRemoved (conn);
 #else
@@ -688,6 +777,13 @@ void HttpD::asyncFinished (XmlRpcServerConnection *source)
 	XmlRpcServer::asyncFinished (source);
 }
 
+int HttpD::offloadGet (XmlRpcServerConnection *source, XmlRpc::XmlRpcServerGetRequest *request, bool heavy)
+{
+	if (requestWorkers == NULL)
+		return OFFLOAD_INLINE;
+	return requestWorkers->offload (source, request, heavy);
+}
+
 void HttpD::removeConnection (XmlRpcServerConnection *source)
 {
 	for (std::list <rts2json::AsyncAPI *>::iterator iter = asyncAPIs.begin (); iter != asyncAPIs.end (); iter++)
@@ -767,8 +863,13 @@ HttpD::HttpD (int argc, char **argv): rts2core::Device (argc, argv, DEVICE_TYPE_
   devices ("/devices", this, this)
 {
 	rpcPort = 8889;
+	XmlRpcSocket::setCloseHook (&getMasterPollFDClosed);
 	stateChangeFile = NULL;
 	defLabel = "%Y-%m-%d %H:%M:%S @OBJECT";
+	thumbnailCache = NULL;
+	requestWorkers = NULL;
+
+	pthread_mutex_init (&sessionMutex, NULL);
 
 	auth_localhost = true;
 
@@ -795,6 +896,29 @@ HttpD::HttpD (int argc, char **argv): rts2core::Device (argc, argv, DEVICE_TYPE_
 	createValue (messageBufferSize, "message_buffer_size", "number of last messages to kept in memory", false, RTS2_VALUE_WRITABLE);
 	messageBufferSize->setValueInteger (100);
 
+#ifdef RTS2_HAVE_PGSQL
+	valueRecorder = NULL;
+
+	createValue (recordQueue, "record_queue", "number of recorded values waiting to be written to database", false);
+	createValue (recordFlush, "record_flush", "[s] duration of the last write of recorded values", false, RTS2_DT_TIMEINTERVAL);
+	createValue (recordRows, "record_rows", "number of recorded values written to database", false);
+	createValue (recordErrors, "record_errors", "number of recorded values lost due to database errors", false);
+	createValue (recordBatch, "record_batch", "number of recorded values written in one transaction", false, RTS2_VALUE_WRITABLE);
+	recordBatch->setValueInteger (500);
+	createValue (recordInterval, "record_interval", "[s] maximal time recorded values wait before they are written", false, RTS2_VALUE_WRITABLE | RTS2_DT_TIMEINTERVAL);
+	recordInterval->setValueDouble (5);
+#endif
+
+	createValue (reqWorkers, "request_workers", "number of threads executing heavy requests", false);
+	createValue (reqQueue, "request_queue", "number of heavy requests waiting for execution", false);
+	createValue (reqRejected, "request_rejected", "number of requests rejected as the queue was full", false);
+	createValue (reqEndpoints, "request_endpoints", "paths of requests executed by worker threads", false);
+	createValue (reqCount, "request_count", "number of requests executed by worker threads", false);
+	createValue (reqLatency, "request_latency", "[s] average time from request arrival to response, including queue wait", false, RTS2_DT_TIMEINTERVAL);
+
+	createValue (pushSubscriptions, "push_subscriptions", "values subscribed by push clients", false);
+	createValue (pushDispatched, "push_dispatched", "number of value changes sent to push clients", false);
+
 	debugTestscript = false;
 
 	bbQueueName = NULL;
@@ -820,6 +944,9 @@ HttpD::HttpD (int argc, char **argv): rts2core::Device (argc, argv, DEVICE_TYPE_
 
 HttpD::~HttpD ()
 {
+	// workers might use sessions, thumbnail cache,..
+	delete requestWorkers;
+
 	for (std::vector <rts2json::Directory *>::iterator id = directories.begin (); id != directories.end (); id++)
 		delete *id;
 
@@ -828,6 +955,12 @@ HttpD::~HttpD ()
 		delete (*iter).second;
 	}
 	sessions.clear ();
+	pthread_mutex_destroy (&sessionMutex);
+	delete thumbnailCache;
+#ifdef RTS2_HAVE_PGSQL
+	// writes remaining values
+	delete valueRecorder;
+#endif
 #ifdef RTS2_HAVE_LIBJPEG
 	MagickLib::DestroyMagick ();
 #endif /* RTS2_HAVE_LIBJPEG */
@@ -884,6 +1017,20 @@ int HttpD::setValue (rts2core::Value *old_value, rts2core::Value *new_value)
 		for (BBServers::iterator iter = events.bbServers.begin (); iter != events.bbServers.end (); iter++)
 			iter->setCadency (new_value->getValueInteger ());
 	}
+#ifdef RTS2_HAVE_PGSQL
+	if (old_value == recordBatch)
+	{
+		if (new_value->getValueInteger () < 1)
+			return -2;
+		valueRecorder->setBatch (new_value->getValueInteger (), recordInterval->getValueDouble ());
+	}
+	if (old_value == recordInterval)
+	{
+		if (!(new_value->getValueDouble () >= 0))
+			return -2;
+		valueRecorder->setBatch (recordBatch->getValueInteger (), new_value->getValueDouble ());
+	}
+#endif
 	// if it is a template file, load it immediately
 	for (std::list <XmlDevCameraClient *>::iterator iter = camClis.begin (); iter != camClis.end (); iter++)
 	{
@@ -924,15 +1071,11 @@ void HttpD::valueChangedEvent (rts2core::Connection * conn, rts2core::Value * ne
 {
 	double now = getNow ();
 	// look if there is some state change command entry, which match us..
-	for (ValueCommands::iterator iter = events.valueCommands.begin (); iter != events.valueCommands.end (); iter++)
+	const std::vector <ValueChange *> &vcs = events.valueCommands.index.find (conn, new_value);
+	for (std::vector <ValueChange *>::const_iterator iter = vcs.begin (); iter != vcs.end (); iter++)
 	{
 		ValueChange *vc = (*iter);
-		const char *name;
-		if (conn->getOtherType () == DEVICE_TYPE_SERVERD)
-			name = "centrald";
-		else
-			name = conn->getName ();
-		if (vc->isForValue (name, new_value->getName (), now))
+		if (vc->isDue (now))
 		{
 			try
 			{
@@ -945,7 +1088,8 @@ void HttpD::valueChangedEvent (rts2core::Connection * conn, rts2core::Value * ne
 			}
 		}
 	}
-	for (std::list <rts2json::AsyncAPI *>::iterator iter = asyncAPIs.begin (); iter != asyncAPIs.end (); iter++)
+	const std::vector <rts2json::AsyncAPI *> &subs = subscriptions.find (conn, new_value);
+	for (std::vector <rts2json::AsyncAPI *>::const_iterator iter = subs.begin (); iter != subs.end (); iter++)
 		(*iter)->valueChanged (conn, new_value);
 }
 
@@ -1019,18 +1163,19 @@ void HttpD::fileModified (struct inotify_event *event)
 std::string HttpD::addSession (std::string _username, time_t _timeout)
 {
 	Session *s = new Session (_username, time(NULL) + _timeout);
+	pthread_mutex_lock (&sessionMutex);
 	sessions[s->getSessionId()] = s;
+	pthread_mutex_unlock (&sessionMutex);
 	return s->getSessionId ();
 }
 
 bool HttpD::existsSession (std::string sessionId)
 {
-	std::map <std::string, Session*>::iterator iter = sessions.find (sessionId);
-	if (iter == sessions.end ())
-	{
-		return false;
-	}
-	return true;
+	// called from request workers
+	pthread_mutex_lock (&sessionMutex);
+	bool ret = sessions.find (sessionId) != sessions.end ();
+	pthread_mutex_unlock (&sessionMutex);
+	return ret;
 }
 
 bool HttpD::getDebug ()
@@ -33,6 +33,7 @@
 #else
 #include "configuration.h"
 #include "device.h"
+#include "valuearray.h"
 #include "userlogins.h"
 #endif /* RTS2_HAVE_PGSQL */
 
@@ -58,6 +59,7 @@
 #include "planreq.h"
 #include "switchstatereq.h"
 #include "api.h"
+#include "requestworkers.h"
 
 #include "connnotify.h"
 #include "rts2script/execcli.h"
@@ -89,18 +91,16 @@ namespace rts2xmlrpc
 class XmlDevInterface:public rts2json::DevInterface
 {
 	public:
-		XmlDevInterface ():changedTimes () {}
+		XmlDevInterface ():rts2json::DevInterface () {}
 		void stateChanged (rts2core::ServerState * state);
 
 		void valueChanged (rts2core::Value * value);
 
+		void valueMetaChanged (rts2core::Value * value) { valueMetaUpdated (value); }
+
 	protected:
 		virtual HttpD *getMaster () = 0;
 		virtual rts2core::Connection *getConnection () = 0;
-
-	private:
-		// value change times
-		std::map <rts2core::Value *, double> changedTimes;
 };
 
 /**
@@ -111,7 +111,7 @@ class XmlDevInterface:public rts2json::DevInterface
  *
  * @addgroup XMLRPC
  */
-class XmlDevClient:public rts2image::DevClientWriteImage, XmlDevInterface
+class XmlDevClient:public rts2image::DevClientWriteImage, public XmlDevInterface
 {
 	public:
 		XmlDevClient (rts2core::Connection *conn):rts2image::DevClientWriteImage (conn), XmlDevInterface () {}
@@ -128,6 +128,12 @@ class XmlDevClient:public rts2image::DevClientWriteImage, XmlDevInterface
 			rts2image::DevClientWriteImage::valueChanged (value);
 		}
 
+		virtual void valueMetaChanged (rts2core::Value * value)
+		{
+			XmlDevInterface::valueMetaChanged (value);
+			rts2image::DevClientWriteImage::valueMetaChanged (value);
+		}
+
 	protected:
 		virtual HttpD *getMaster ()
 		{
@@ -145,7 +151,7 @@ class XmlDevClient:public rts2image::DevClientWriteImage, XmlDevInterface
  *
  * @addgroup XMLRPC
  */
-class XmlDevTelescopeClient:public rts2image::DevClientTelescopeImage, XmlDevInterface
+class XmlDevTelescopeClient:public rts2image::DevClientTelescopeImage, public XmlDevInterface
 {
 	public:
 		XmlDevTelescopeClient (rts2core::Connection *conn):rts2image::DevClientTelescopeImage (conn), XmlDevInterface () {}
@@ -162,6 +168,12 @@ class XmlDevTelescopeClient:public rts2image::DevClientTelescopeImage, XmlDevInt
 			rts2image::DevClientTelescopeImage::valueChanged (value);
 		}
 
+		virtual void valueMetaChanged (rts2core::Value * value)
+		{
+			XmlDevInterface::valueMetaChanged (value);
+			rts2image::DevClientTelescopeImage::valueMetaChanged (value);
+		}
+
 	protected:
 		virtual HttpD *getMaster ()
 		{
@@ -179,7 +191,7 @@ class XmlDevTelescopeClient:public rts2image::DevClientTelescopeImage, XmlDevInt
  *
  * @addgroup XMLRPC
  */
-class XmlDevFocusClient:public rts2image::DevClientFocusImage, XmlDevInterface
+class XmlDevFocusClient:public rts2image::DevClientFocusImage, public XmlDevInterface
 {
 	public:
 		XmlDevFocusClient (rts2core::Connection *conn):rts2image::DevClientFocusImage (conn), XmlDevInterface () {}
@@ -196,6 +208,12 @@ class XmlDevFocusClient:public rts2image::DevClientFocusImage, XmlDevInterface
 			rts2image::DevClientFocusImage::valueChanged (value);
 		}
 
+		virtual void valueMetaChanged (rts2core::Value * value)
+		{
+			XmlDevInterface::valueMetaChanged (value);
+			rts2image::DevClientFocusImage::valueMetaChanged (value);
+		}
+
 	protected:
 		virtual HttpD *getMaster ()
 		{
@@ -211,7 +229,7 @@ class XmlDevFocusClient:public rts2image::DevClientFocusImage, XmlDevInterface
  *
  * @author Petr Kubanek <petr@kubanek.net>
  */
-class XmlDevCameraClient:public rts2script::DevClientCameraExec, rts2script::ScriptInterface, XmlDevInterface
+class XmlDevCameraClient:public rts2script::DevClientCameraExec, rts2script::ScriptInterface, public XmlDevInterface
 {
 	public:
 		XmlDevCameraClient (rts2core::Connection *conn);
@@ -231,6 +249,12 @@ class XmlDevCameraClient:public rts2script::DevClientCameraExec, rts2script::Scr
 			XmlDevInterface::valueChanged (value);
 			rts2script::DevClientCameraExec::valueChanged (value);
 		}
+
+		virtual void valueMetaChanged (rts2core::Value * value)
+		{
+			XmlDevInterface::valueMetaChanged (value);
+			rts2script::DevClientCameraExec::valueMetaChanged (value);
+		}
 		
 		virtual rts2image::Image *createImage (const struct timeval *expStart);
 
@@ -453,6 +477,12 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 
 		virtual int getDefaultChannel () { return defchan; }
 
+		virtual rts2core::ThumbnailCache *getThumbnailCache () { return thumbnailCache; }
+
+#ifdef RTS2_HAVE_PGSQL
+		ValueRecorder *getValueRecorder () { return valueRecorder; }
+#endif
+
 		rts2core::ConnNotify * getNotifyConnection () { return notifyConn; }
 
 		void scriptProgress (double start, double end);
@@ -495,6 +525,8 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 		virtual int processOption (int in_opt);
 		virtual int init ();
 
+		virtual void beforeRun ();
+
 		virtual void signaledHUP ();
 
 		virtual void connectionRemoved (rts2core::Connection *coon);
@@ -502,11 +534,15 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 		virtual void asyncFinished (XmlRpcServerConnection *source);
 
 		virtual void removeConnection (XmlRpcServerConnection *source);
+
+		virtual int offloadGet (XmlRpcServerConnection *source, XmlRpc::XmlRpcServerGetRequest *request, bool heavy);
 	private:
 		int rpcPort;
 		const char *stateChangeFile;
 		const char *defLabel;
 		std::map <std::string, Session*> sessions;
+		// sessions are checked by request workers
+		pthread_mutex_t sessionMutex;
 
 		std::deque <Message> messages;
 
@@ -528,6 +564,17 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 
 		rts2core::ValueInteger *messageBufferSize;
 
+#ifdef RTS2_HAVE_PGSQL
+		ValueRecorder *valueRecorder;
+
+		rts2core::ValueInteger *recordQueue;
+		rts2core::ValueDouble *recordFlush;
+		rts2core::ValueLong *recordRows;
+		rts2core::ValueLong *recordErrors;
+		rts2core::ValueInteger *recordBatch;
+		rts2core::ValueDouble *recordInterval;
+#endif
+
 #ifndef RTS2_HAVE_PGSQL
 		const char *config_file;
 
@@ -607,6 +654,23 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 
 		rts2core::ConnNotify *notifyConn;
 
+		// preview cache, NULL if not configured
+		rts2core::ThumbnailCache *thumbnailCache;
+
+		// threads executing heavy requests, NULL if requests are executed in main loop
+		RequestWorkers *requestWorkers;
+
+		rts2core::ValueInteger *reqWorkers;
+		rts2core::ValueInteger *reqQueue;
+		rts2core::ValueLong *reqRejected;
+		rts2core::StringArray *reqEndpoints;
+		rts2core::IntegerArray *reqCount;
+		rts2core::DoubleArray *reqLatency;
+
+		// values subscribed by push clients and number of value changes sent to them
+		rts2core::StringArray *pushSubscriptions;
+		rts2core::IntegerArray *pushDispatched;
+
 		std::list <const char *> testScripts;
 		bool debugTestscript;
 
@@ -0,0 +1,229 @@
+/*
+ * Threads executing expensive HTTP requests.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "httpd.h"
+#include "requestworkers.h"
+#include "utilsfunc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace rts2xmlrpc;
+
+// thread routine
+void *executeRequests (void *arg)
+{
+	((RequestWorkers *) arg)->run ();
+	return NULL;
+}
+
+RequestWorkers::RequestWorkers (HttpD *_master, int _threads, size_t _maxQueue)
+{
+	master = _master;
+	nthreads = _threads;
+	maxQueue = _maxQueue;
+
+	notifyPipe[0] = -1;
+	notifyPipe[1] = -1;
+
+	stop = false;
+	started = 0;
+	rejected = 0;
+
+	pthread_mutex_init (&mutex, NULL);
+	pthread_cond_init (&cond, NULL);
+}
+
+RequestWorkers::~RequestWorkers ()
+{
+	pthread_mutex_lock (&mutex);
+	stop = true;
+	pthread_cond_broadcast (&cond);
+	pthread_mutex_unlock (&mutex);
+
+	for (std::vector <pthread_t>::iterator iter = threads.begin (); iter != threads.end (); iter++)
+		pthread_join (*iter, NULL);
+
+	if (notifyPipe[0] >= 0)
+	{
+		close (notifyPipe[0]);
+		close (notifyPipe[1]);
+	}
+
+	pthread_cond_destroy (&cond);
+	pthread_mutex_destroy (&mutex);
+}
+
+int RequestWorkers::init ()
+{
+	if (pipe (notifyPipe))
+		return -1;
+	fcntl (notifyPipe[0], F_SETFL, O_NONBLOCK);
+	fcntl (notifyPipe[1], F_SETFL, O_NONBLOCK);
+
+	for (int i = 0; i < nthreads; i++)
+	{
+		pthread_t t;
+		int ret = pthread_create (&t, NULL, executeRequests, (void *) this);
+		if (ret)
+		{
+			errno = ret;
+			return -1;
+		}
+		threads.push_back (t);
+	}
+	return 0;
+}
+
+int RequestWorkers::offload (XmlRpc::XmlRpcServerConnection *source, XmlRpc::XmlRpcServerGetRequest *request, bool heavy)
+{
+	// handler is used by a worker, request must wait
+	if (busy.find (request) != busy.end ())
+	{
+		if (getQueueSize () >= maxQueue)
+		{
+			rejected++;
+			return OFFLOAD_BUSY;
+		}
+		parked.push_back (std::pair <XmlRpc::XmlRpcServerConnection *, XmlRpc::XmlRpcServerGetRequest *> (source, request));
+		return OFFLOAD_QUEUED;
+	}
+
+	if (heavy == false)
+		return OFFLOAD_INLINE;
+
+	if (getQueueSize () >= maxQueue)
+	{
+		rejected++;
+		return OFFLOAD_BUSY;
+	}
+
+	Job job;
+	job.source = source;
+	job.request = request;
+	job.queued = getNow ();
+	job.failed = false;
+
+	busy.insert (request);
+
+	pthread_mutex_lock (&mutex);
+	pending.push_back (job);
+	pthread_cond_signal (&cond);
+	pthread_mutex_unlock (&mutex);
+
+	return OFFLOAD_QUEUED;
+}
+
+void RequestWorkers::processFinished ()
+{
+	char buf[100];
+	while (read (notifyPipe[0], buf, sizeof (buf)) > 0)
+		;
+
+	std::list <Job> done;
+	pthread_mutex_lock (&mutex);
+	done.swap (finished);
+	pthread_mutex_unlock (&mutex);
+
+	double now = getNow ();
+
+	for (std::list <Job>::iterator iter = done.begin (); iter != done.end (); iter++)
+	{
+		busy.erase (iter->request);
+
+		RequestStat &st = stats[iter->request->getPrefix ()];
+		st.requests++;
+		st.latency += now - iter->queued;
+
+		if (iter->failed)
+			iter->source->close ();
+		else
+			iter->source->offloadFinished ();
+	}
+
+	// resume all requests waiting for handlers which are not busy; they
+	// will be executed inline or queued again
+	for (std::list <std::pair <XmlRpc::XmlRpcServerConnection *, XmlRpc::XmlRpcServerGetRequest *> >::iterator iter = parked.begin (); iter != parked.end ();)
+	{
+		if (busy.find (iter->second) == busy.end ())
+		{
+			iter->first->offloadFinished ();
+			iter = parked.erase (iter);
+		}
+		else
+		{
+			iter++;
+		}
+	}
+}
+
+size_t RequestWorkers::getQueueSize ()
+{
+	pthread_mutex_lock (&mutex);
+	size_t ret = pending.size ();
+	pthread_mutex_unlock (&mutex);
+	return ret + parked.size ();
+}
+
+void RequestWorkers::run ()
+{
+	pthread_mutex_lock (&mutex);
+	int id = started++;
+	pthread_mutex_unlock (&mutex);
+
+#ifdef RTS2_HAVE_PGSQL
+	char conn_name[50];
+	snprintf (conn_name, sizeof (conn_name), "request_worker_%d", id);
+	if (master->initDB (conn_name))
+		logStream (MESSAGE_ERROR) << "request worker " << id << " cannot connect to database" << sendLog;
+#endif
+
+	pthread_mutex_lock (&mutex);
+	while (true)
+	{
+		while (pending.empty () && !stop)
+			pthread_cond_wait (&cond, &mutex);
+		if (stop)
+			break;
+
+		Job job = pending.front ();
+		pending.pop_front ();
+		pthread_mutex_unlock (&mutex);
+
+		try
+		{
+			job.source->executeGetRequest (job.request);
+		}
+		catch (...)
+		{
+			logStream (MESSAGE_ERROR) << "request worker " << id << ": unexpected exception while executing " << job.request->getPrefix () << sendLog;
+			job.failed = true;
+		}
+
+		pthread_mutex_lock (&mutex);
+		finished.push_back (job);
+		// wake up main loop
+		if (write (notifyPipe[1], "", 1) < 0 && errno != EAGAIN)
+			logStream (MESSAGE_ERROR) << "request worker " << id << " cannot notify main loop: " << strerror (errno) << sendLog;
+	}
+	pthread_mutex_unlock (&mutex);
+}
@@ -0,0 +1,162 @@
+/*
+ * Threads executing expensive HTTP requests.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2__REQUESTWORKERS__
+#define __RTS2__REQUESTWORKERS__
+
+#include "xmlrpc++/XmlRpc.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+namespace rts2xmlrpc
+{
+
+class HttpD;
+
+/**
+ * Statistics of requests executed by worker threads.
+ */
+class RequestStat
+{
+	public:
+		RequestStat () { requests = 0; latency = 0; }
+
+		long requests;
+		// sum of request latencies (queue wait and execution)
+		double latency;
+};
+
+/**
+ * Pool of threads executing heavy GET requests (plots, image previews, long
+ * database queries) outside of the main loop. Each worker opens its own
+ * database connection. Workers prepare the response in the connection,
+ * the main loop is notified through a pipe and writes the response.
+ *
+ * Request handlers keep state of the request being executed, so a handler
+ * is never executed by two threads at once. Requests arriving for a handler
+ * which is running on a worker wait until the worker finishes, and are then
+ * resumed from the main loop.
+ *
+ * All methods except run must be called from the main loop.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class RequestWorkers
+{
+	public:
+		/**
+		 * @param _master    HTTP server
+		 * @param _threads   number of worker threads
+		 * @param _maxQueue  maximal number of requests waiting for a worker
+		 */
+		RequestWorkers (HttpD *_master, int _threads, size_t _maxQueue);
+
+		/**
+		 * Stop and join worker threads. Requests waiting in the queue are dropped.
+		 */
+		~RequestWorkers ();
+
+		/**
+		 * Create notification pipe and start worker threads. Must be called
+		 * after the daemon forked, as threads do not survive fork.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int init ();
+
+		/**
+		 * Decide how request will be executed.
+		 *
+		 * @return OFFLOAD_INLINE, OFFLOAD_QUEUED or OFFLOAD_BUSY, see XmlRpc::XmlRpcServer::offloadGet
+		 */
+		int offload (XmlRpc::XmlRpcServerConnection *source, XmlRpc::XmlRpcServerGetRequest *request, bool heavy);
+
+		/**
+		 * Returns file descriptor which becomes readable when some request was executed.
+		 */
+		int getNotifyFd () { return notifyPipe[0]; }
+
+		/**
+		 * Send responses of executed requests, resume requests waiting for handlers.
+		 */
+		void processFinished ();
+
+		int getThreads () { return threads.size (); }
+
+		/**
+		 * Number of requests waiting for execution.
+		 */
+		size_t getQueueSize ();
+
+		long getRejected () { return rejected; }
+
+		/**
+		 * Statistics of executed requests, indexed by request prefix.
+		 */
+		std::map <std::string, RequestStat> &getStats () { return stats; }
+
+		/**
+		 * Worker thread loop.
+		 */
+		void run ();
+
+	private:
+		struct Job
+		{
+			XmlRpc::XmlRpcServerConnection *source;
+			XmlRpc::XmlRpcServerGetRequest *request;
+			double queued;
+			// true if request execution failed and connection should be closed
+			bool failed;
+		};
+
+		HttpD *master;
+		int nthreads;
+		size_t maxQueue;
+
+		std::vector <pthread_t> threads;
+		int notifyPipe[2];
+
+		// protects pending, finished, stop and started
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		std::list <Job> pending;
+		std::list <Job> finished;
+		bool stop;
+		// number of started threads, used to name database connections
+		int started;
+
+		// handlers with a request in pending or finished list, or running on a worker
+		std::set <XmlRpc::XmlRpcServerGetRequest *> busy;
+		// connections waiting for a busy handler
+		std::list <std::pair <XmlRpc::XmlRpcServerConnection *, XmlRpc::XmlRpcServerGetRequest *> > parked;
+
+		long rejected;
+		std::map <std::string, RequestStat> stats;
+};
+
+}
+
+#endif /* !__RTS2__REQUESTWORKERS__ */
@@ -24,10 +24,16 @@
 #include "expression.h"
 
 #include "emailaction.h"
+#include "rts2json/subscriptions.h"
 
 #include <map>
 #include <list>
 #include <string>
+#include <vector>
+
+#ifdef RTS2_HAVE_PGSQL
+#include <pthread.h>
+#endif
 
 using namespace rts2expression;
 
@@ -49,9 +55,12 @@ class ValueChange:public rts2core::Object
 		 */
 		virtual void postEvent (rts2core::Event * event);
 
-		bool isForValue (std::string _deviceName, std::string _valueName, double infoTime)
+		/**
+		 * Returns true if cadency passed since last run and test expression, if any, is true.
+		 */
+		bool isDue (double infoTime)
 		{
-			if (deviceName == _deviceName.c_str () && valueName == _valueName.c_str () && (cadency < 0 || lastTime + cadency < infoTime))
+			if (cadency < 0 || lastTime + cadency < infoTime)
 			{
 				if (test && test->evaluate () == 0)
 						return false;
@@ -60,6 +69,9 @@ class ValueChange:public rts2core::Object
 			return false;
 		}
 
+		const char *getDeviceName () { return deviceName.c_str (); }
+		const char *getValueName () { return valueName.c_str (); }
+
 		/**
 		 * Triggered when value is changed. Throws Errors on error.
 		 */
@@ -85,6 +97,127 @@ class ValueChange:public rts2core::Object
 		Expression *test;
 };
 
+#ifdef RTS2_HAVE_PGSQL
+
+/**
+ * Writes recorded values to the database. Values are queued by
+ * ValueChangeRecord and written by a background thread, which uses its own
+ * database connection, so database latency does not block the HTTP server.
+ * Rows are inserted with multi-row INSERT statements, one per records table.
+ * Transaction is commited when batch reaches given number of rows, or when
+ * the oldest queued row waits for given time.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ValueRecorder
+{
+	public:
+		ValueRecorder (HttpD *_master, size_t _batchRows = 500, double _batchInterval = 5);
+
+		/**
+		 * Write all queued rows and stop the writer thread.
+		 */
+		~ValueRecorder ();
+
+		/**
+		 * Start the writer thread. Must be called after the daemon forked,
+		 * as threads do not survive fork.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int start ();
+
+		/**
+		 * Queue value for writing.
+		 *
+		 * @param deviceName   device name
+		 * @param valueName    value name
+		 * @param suffix       suffix added to value name (e.g. RA, DEC), or NULL
+		 * @param recval_type  type of recorded value (base and display type)
+		 * @param value        value; integer and boolean values are stored as double
+		 * @param validTime    time of value change
+		 */
+		void queue (const char *deviceName, const char *valueName, const char *suffix, int recval_type, double value, double validTime);
+
+		/**
+		 * Set when rows are written.
+		 *
+		 * @param _batchRows      number of rows which triggers write
+		 * @param _batchInterval  maximal time (in seconds) rows wait in the queue
+		 */
+		void setBatch (size_t _batchRows, double _batchInterval);
+
+		/**
+		 * Number of rows waiting to be written.
+		 */
+		size_t queueSize ();
+
+		/**
+		 * Duration of the last database write (in seconds).
+		 */
+		double getFlushDuration ();
+
+		/**
+		 * Number of rows written since start.
+		 */
+		long getRows ();
+
+		/**
+		 * Number of rows lost due to database errors.
+		 */
+		long getErrors ();
+
+		/**
+		 * Writer thread main loop.
+		 */
+		void run ();
+
+	private:
+		struct Record
+		{
+			std::string deviceName;
+			std::string valueName;
+			const char *suffix;
+			int recval_type;
+			double value;
+			double validTime;
+		};
+
+		HttpD *master;
+
+		std::vector <Record> pending;
+		// time when the first pending record was queued
+		double pendingSince;
+		size_t writing;
+
+		size_t batchRows;
+		double batchInterval;
+		bool stop;
+
+		double flushDuration;
+		long rows;
+		long errors;
+
+		pthread_t thread;
+		bool started;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+
+		// recval ids, indexed by device and value name; used only by writer thread
+		std::map <std::string, int> recvalIds;
+
+		int getRecvalId (const Record &rec);
+
+		/**
+		 * Write records to database, commit the transaction.
+		 */
+		bool write (std::vector <Record> &batch);
+
+		void insertRows (const char *table, std::vector <std::pair <int, Record *> > &rows);
+};
+
+#endif /* RTS2_HAVE_PGSQL */
+
 /**
  * Record value change, either to database (rts2-xmlrpcd is compiled with database support) or
  * to standard output (if rts2-xmlrpcd is compiled without database support).
@@ -96,15 +229,10 @@ class ValueChangeRecord: public ValueChange
 	public:
 		ValueChangeRecord (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, Expression *_test):ValueChange (_master, _deviceName, _valueName, _cadency, _test) {}
 
+		/**
+		 * Record value. With database support, value is queued in HttpD ValueRecorder.
+		 */
 		virtual void run (rts2core::Value *val, double validTime);
-#ifdef RTS2_HAVE_PGSQL
-	private:
-		std::map <const char *, int> dbValueIds;
-		int getRecvalId (const char *suffix, int recval_type);
-		void recordValueInteger (int recval_id, int val, double validTime);
-		void recordValueDouble (int recval_id, double val, double validTime);
-		void recordValueBoolean (int recval_id, bool val, double validTime);
-#endif /* RTS2_HAVE_PGSQL */
 };
 
 
@@ -147,13 +275,34 @@ class ValueChangeEmail: public ValueChange, public EmailAction
 class ValueCommands:public std::list <ValueChange *>
 {
 	public:
-		ValueCommands () {}
+		// device names in events file are case insensitive
+		ValueCommands ():index (false) {}
 
 		~ValueCommands ()
 		{
 			for (ValueCommands::iterator iter = begin (); iter != end (); iter++)
 				delete (*iter);
 		}
+
+		/**
+		 * Add command, index it by its device and value name.
+		 */
+		void addCommand (ValueChange *vc)
+		{
+			push_back (vc);
+			index.subscribe (vc->getDeviceName (), vc->getValueName (), vc);
+		}
+
+		void clear ()
+		{
+			std::list <ValueChange *>::clear ();
+			index.clear ();
+		}
+
+		/**
+		 * Commands indexed by device and value.
+		 */
+		rts2json::SubscriptionIndex <ValueChange *> index;
 };
 
 }
@@ -44,8 +44,6 @@ Magick::Image* ValuePlot::getPlot (double _from, double _to, Magick::Image* _ima
 	to = _to;
 	plotType = _plotType;
 
-	rs.load (from, to);
-
 	if (_image)
 	{
 		image = _image;
@@ -57,6 +55,10 @@ Magick::Image* ValuePlot::getPlot (double _from, double _to, Magick::Image* _ima
 
 		image = new Magick::Image (size, "white");
 	}
+
+	// single bucket per pixel is enough, so plot cost does not depend on number of recorded values
+	rs.load (from, to, size.width () - y_axis_width);
+
 	image->strokeColor ("black");
 	image->strokeWidth (1);
 
@@ -147,6 +149,10 @@ void ValuePlot::plotData (rts2db::RecordsSet &rs, Magick::Color col, int linewid
 
 	for (; iter != rs.end (); )
 	{
+		// draw range of values in the bucket
+		if (rs.isBucketed () && iter->getMaximum () > iter->getMinimum ())
+			image->draw (Magick::DrawableLine (x, size.height () - x_axis_height - scaleY * (iter->getMinimum () - min) + shadow, x, size.height () - x_axis_height - scaleY * (iter->getMaximum () - min) + shadow));
+
 		iter++;
 
 		double x_end;
@@ -25,12 +25,18 @@
 #include <math.h>
 #include <postgres.h>
 #include <fmgr.h>
+#include <catalog/pg_type.h>
+#include <utils/array.h>
+
+#include "skypixel.h"
 #ifdef PG_MODULE_MAGIC
 PG_MODULE_MAGIC;
 #endif
 
 PG_FUNCTION_INFO_V1 (ln_angular_separation);
 PG_FUNCTION_INFO_V1 (ln_airmass);
+PG_FUNCTION_INFO_V1 (ln_sky_pixel);
+PG_FUNCTION_INFO_V1 (ln_sky_pixels);
 
 Datum
 ln_angular_separation (PG_FUNCTION_ARGS)
@@ -69,3 +75,59 @@ ln_airmass (PG_FUNCTION_ARGS)
 
   PG_RETURN_FLOAT4 (ln_get_airmass (hrz.alt, 750));
 }
+
+/*!
+ * Returns sky pixel containing given position.
+ *
+ * @pg_arg	ra [float8]
+ * @pg_arg	dec [float8]
+ *
+ * @pg_ret [int4] pixel number
+ */
+Datum
+ln_sky_pixel (PG_FUNCTION_ARGS)
+{
+  if (PG_ARGISNULL (0) || PG_ARGISNULL (1))
+    PG_RETURN_NULL ();
+
+  PG_RETURN_INT32 (skypix_pixel (PG_GETARG_FLOAT8 (0), PG_GETARG_FLOAT8 (1)));
+}
+
+/*!
+ * Returns array of sky pixels covering cone.
+ *
+ * @pg_arg	ra [float8]
+ * @pg_arg	dec [float8]
+ * @pg_arg	radius [float8] cone radius in degrees
+ *
+ * @pg_ret [int4[]] pixel numbers
+ */
+Datum
+ln_sky_pixels (PG_FUNCTION_ARGS)
+{
+  double ra, dec, radius;
+  int *pix;
+  Datum *elems;
+  int i, n;
+  ArrayType *res;
+
+  if (PG_ARGISNULL (0) || PG_ARGISNULL (1) || PG_ARGISNULL (2))
+    PG_RETURN_NULL ();
+
+  ra = PG_GETARG_FLOAT8 (0);
+  dec = PG_GETARG_FLOAT8 (1);
+  radius = PG_GETARG_FLOAT8 (2);
+
+  n = skypix_cone (ra, dec, radius, NULL);
+  pix = (int *) palloc (n * sizeof (int));
+  elems = (Datum *) palloc (n * sizeof (Datum));
+  skypix_cone (ra, dec, radius, pix);
+  for (i = 0; i < n; i++)
+    elems[i] = Int32GetDatum (pix[i]);
+
+  res = construct_array (elems, n, INT4OID, sizeof (int32), true, 'i');
+
+  pfree (pix);
+  pfree (elems);
+  PG_RETURN_ARRAYTYPE_P (res);
+}
@@ -39,6 +39,11 @@ PG_MODULE_MAGIC;
 
 #include <rts2-config.h>
 
+#include <catalog/pg_type.h>
+#include <utils/array.h>
+
+#include "skypixel.h"
+
 struct kwcs2
 {
   int naxis1;			/* Number of pixels along x-axis */
@@ -82,6 +87,8 @@ PG_FUNCTION_INFO_V1 (img_wcs2_equinox);
 // center RA and DEC
 PG_FUNCTION_INFO_V1 (img_wcs2_center_ra);
 PG_FUNCTION_INFO_V1 (img_wcs2_center_dec);
+// sky pixels covered by image
+PG_FUNCTION_INFO_V1 (img_wcs2_pixels);
 
 // helper
 char *
@@ -499,3 +506,60 @@ img_wcs2_center_dec (PG_FUNCTION_ARGS)
   arg = PG_GETARG_KWCS2_P (0);
   PG_RETURN_FLOAT8 (arg->crval2);
 }
+
+/*!
+ * Returns sky pixels covered by image. The footprint is approximated by the
+ * circle around image center, passing through the most distant corner.
+ *
+ * @pg_arg	wcs [kwcs2]
+ *
+ * @pg_ret [int4[]] pixel numbers
+ */
+Datum
+img_wcs2_pixels (PG_FUNCTION_ARGS)
+{
+  struct kwcs2 *arg;
+  double ra, dec, c_ra, c_dec, radius, r;
+  int *pix;
+  Datum *elems;
+  int i, n;
+  ArrayType *res;
+
+  if (PG_ARGISNULL (0))
+    PG_RETURN_NULL ();
+
+  arg = PG_GETARG_KWCS2_P (0);
+
+  RTS2pix2wcs (arg, arg->naxis1 / 2.0, arg->naxis2 / 2.0, &c_ra, &c_dec);
+
+  radius = 0;
+  RTS2pix2wcs (arg, 0, 0, &ra, &dec);
+  r = skypix_separation (c_ra, c_dec, ra, dec);
+  if (r > radius)
+    radius = r;
+  RTS2pix2wcs (arg, arg->naxis1, 0, &ra, &dec);
+  r = skypix_separation (c_ra, c_dec, ra, dec);
+  if (r > radius)
+    radius = r;
+  RTS2pix2wcs (arg, 0, arg->naxis2, &ra, &dec);
+  r = skypix_separation (c_ra, c_dec, ra, dec);
+  if (r > radius)
+    radius = r;
+  RTS2pix2wcs (arg, arg->naxis1, arg->naxis2, &ra, &dec);
+  r = skypix_separation (c_ra, c_dec, ra, dec);
+  if (r > radius)
+    radius = r;
+
+  n = skypix_cone (c_ra, c_dec, radius, NULL);
+  pix = (int *) palloc (n * sizeof (int));
+  elems = (Datum *) palloc (n * sizeof (Datum));
+  skypix_cone (c_ra, c_dec, radius, pix);
+  for (i = 0; i < n; i++)
+    elems[i] = Int32GetDatum (pix[i]);
+
+  res = construct_array (elems, n, INT4OID, sizeof (int32), true, 'i');
+
+  pfree (pix);
+  pfree (elems);
+  PG_RETURN_ARRAYTYPE_P (res);
+}
@@ -24,9 +24,11 @@
 #include "rts2db/plan.h"
 #include "rts2db/target.h"
 #include "rts2db/targetgrb.h"
+#include "rts2fits/fitswriter.h"
 #include "rts2script/executorque.h"
 #include "rts2script/execcli.h"
 #include "rts2script/execclidb.h"
+#include "rts2script/scriptcache.h"
 #include "rts2devcliphot.h"
 
 #define OPT_IGNORE_DAY    OPT_LOCAL + 100
@@ -124,6 +126,12 @@ class Executor:public rts2db::DeviceDb
 
 		rts2core::ValueBool *next_night;
 
+		// images written by FitsWriter
+		rts2core::ValueInteger *writeQueue;
+		rts2core::ValueLong *writePending;
+		rts2core::ValueLong *writeOverflows;
+		rts2core::ValueLong *writeFailed;
+
 		int setNow (rts2db::Target * newTarget, int plan_id);
 
 		void processTarget (rts2db::Target * in_target);
@@ -188,6 +196,18 @@ Executor::Executor (int in_argc, char **in_argv):rts2db::DeviceDb (in_argc, in_a
 	createValue (next_night, "next_night", "true if next target is the first target in given night");
 	next_night->setValueBool (false);
 
+	createValue (writeQueue, "write_queue", "number of images being written to disk", false);
+	writeQueue->setValueInteger (0);
+
+	createValue (writePending, "write_pending", "[bytes] image data waiting to be written to disk", false);
+	writePending->setValueLong (0);
+
+	createValue (writeOverflows, "write_overflows", "number of images written synchronously, as write queue was full", false);
+	writeOverflows->setValueLong (0);
+
+	createValue (writeFailed, "write_failed", "number of images which failed to be written to disk", false);
+	writeFailed->setValueLong (0);
+
 	createValue (current_id, "current", "ID of current target", false);
 	createValue (current_id_sel, "current_sel", "ID of currently selected target", false);
 	createValue (current_name, "current_name", "name of current target", false);
@@ -296,6 +316,9 @@ int Executor::reloadConfig ()
 	config->getDouble ("grbd", "minsep", f);
 	grb_min_sep->setValueDouble (f);
 
+	// cached script durations depend on readout and telescope speed configuration
+	rts2script::ScriptCache::instance ()->clear ();
+
 	return 0;
 }
 
@@ -489,6 +512,21 @@ void Executor::postEvent (rts2core::Event * event)
 			*((int *) event->getArg ()) =
 				(currentTarget) ? currentTarget->getAcquired () : -2;
 			break;
+		case EVENT_WRITER_QUEUE:
+			{
+				rts2image::FitsWriter *writer = (rts2image::FitsWriter *) event->getArg ();
+				if (writer == NULL)
+					break;
+				writeQueue->setValueInteger (writer->getQueued ());
+				writePending->setValueLong (writer->getBytesPending ());
+				writeOverflows->setValueLong (writer->getOverflows ());
+				writeFailed->setValueLong (writer->getFailed ());
+				sendValueAll (writeQueue);
+				sendValueAll (writePending);
+				sendValueAll (writeOverflows);
+				sendValueAll (writeFailed);
+			}
+			break;
 	}
 	rts2db::DeviceDb::postEvent (event);
 }
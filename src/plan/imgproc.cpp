@@ -18,6 +18,8 @@
  */
 
 #include "status.h"
+#include "valuearray.h"
+#include "valuestat.h"
 #include "rts2script/connimgprocess.h"
 #include "rts2script/script.h"
 
@@ -28,6 +30,8 @@
 #include <unistd.h>
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 
 #ifdef RTS2_HAVE_PGSQL
 #include "rts2db/devicedb.h"
@@ -36,11 +40,44 @@
 #include "configuration.h"
 #endif
 
+// processing priorities, lower number is processed first
+#define PRIORITY_ACQUISITION     0
+#define PRIORITY_SCIENCE         1
+#define PRIORITY_CALIBRATION     2
+#define PRIORITY_REPROCESS       3
+
+// number of processes used to calculate average latency
+#define LATENCY_WINDOW           100
+
 namespace rts2plan
 {
 
 /**
- * Image processor main class.
+ * Process waiting in queue.
+ */
+struct QueEntry
+{
+	ConnProcess *proc;
+	int priority;
+	double queued;
+};
+
+/**
+ * Processing slot. Holds running process.
+ */
+struct ProcessSlot
+{
+	ConnProcess *proc;
+	double queued;
+	double started;
+	int processed;
+};
+
+/**
+ * Image processor main class. Runs up to processes processes at once, taking
+ * them from queue ordered by priority - images of GRBs and images requested
+ * with do_image first, then science images and observations, then darks and
+ * flats, and at the end images found by reprocessing glob.
  *
  * @author Petr Kubanek <petr@kubanek.net>
  */
@@ -63,9 +100,17 @@ class ImageProc:public rts2core::Device
 
 		virtual int deleteConnection (rts2core::Connection * conn);
 
-		int que (ConnProcess * newProc);
+		/**
+		 * Put process to the queue.
+		 *
+		 * @param newProc   process
+		 * @param priority  process priority (PRIORITY_ACQUISITION,..)
+		 * @param first     if true, put process in front of processes with the same priority
+		 */
+		int que (ConnProcess * newProc, int priority, bool first = false);
 
 		int queImage (const char *_path);
+		int queImage (const char *_path, int priority);
 		int doImage (const char *_path);
 
 		int queDark (const char *_path);
@@ -77,12 +122,12 @@ class ImageProc:public rts2core::Device
 		int queFlats ();
 
 		int checkNotProcessed ();
-		void changeRunning (ConnProcess * newImage);
 
 		virtual int commandAuthorized (rts2core::Connection * conn);
 
 	protected:
 		virtual int reloadConfig ();
+		virtual int setValue (rts2core::Value * old_value, rts2core::Value * new_value);
 #ifndef RTS2_HAVE_PGSQL
 		virtual int processOption (int opt);
 		virtual int init ();
@@ -96,11 +141,23 @@ class ImageProc:public rts2core::Device
 #ifndef RTS2_HAVE_PGSQL
 		const char *configFile;
 #endif
-		std::list < ConnProcess * >imagesQue;
-		ConnProcess *runningImage;
+		std::list < QueEntry >imagesQue;
+		std::vector < ProcessSlot >slots;
+
+		// end times of processes finished during last hour
+		std::deque < double >finishTimes;
 
 		rts2core::ValueString *image_glob;
 
+		rts2core::ValueInteger *maxProcesses;
+		rts2core::ValueInteger *runningProcesses;
+		rts2core::StringArray *slotImages;
+		rts2core::IntegerArray *slotProcessed;
+
+		rts2core::ValueDouble *throughput;
+		rts2core::ValueDoubleStat *latency;
+		rts2core::ValueInteger *timeouts;
+
 		rts2core::ValueBool *applyCorrections;
 		rts2core::ValueInteger *astrometryTimeout;
 
@@ -128,8 +185,6 @@ class ImageProc:public rts2core::Device
 		rts2core::ValueInteger *nightDarks;
 		rts2core::ValueInteger *nightFlats;
 
-		int sendStop;			 // if stop running astrometry with stop signal; it ussually doesn't work, so we will use FIFO
-
 		std::string defaultImgProcess;
 		std::string defaultObsProcess;
 		glob_t imageGlob;
@@ -139,6 +194,47 @@ class ImageProc:public rts2core::Device
 		const char *last_processed_jpeg;
 		const char *last_good_jpeg;
 		const char *last_trash_jpeg;
+
+#ifdef RTS2_HAVE_LIBJPEG
+		// previews of processed images are stored there
+		rts2core::ThumbnailCache *thumbnailCache;
+		// false if cache was disabled by configuration reload
+		bool thumbnailCacheEnabled;
+		int thumbnailSize;
+		const char *thumbnailLabel;
+		int thumbnailChannel;
+#endif
+
+		/**
+		 * Returns priority of the image, based on its target and image type.
+		 */
+		int imagePriority (const char *_path);
+
+		/**
+		 * Start queued processes in free slots.
+		 */
+		void startQueued ();
+
+		/**
+		 * Returns index of free slot, -1 if all slots are used.
+		 */
+		int freeSlot ();
+
+		int getRunning ();
+
+		void startProcess (int slot, QueEntry &entry);
+
+		/**
+		 * Update statistics with result of the finished process.
+		 */
+		void processFinished (ProcessSlot &slot);
+
+		/**
+		 * Queue images from reprocessing glob, so free slots are used.
+		 */
+		void queGlob ();
+
+		void updateQueueValues ();
 };
 
 };
@@ -152,10 +248,16 @@ ImageProc::ImageProc (int _argc, char **_argv)
 :rts2core::Device (_argc, _argv, DEVICE_TYPE_IMGPROC, "IMGP")
 #endif
 {
-	runningImage = NULL;
-
 	last_processed_jpeg = last_good_jpeg = last_trash_jpeg = NULL;
 
+#ifdef RTS2_HAVE_LIBJPEG
+	thumbnailCache = NULL;
+	thumbnailCacheEnabled = false;
+	thumbnailSize = 128;
+	thumbnailLabel = NULL;
+	thumbnailChannel = 0;
+#endif
+
 	createValue (applyCorrections, "apply_corrections", "apply corrections from astrometry", false, RTS2_VALUE_WRITABLE);
 	applyCorrections->setValueBool (true);
 
@@ -181,6 +283,24 @@ ImageProc::ImageProc (int _argc, char **_argv)
 	createValue (queSize, "queue_size", "number of images waiting for processing", false);
 	queSize->setValueInteger (0);
 
+	createValue (maxProcesses, "processes", "maximal number of processes running at once", false, RTS2_VALUE_WRITABLE | RTS2_VALUE_AUTOSAVE);
+	long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+	maxProcesses->setValueInteger (cpus > 0 ? cpus : 1);
+
+	createValue (runningProcesses, "running", "number of running processes", false);
+	runningProcesses->setValueInteger (0);
+
+	createValue (slotImages, "slot_images", "images processed in processing slots", false);
+	createValue (slotProcessed, "slot_processed", "number of processes finished in processing slots", false);
+
+	createValue (throughput, "throughput", "number of processes finished during last hour", false);
+	throughput->setValueDouble (0);
+
+	createValue (latency, "latency", "[s] time from queuing to end of processing", false, RTS2_DT_TIMEINTERVAL);
+
+	createValue (timeouts, "timeouts", "number of processes which reached timeout", false);
+	timeouts->setValueInteger (0);
+
 	createValue (lastRaDec, "last_radec", "last correct image coordinates", false);
 	createValue (lastCorrections, "last_corrections", "size of last corrections", false, RTS2_DT_DEG_DIST);
 
@@ -202,8 +322,6 @@ ImageProc::ImageProc (int _argc, char **_argv)
 	globC = 0;
 	reprocessingPossible = 0;
 
-	sendStop = 0;
-
 #ifndef RTS2_HAVE_PGSQL
 	configFile = NULL;
 	addOption (OPT_CONFIG, "config", 1, "configuration file");
@@ -218,6 +336,9 @@ ImageProc::~ImageProc (void)
 {
 	if (imageGlob.gl_pathc)
 		globfree (&imageGlob);
+#ifdef RTS2_HAVE_LIBJPEG
+	delete thumbnailCache;
+#endif
 }
 
 int ImageProc::reloadConfig ()
@@ -257,11 +378,55 @@ int ImageProc::reloadConfig ()
 	last_good_jpeg = config->getStringDefault ("imgproc", "last_good_jpeg", NULL);
 	last_trash_jpeg = config->getStringDefault ("imgproc", "last_trash_jpeg", NULL);
 
+#ifdef RTS2_HAVE_LIBJPEG
+	// pre-generate previews for rts2-httpd, which shares the cache directory
+	thumbnailCacheEnabled = false;
+	const char *thumbDir = config->getStringDefault ("imgproc", "thumbnail_cache", NULL);
+	if (thumbDir != NULL)
+	{
+		size_t thumbBudget = (size_t) config->getIntegerDefault ("imgproc", "thumbnail_cache_size", 256) * 1024 * 1024;
+		int tret;
+		if (thumbnailCache == NULL)
+		{
+			thumbnailCache = new rts2core::ThumbnailCache (thumbDir, thumbBudget);
+			tret = thumbnailCache->init ();
+		}
+		else
+		{
+			// running processes hold pointer to the cache, so it is reconfigured instead of recreated
+			thumbnailCache->setBudget (thumbBudget);
+			tret = thumbnailCache->setDirectory (thumbDir);
+		}
+		if (tret)
+			logStream (MESSAGE_ERROR) << "cannot initialize thumbnail cache in " << thumbDir << ": " << strerror (errno) << sendLog;
+		else
+			thumbnailCacheEnabled = true;
+		thumbnailSize = config->getIntegerDefault ("imgproc", "thumbnail_size", 128);
+		thumbnailLabel = config->getStringDefault ("imgproc", "thumbnail_label", "%Y-%m-%d %H:%M:%S @OBJECT");
+		thumbnailChannel = config->getIntegerDefault ("imgproc", "thumbnail_channel", 0);
+	}
+#endif
+
 	astrometryTimeout->setValueInteger (config->getAstrometryTimeout ());
 
+	int processes = config->getIntegerDefault ("imgproc", "processes", -1);
+	if (processes > 0)
+		maxProcesses->setValueInteger (processes);
+
 	return ret;
 }
 
+int ImageProc::setValue (rts2core::Value * old_value, rts2core::Value * new_value)
+{
+	if (old_value == maxProcesses)
+		return new_value->getValueInteger () > 0 ? 0 : -2;
+#ifdef RTS2_HAVE_PGSQL
+	return rts2db::DeviceDb::setValue (old_value, new_value);
+#else
+	return rts2core::Device::setValue (old_value, new_value);
+#endif
+}
+
 #ifndef RTS2_HAVE_PGSQL
 int ImageProc::processOption (int opt)
 {
@@ -305,13 +470,11 @@ void ImageProc::postEvent (rts2core::Event * event)
 
 int ImageProc::idle ()
 {
-	std::list < ConnProcess * >::iterator img_iter;
-	if (!runningImage && imagesQue.size () != 0)
+	// number of processes could be changed
+	if (!imagesQue.empty () && freeSlot () >= 0)
 	{
-		img_iter = imagesQue.begin ();
-		ConnProcess *newImage = *img_iter;
-		imagesQue.erase (img_iter);
-		changeRunning (newImage);
+		startQueued ();
+		infoAll ();
 	}
 #ifdef RTS2_HAVE_PGSQL
 	return rts2db::DeviceDb::idle ();
@@ -322,8 +485,7 @@ int ImageProc::idle ()
 
 int ImageProc::info ()
 {
-	queSize->setValueInteger ((int) imagesQue.size () + (runningImage ? 1 : 0));
-	sendValueAll (queSize);
+	updateQueueValues ();
 #ifdef RTS2_HAVE_PGSQL
 	return rts2db::DeviceDb::info ();
 #else
@@ -364,7 +526,7 @@ void ImageProc::changeMasterState (rts2_status_t old_state, rts2_status_t new_st
 			if (strlen (image_glob->getValue ()))
 			{
 				reprocessingPossible = 1;
-				if (!runningImage && imagesQue.size () == 0)
+				if (getRunning () == 0 && imagesQue.empty ())
 					checkNotProcessed ();
 			}
 	}
@@ -378,11 +540,11 @@ void ImageProc::changeMasterState (rts2_status_t old_state, rts2_status_t new_st
 
 int ImageProc::deleteConnection (rts2core::Connection * conn)
 {
-	std::list < ConnProcess * >::iterator img_iter;
+	std::list < QueEntry >::iterator img_iter;
 	for (img_iter = imagesQue.begin (); img_iter != imagesQue.end ();)
 	{
-		(*img_iter)->deleteConnection (conn);
-		if (*img_iter == conn)
+		img_iter->proc->deleteConnection (conn);
+		if (img_iter->proc == conn)
 		{
 			img_iter = imagesQue.erase (img_iter);
 		}
@@ -391,98 +553,31 @@ int ImageProc::deleteConnection (rts2core::Connection * conn)
 			img_iter++;
 		}
 	}
-	queSize->setValueInteger (imagesQue.size ());
-	sendValueAll (queSize);
-	if (runningImage)
-		runningImage->deleteConnection (conn);
-	if (conn == runningImage)
+	bool finished = false;
+	for (std::vector < ProcessSlot >::iterator slot = slots.begin (); slot != slots.end (); slot++)
 	{
-		// que next image
-		// rts2core::Device::deleteConnection will delete runningImage
-		switch (runningImage->getAstrometryStat ())
-		{
-			case NOT_ASTROMETRY:
-				break;	
-			case GET:
-				goodImages->inc ();
-				nightGoodImages->inc ();
-				lastRaDec->setValueRaDec (((ConnImgOnlyProcess *) runningImage)->getRa (), ((ConnImgOnlyProcess *) runningImage)->getDec ());
-				lastCorrections->setValueRaDec (((ConnImgOnlyProcess *) runningImage)->getRaErr (), ((ConnImgOnlyProcess *) runningImage)->getDecErr ());
-				sendValueAll (goodImages);
-				sendValueAll (nightGoodImages);
-				sendValueAll (lastRaDec);
-				sendValueAll (lastCorrections);
-				if (isnan (lastGood->getValueDouble ()) || runningImage->getExposureEnd () > lastGood->getValueDouble ())
-				{
-					lastGood->setValueDouble (runningImage->getExposureEnd ());
-					sendValueAll (lastGood);
-				}
-				break;
-			case TRASH:
-				trashImages->inc ();
-				nightTrashImages->inc ();
-				sendValueAll (trashImages);
-				sendValueAll (nightTrashImages);
-				if (isnan (lastTrash->getValueDouble ()) || runningImage->getExposureEnd () > lastTrash->getValueDouble ())
-				{
-					lastTrash->setValueDouble (runningImage->getExposureEnd ());
-					sendValueAll (lastTrash);
-				}
-				break;
-			case BAD:
-				badImages->inc ();
-				nightBadImages->inc ();
-				sendValueAll (badImages);
-				sendValueAll (nightBadImages);
-				lastBad->setValueDouble (getNow ());
-				sendValueAll (lastBad);
-				break;
-			case FLAT:
-				flatImages->inc ();
-				nightFlats->inc ();
-				sendValueAll (flatImages);
-				sendValueAll (nightFlats);
-				break;
-			case DARK:
-				darkImages->inc ();
-				nightDarks->inc ();
-				sendValueAll (darkImages);
-				sendValueAll (nightDarks);
-				break;
-			default:
-				logStream (MESSAGE_ERROR) << "wrong image state: " << runningImage->getAstrometryStat () << sendLog;
-				break;
-		}
-		runningImage = NULL;
-		img_iter = imagesQue.begin ();
-		if (img_iter != imagesQue.end ())
+		if (slot->proc == NULL)
+			continue;
+		slot->proc->deleteConnection (conn);
+		if (conn == slot->proc)
 		{
-			ConnProcess *cp = *img_iter;
-			imagesQue.erase (img_iter);
-			changeRunning (cp);
+			// rts2core::Device::deleteConnection will delete the process
+			processFinished (*slot);
+			slot->proc = NULL;
+			finished = true;
 		}
+	}
+	if (finished)
+	{
+		// que next image
+		startQueued ();
+		if (reprocessingPossible && imagesQue.empty ())
+			queGlob ();
 		// still not image process running..
-		if (runningImage == NULL)
-		{
+		if (getRunning () == 0)
 			maskState (DEVICE_ERROR_MASK | IMGPROC_MASK_RUN, IMGPROC_IDLE);
-			if (reprocessingPossible)
-			{
-				if (imageGlob.gl_pathc > 0)
-				{
-					globC++;
-					if (globC < imageGlob.gl_pathc)
-					{
-						queImage (imageGlob.gl_pathv[globC]);
-					}
-					else
-					{
-						globfree (&imageGlob);
-						imageGlob.gl_pathc = 0;
-					}
-				}
-			}
-		}
 	}
+	updateQueueValues ();
 #ifdef RTS2_HAVE_PGSQL
 	return rts2db::DeviceDb::deleteConnection (conn);
 #else
@@ -490,82 +585,275 @@ int ImageProc::deleteConnection (rts2core::Connection * conn)
 #endif
 }
 
-void ImageProc::changeRunning (ConnProcess * newImage)
+int ImageProc::imagePriority (const char *_path)
 {
-	int ret;
-	if (runningImage)
+	try
 	{
-		if (sendStop)
+		rts2image::Image image;
+		image.openFile (_path, true, false);
+		switch (image.getTargetType ())
 		{
-			runningImage->stop ();
-			imagesQue.push_front (runningImage);
+			case TYPE_GRB:
+			case TYPE_GRB_TEST:
+				return PRIORITY_ACQUISITION;
+			case TYPE_DARK:
+			case TYPE_FLAT:
+				return PRIORITY_CALIBRATION;
 		}
-		else
+		if (image.getShutter () == rts2image::SHUT_CLOSED)
+			return PRIORITY_CALIBRATION;
+		switch (image.getImageType ())
 		{
-			imagesQue.push_front (newImage);
-			infoAll ();
-			return;
+			case rts2image::IMGTYPE_DARK:
+			case rts2image::IMGTYPE_FLAT:
+			case rts2image::IMGTYPE_ZERO:
+				return PRIORITY_CALIBRATION;
+			default:
+				break;
 		}
 	}
-	runningImage = newImage;
-        runningImage->setConnectionDebug (getDebug ());
-	ret = runningImage->init ();
+	catch (rts2core::Error &er)
+	{
+		// image will be removed when processing starts
+	}
+	return PRIORITY_SCIENCE;
+}
+
+void ImageProc::startQueued ()
+{
+	int slot;
+	while (!imagesQue.empty () && (slot = freeSlot ()) >= 0)
+	{
+		QueEntry entry = imagesQue.front ();
+		imagesQue.pop_front ();
+		startProcess (slot, entry);
+	}
+	// remove unused slots above current limit
+	while (slots.size () > (size_t) maxProcesses->getValueInteger () && slots.back ().proc == NULL)
+		slots.pop_back ();
+}
+
+int ImageProc::freeSlot ()
+{
+	size_t max = maxProcesses->getValueInteger ();
+	for (size_t i = 0; i < slots.size () && i < max; i++)
+	{
+		if (slots[i].proc == NULL)
+			return i;
+	}
+	if (slots.size () < max)
+	{
+		ProcessSlot slot;
+		slot.proc = NULL;
+		slot.queued = slot.started = NAN;
+		slot.processed = 0;
+		slots.push_back (slot);
+		return slots.size () - 1;
+	}
+	return -1;
+}
+
+int ImageProc::getRunning ()
+{
+	int ret = 0;
+	for (std::vector < ProcessSlot >::iterator slot = slots.begin (); slot != slots.end (); slot++)
+	{
+		if (slot->proc)
+			ret++;
+	}
+	return ret;
+}
+
+void ImageProc::startProcess (int slot, QueEntry &entry)
+{
+	int ret;
+	ConnProcess *newImage = entry.proc;
+	slots[slot].proc = newImage;
+	slots[slot].queued = entry.queued;
+	// timeout of the process is counted from its start, not from its queuing
+	slots[slot].started = getNow ();
+	newImage->setConnectionDebug (getDebug ());
+	ret = newImage->init ();
 	if (ret < 0)
 	{
-		deleteConnection (runningImage);
-		runningImage = NULL;
-		maskState (DEVICE_ERROR_MASK | IMGPROC_MASK_RUN, DEVICE_ERROR_HW | IMGPROC_IDLE);
-		infoAll ();
-		if (reprocessingPossible)
-			checkNotProcessed ();
+		processFinished (slots[slot]);
+		slots[slot].proc = NULL;
+		delete newImage;
+		maskState (DEVICE_ERROR_MASK | IMGPROC_MASK_RUN, DEVICE_ERROR_HW | (getRunning () > 0 ? IMGPROC_RUN : IMGPROC_IDLE));
 		return;
 	}
 	else if (ret == 0)
 	{
 #ifdef RTS2_HAVE_LIBJPEG
-		if (isnan (lastGood->getValueDouble ()) || lastGood->getValueDouble () < runningImage->getExposureEnd ())
-			runningImage->setLastGoodJpeg (last_good_jpeg);
-		if (isnan (lastGood->getValueDouble ()) || lastTrash->getValueDouble() < runningImage->getExposureEnd ())
-			runningImage->setLastTrashJpeg (last_trash_jpeg);
+		if (isnan (lastGood->getValueDouble ()) || lastGood->getValueDouble () < newImage->getExposureEnd ())
+			newImage->setLastGoodJpeg (last_good_jpeg);
+		if (isnan (lastGood->getValueDouble ()) || lastTrash->getValueDouble() < newImage->getExposureEnd ())
+			newImage->setLastTrashJpeg (last_trash_jpeg);
+		newImage->setThumbnailCache (thumbnailCacheEnabled ? thumbnailCache : NULL, thumbnailSize, thumbnailLabel, thumbnailChannel);
 #endif
-		addConnection (runningImage);
-		processedImage->setValueCharArr (runningImage->getProcessArguments ());
+		addConnection (newImage);
+		processedImage->setValueCharArr (newImage->getProcessArguments ());
 	}
 	maskState (DEVICE_ERROR_MASK | IMGPROC_MASK_RUN, IMGPROC_RUN);
-	infoAll ();
 }
 
-int ImageProc::que (ConnProcess * newProc)
+void ImageProc::processFinished (ProcessSlot &slot)
 {
-	if (runningImage)
-		imagesQue.push_front (newProc);
-	else
-		changeRunning (newProc);
+	ConnProcess *proc = slot.proc;
+	switch (proc->getAstrometryStat ())
+	{
+		case NOT_ASTROMETRY:
+			break;	
+		case GET:
+			goodImages->inc ();
+			nightGoodImages->inc ();
+			lastRaDec->setValueRaDec (((ConnImgOnlyProcess *) proc)->getRa (), ((ConnImgOnlyProcess *) proc)->getDec ());
+			lastCorrections->setValueRaDec (((ConnImgOnlyProcess *) proc)->getRaErr (), ((ConnImgOnlyProcess *) proc)->getDecErr ());
+			sendValueAll (goodImages);
+			sendValueAll (nightGoodImages);
+			sendValueAll (lastRaDec);
+			sendValueAll (lastCorrections);
+			if (isnan (lastGood->getValueDouble ()) || proc->getExposureEnd () > lastGood->getValueDouble ())
+			{
+				lastGood->setValueDouble (proc->getExposureEnd ());
+				sendValueAll (lastGood);
+			}
+			break;
+		case TRASH:
+			trashImages->inc ();
+			nightTrashImages->inc ();
+			sendValueAll (trashImages);
+			sendValueAll (nightTrashImages);
+			if (isnan (lastTrash->getValueDouble ()) || proc->getExposureEnd () > lastTrash->getValueDouble ())
+			{
+				lastTrash->setValueDouble (proc->getExposureEnd ());
+				sendValueAll (lastTrash);
+			}
+			break;
+		case BAD:
+			badImages->inc ();
+			nightBadImages->inc ();
+			sendValueAll (badImages);
+			sendValueAll (nightBadImages);
+			lastBad->setValueDouble (getNow ());
+			sendValueAll (lastBad);
+			break;
+		case FLAT:
+			flatImages->inc ();
+			nightFlats->inc ();
+			sendValueAll (flatImages);
+			sendValueAll (nightFlats);
+			break;
+		case DARK:
+			darkImages->inc ();
+			nightDarks->inc ();
+			sendValueAll (darkImages);
+			sendValueAll (nightDarks);
+			break;
+		default:
+			logStream (MESSAGE_ERROR) << "wrong image state: " << proc->getAstrometryStat () << sendLog;
+			break;
+	}
+
+	double now = getNow ();
+	slot.processed++;
+
+	if (astrometryTimeout->getValueInteger () > 0 && now - slot.started >= astrometryTimeout->getValueInteger ())
+	{
+		timeouts->inc ();
+		sendValueAll (timeouts);
+	}
+
+	latency->addValue (now - slot.queued, LATENCY_WINDOW);
+	latency->calculate ();
+	sendValueAll (latency);
+
+	finishTimes.push_back (now);
+	while (!finishTimes.empty () && finishTimes.front () < now - 3600)
+		finishTimes.pop_front ();
+	throughput->setValueDouble (finishTimes.size ());
+	sendValueAll (throughput);
+}
+
+void ImageProc::queGlob ()
+{
+	// fill free slots with images which were not processed
+	while (imageGlob.gl_pathc > 0 && imagesQue.empty () && freeSlot () >= 0)
+	{
+		if (globC >= imageGlob.gl_pathc)
+		{
+			globfree (&imageGlob);
+			imageGlob.gl_pathc = 0;
+			break;
+		}
+		queImage (imageGlob.gl_pathv[globC++], PRIORITY_REPROCESS);
+	}
+}
+
+void ImageProc::updateQueueValues ()
+{
+	int running = getRunning ();
+	queSize->setValueInteger ((int) imagesQue.size () + running);
+	runningProcesses->setValueInteger (running);
+
+	std::vector <std::string> images;
+	std::vector <int> processed;
+	for (std::vector < ProcessSlot >::iterator slot = slots.begin (); slot != slots.end (); slot++)
+	{
+		images.push_back (slot->proc ? slot->proc->getProcessArguments () : "");
+		processed.push_back (slot->processed);
+	}
+	slotImages->setValueArray (images);
+	slotProcessed->setValueArray (processed);
+
+	sendValueAll (queSize);
+	sendValueAll (runningProcesses);
+	sendValueAll (slotImages);
+	sendValueAll (slotProcessed);
+}
+
+int ImageProc::que (ConnProcess * newProc, int priority, bool first)
+{
+	QueEntry entry;
+	entry.proc = newProc;
+	entry.priority = priority;
+	entry.queued = getNow ();
+
+	// FIFO inside the same priority, unless requested otherwise
+	std::list < QueEntry >::iterator iter = imagesQue.begin ();
+	while (iter != imagesQue.end () && (first ? iter->priority < priority : iter->priority <= priority))
+		iter++;
+	imagesQue.insert (iter, entry);
+
+	startQueued ();
 	infoAll ();
 	return 0;
 }
 
 int ImageProc::queImage (const char *_path)
+{
+	return queImage (_path, imagePriority (_path));
+}
+
+int ImageProc::queImage (const char *_path, int priority)
 {
 	ConnImgProcess *newImageConn;
 	newImageConn = new ConnImgProcess (this, defaultImgProcess.c_str (), _path, astrometryTimeout->getValueInteger ());
-	return que (newImageConn);
+	return que (newImageConn, priority);
 }
 
 int ImageProc::doImage (const char *_path)
 {
 	ConnImgProcess *newImageConn;
 	newImageConn = new ConnImgProcess (this, defaultImgProcess.c_str (), _path, astrometryTimeout->getValueInteger ());
-	changeRunning (newImageConn);
-	infoAll ();
-	return 0;
+	return que (newImageConn, PRIORITY_ACQUISITION, true);
 }
 
 int ImageProc::queObs (int obsId)
 {
 	ConnObsProcess *newObsConn;
 	newObsConn = new ConnObsProcess (this, defaultObsProcess.c_str (), obsId, astrometryTimeout->getValueInteger ());
-	return que (newObsConn);
+	return que (newObsConn, PRIORITY_SCIENCE);
 }
 
 int ImageProc::checkNotProcessed ()
@@ -583,8 +871,7 @@ int ImageProc::checkNotProcessed ()
 	globC = 0;
 
 	// start files que..
-	if (imageGlob.gl_pathc > 0)
-		return queImage (imageGlob.gl_pathv[0]);
+	queGlob ();
 	return 0;
 }
 
@@ -608,7 +895,7 @@ int ImageProc::commandAuthorized (rts2core::Connection * conn)
 		while (!conn->paramNextString (&in_imageName))
 			newConn->addArg (in_imageName);
 
-		return que (newConn);
+		return que (newConn, PRIORITY_SCIENCE);
 	}
 	else if (conn->isCommand ("do_image"))
 	{
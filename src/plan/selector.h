@@ -147,7 +147,7 @@ class Selector
 
 	private:
 		std::vector < TargetEntry* > possibleTargets;
-		void considerTarget (int consider_tar_id, double JD);
+		void considerTarget (const rts2db::TargetRow &row, double JD);
 		std::vector <char> nightDisabledTypes;
 		void checkTargetObservability ();
 		void checkTargetBonus ();
@@ -23,6 +23,7 @@
 #include "rts2script/connselector.h"
 #include "rts2script/executorque.h"
 #include "rts2script/simulque.h"
+#include "rts2script/scriptcache.h"
 
 #include "connnotify.h"
 #include "devclient.h"
@@ -335,6 +336,9 @@ int SelectorDev::reloadConfig ()
 
 	nightHorizon = devConfig->getDoubleDefault ("observatory", "night_horizon", -10);
 
+	// cached script durations depend on readout and telescope speed configuration
+	rts2script::ScriptCache::instance ()->clear ();
+
 	delete sel;
 
 	sel = new rts2plan::Selector (&cameras);
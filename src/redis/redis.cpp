@@ -17,22 +17,74 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+#include <sstream>
 #include <string>
 #include "redis.h"
 
+// maximal number of commands waiting for reply; changes are coalesced when reached
+#define MAX_OUTSTANDING    10000
+
+// delay between attempts to connect to Redis server, in seconds
+#define RECONNECT_DELAY    5
+
 using namespace std;
 
+static void onRedisConnect (const redisAsyncContext *ac, int status)
+{
+    ((RedisProxy *) ac->data)->redisConnected (status);
+}
+
+static void onRedisDisconnect (const redisAsyncContext *ac, int status)
+{
+    ((RedisProxy *) ac->data)->redisDisconnected (status);
+}
+
+static void onRedisReply (redisAsyncContext *ac, void *reply, void *privdata)
+{
+    ((RedisProxy *) privdata)->redisReplied ((redisReply *) reply);
+}
+
+// hiredis event hooks; file descriptor is polled in addPollSocks, reads are always enabled
+static void onRedisAddWrite (void *privdata)
+{
+    ((RedisProxy *) privdata)->setRedisWrite (true);
+}
+
+static void onRedisDelWrite (void *privdata)
+{
+    ((RedisProxy *) privdata)->setRedisWrite (false);
+}
+
+static void onRedisNoop (void *privdata)
+{
+}
+
 RedisProxy::RedisProxy (int in_argc, char **in_argv):rts2db::DeviceDb (in_argc, in_argv, DEVICE_TYPE_REDIS, "REDIS")
 {
-    redisConn = redisConnect("127.0.0.1", 6379);
-    if (redisConn != NULL && redisConn->err) {
-        logStream (MESSAGE_ERROR) << "Redis connection error: " << redisConn->errstr << sendLog;
-    }
+    notifyConn = NULL;
+    redisConn = NULL;
+    redisReady = false;
+    redisWrite = false;
+    redisReconnect = 0;
+    redisOutstanding = 0;
+
+    createValue (redisCommands, "redis_commands", "number of commands sent to Redis server", false);
+    redisCommands->setValueLong (0);
+    createValue (redisCoalesced, "redis_coalesced", "number of value changes replaced by newer value before they were sent", false);
+    redisCoalesced->setValueLong (0);
+    createValue (redisDropped, "redis_dropped", "number of messages dropped as Redis server was not available", false);
+    redisDropped->setValueLong (0);
 }
 
 RedisProxy::~RedisProxy (void)
 {
-
+    if (redisConn != NULL)
+    {
+        // do not process disconnect callback
+        redisAsyncContext *ac = redisConn;
+        redisConn = NULL;
+        redisAsyncFree (ac);
+    }
 }
 
 int RedisProxy::processOption (int in_opt)
@@ -55,9 +107,40 @@ int RedisProxy::init ()
 
 	addConnection (notifyConn);
 
+	connectRedis ();
+
 	return ret;
 }
 
+int RedisProxy::idle ()
+{
+    if (redisConn == NULL && getNow () >= redisReconnect)
+        connectRedis ();
+    return rts2db::DeviceDb::idle ();
+}
+
+void RedisProxy::addPollSocks ()
+{
+    rts2db::DeviceDb::addPollSocks ();
+    // all changes from this loop iteration were collected
+    flushChanges ();
+    if (redisConn != NULL)
+        addPollFD (redisConn->c.fd, redisWrite ? (POLLIN | POLLPRI | POLLOUT) : (POLLIN | POLLPRI));
+}
+
+void RedisProxy::pollSuccess ()
+{
+    rts2db::DeviceDb::pollSuccess ();
+    if (redisConn == NULL)
+        return;
+    int fd = redisConn->c.fd;
+    if (isForRead (fd) || isHup (fd))
+        redisAsyncHandleRead (redisConn);
+    // context is freed when connection is closed
+    if (redisConn != NULL && isForWrite (fd))
+        redisAsyncHandleWrite (redisConn);
+}
+
 int RedisProxy::reloadConfig ()
 {
 	int ret;
@@ -77,22 +160,31 @@ int RedisProxy::setValue (rts2core::Value *oldValue, rts2core::Value *newValue)
 
 int RedisProxy::deleteConnection (rts2core::Connection * in_conn)
 {
-    redisReply *r, *r2;
-    string connName;
-    if (in_conn == getSingleCentralConn())
-        connName = "centrald";
-    else
-        connName = string(in_conn->getName());
-    r = (redisReply*)redisCommand(redisConn, "SREM rts2:devices %s", connName.c_str());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "KEYS rts2:%s*", connName.c_str());
-    for (size_t i=0; i < r->elements; i++) {
-        r2 = (redisReply*)redisCommand(redisConn, "DEL %s", r->element[i]->str);
-        freeReplyObject(r2);
+    if (in_conn->getOtherDevClient () != NULL)
+    {
+        string connName = getConnName (in_conn);
+        pendingChanges.erase (connName);
+        knownValues.erase (connName);
+
+        vector <string> args;
+        args.push_back ("SREM");
+        args.push_back ("rts2:devices");
+        args.push_back (connName);
+        command (args);
+
+        args.clear ();
+        args.push_back ("DEL");
+        args.push_back ("rts2:" + connName);
+        args.push_back ("rts2:" + connName + ":values");
+        args.push_back ("rts2:" + connName + ":State");
+        command (args);
+
+        args.clear ();
+        args.push_back ("PUBLISH");
+        args.push_back (connName);
+        args.push_back ("disconnect");
+        command (args);
     }
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s disconnect", connName.c_str());
-    freeReplyObject(r);
 	return 0;
 }
 
@@ -122,41 +214,34 @@ int RedisProxy::commandAuthorized (rts2core::Connection * conn)
 
 rts2core::DevClient *RedisProxy::createOtherType (rts2core::Connection *conn, int other_device_type)
 {
-    redisReply *r;
-    string connName(conn->getName());
+    string connName (conn->getName ());
     if (connName == "") connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SADD rts2:devices %s", connName.c_str());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s connect", connName.c_str());
-    freeReplyObject(r);
+
+    vector <string> args;
+    args.push_back ("SADD");
+    args.push_back ("rts2:devices");
+    args.push_back (connName);
+    command (args);
+
+    args.clear ();
+    args.push_back ("PUBLISH");
+    args.push_back (connName);
+    args.push_back ("connect");
+    command (args);
+
     return new RedisProxyClient (conn);
 }
 
 void RedisProxy::stateChangedEvent(rts2core::Connection *conn, rts2core::ServerState *new_state)
 {
-    redisReply *r;
-    string connName(conn->getName());
-    if (conn == getSingleCentralConn())
-        connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SET rts2:%s:State %d", connName.c_str(), new_state->getValue());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s state", connName.c_str());
-    freeReplyObject(r);
+    DeviceChanges &dc = pendingChanges[getConnName (conn)];
+    dc.state = true;
+    dc.stateValue = new_state->getValue ();
 }
 
 void RedisProxy::valueChangedEvent(rts2core::Connection *conn, rts2core::Value *new_value)
 {
-    redisReply *r;
-    string connName(conn->getName());
-    if (conn == getSingleCentralConn())
-        connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SADD rts2:%s:values %s", connName.c_str(), string(new_value->getName()).c_str());
-    freeReplyObject(r);
-    string key = "rts2:" + connName + ":" + new_value->getName();
-    r = (redisReply*)redisCommand(redisConn, "SET %s %s", key.c_str(), new_value->getValue());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s value %s", connName.c_str(), new_value->getName().c_str());
-    freeReplyObject(r);
+    queueValue (getConnName (conn), new_value);
 }
 
 void RedisProxy::message(rts2core::Message &msg)
@@ -168,9 +253,244 @@ void RedisProxy::message(rts2core::Message &msg)
     snprintf(buf, 1000, "%02i:%02i:%02i.%03i %s %s %s", tmesg.tm_hour, tmesg.tm_min, tmesg.tm_sec,
              (int)(msg.getMessageTimeUSec() / 1000), msg.getMessageOName(), msg.getTypeString(), msg.getMessageString().c_str());
 
-    redisReply *r;
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH message %s", buf);
-    freeReplyObject(r);
+    // messages are not coalesced, drop them when Redis is slow
+    if (redisOutstanding > MAX_OUTSTANDING)
+    {
+        redisDropped->inc ();
+        return;
+    }
+
+    vector <string> args;
+    args.push_back ("PUBLISH");
+    args.push_back ("message");
+    args.push_back (buf);
+    command (args);
+}
+
+void RedisProxy::redisConnected (int status)
+{
+    if (status != REDIS_OK)
+    {
+        logStream (MESSAGE_ERROR) << "Redis connection error: " << redisConn->errstr << sendLog;
+        // context is freed by hiredis
+        pollFDClosed (redisConn->c.fd);
+        redisConn = NULL;
+        redisWrite = false;
+        redisReconnect = getNow () + RECONNECT_DELAY;
+        return;
+    }
+
+    logStream (MESSAGE_INFO) << "connected to Redis server" << sendLog;
+    redisReady = true;
+
+    // Redis might be restarted, register all devices and their values again
+    knownValues.clear ();
+    for (rts2core::connections_t::iterator iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
+    {
+        if ((*iter)->getOtherDevClient () != NULL)
+            queueConnection (*iter);
+    }
+    for (rts2core::connections_t::iterator iter = getCentraldConns ()->begin (); iter != getCentraldConns ()->end (); iter++)
+    {
+        if ((*iter)->getOtherDevClient () != NULL)
+            queueConnection (*iter);
+    }
+}
+
+void RedisProxy::redisDisconnected (int status)
+{
+    if (redisConn == NULL)
+        return;
+    if (status != REDIS_OK)
+        logStream (MESSAGE_ERROR) << "disconnected from Redis server: " << redisConn->errstr << sendLog;
+    // context is freed by hiredis
+    pollFDClosed (redisConn->c.fd);
+    redisConn = NULL;
+    redisReady = false;
+    redisWrite = false;
+    redisOutstanding = 0;
+    redisReconnect = getNow () + RECONNECT_DELAY;
+}
+
+void RedisProxy::redisReplied (redisReply *reply)
+{
+    redisOutstanding--;
+    // do not log every failed command, errors are reported by EXEC
+    if (reply != NULL && reply->type == REDIS_REPLY_ERROR && reply->str != NULL && strncmp (reply->str, "EXECABORT", 9) == 0)
+        logStream (MESSAGE_ERROR) << "Redis transaction failed: " << reply->str << sendLog;
+}
+
+void RedisProxy::connectRedis ()
+{
+    redisConn = redisAsyncConnect ("127.0.0.1", 6379);
+    if (redisConn == NULL)
+    {
+        logStream (MESSAGE_ERROR) << "cannot allocate Redis context" << sendLog;
+        redisReconnect = getNow () + RECONNECT_DELAY;
+        return;
+    }
+    if (redisConn->err)
+    {
+        logStream (MESSAGE_ERROR) << "Redis connection error: " << redisConn->errstr << sendLog;
+        redisAsyncFree (redisConn);
+        redisConn = NULL;
+        redisReconnect = getNow () + RECONNECT_DELAY;
+        return;
+    }
+
+    redisConn->data = this;
+    redisConn->ev.data = this;
+    redisConn->ev.addRead = onRedisNoop;
+    redisConn->ev.delRead = onRedisNoop;
+    redisConn->ev.addWrite = onRedisAddWrite;
+    redisConn->ev.delWrite = onRedisDelWrite;
+    redisConn->ev.cleanup = onRedisNoop;
+
+    // non-blocking connect is finished when socket becomes writable
+    redisWrite = true;
+
+    redisAsyncSetConnectCallback (redisConn, onRedisConnect);
+    redisAsyncSetDisconnectCallback (redisConn, onRedisDisconnect);
+}
+
+string RedisProxy::getConnName (rts2core::Connection *conn)
+{
+    if (conn->getOtherType () == DEVICE_TYPE_SERVERD || conn->getName ()[0] == '\0')
+        return string ("centrald");
+    return string (conn->getName ());
+}
+
+void RedisProxy::queueConnection (rts2core::Connection *conn)
+{
+    string connName = getConnName (conn);
+
+    vector <string> args;
+    args.push_back ("SADD");
+    args.push_back ("rts2:devices");
+    args.push_back (connName);
+    command (args);
+
+    DeviceChanges &dc = pendingChanges[connName];
+    dc.state = true;
+    dc.stateValue = conn->getState ();
+
+    for (rts2core::ValueVector::iterator iter = conn->valueBegin (); iter != conn->valueEnd (); iter++)
+        queueValue (connName, *iter);
+}
+
+void RedisProxy::queueValue (const string &connName, rts2core::Value *value)
+{
+    const char *v = value->getValue ();
+    map <string, string> &changes = pendingChanges[connName].values;
+    map <string, string>::iterator iter = changes.find (value->getName ());
+    if (iter != changes.end ())
+    {
+        redisCoalesced->inc ();
+        iter->second = string (v == NULL ? "" : v);
+    }
+    else
+    {
+        changes[value->getName ()] = string (v == NULL ? "" : v);
+    }
+}
+
+void RedisProxy::flushChanges ()
+{
+    // keep coalescing changes while Redis is not available or is slow
+    if (pendingChanges.empty () || redisConn == NULL || redisReady == false || redisOutstanding > MAX_OUTSTANDING)
+        return;
+
+    vector <string> args;
+    args.push_back ("MULTI");
+    command (args);
+
+    for (map <string, DeviceChanges>::iterator iter = pendingChanges.begin (); iter != pendingChanges.end (); iter++)
+    {
+        const string &connName = iter->first;
+        DeviceChanges &dc = iter->second;
+        if (dc.state)
+        {
+            ostringstream os;
+            os << dc.stateValue;
+            args.clear ();
+            args.push_back ("SET");
+            args.push_back ("rts2:" + connName + ":State");
+            args.push_back (os.str ());
+            command (args);
+
+            args.clear ();
+            args.push_back ("PUBLISH");
+            args.push_back (connName);
+            args.push_back ("state");
+            command (args);
+        }
+
+        if (dc.values.empty ())
+            continue;
+
+        // names of new values
+        set <string> &known = knownValues[connName];
+        args.clear ();
+        args.push_back ("SADD");
+        args.push_back ("rts2:" + connName + ":values");
+        for (map <string, string>::iterator viter = dc.values.begin (); viter != dc.values.end (); viter++)
+        {
+            if (known.insert (viter->first).second)
+                args.push_back (viter->first);
+        }
+        if (args.size () > 2)
+            command (args);
+
+        // all values of the device in single hash
+        args.clear ();
+        args.push_back ("HMSET");
+        args.push_back ("rts2:" + connName);
+        for (map <string, string>::iterator viter = dc.values.begin (); viter != dc.values.end (); viter++)
+        {
+            args.push_back (viter->first);
+            args.push_back (viter->second);
+        }
+        command (args);
+
+        for (map <string, string>::iterator viter = dc.values.begin (); viter != dc.values.end (); viter++)
+        {
+            args.clear ();
+            args.push_back ("PUBLISH");
+            args.push_back (connName);
+            args.push_back ("value " + viter->first);
+            command (args);
+        }
+    }
+
+    args.clear ();
+    args.push_back ("EXEC");
+    command (args);
+
+    pendingChanges.clear ();
+}
+
+void RedisProxy::command (vector <string> &args)
+{
+    if (redisConn == NULL || redisReady == false)
+    {
+        redisDropped->inc ();
+        return;
+    }
+
+    vector <const char *> argv;
+    vector <size_t> argvlen;
+    for (vector <string>::iterator iter = args.begin (); iter != args.end (); iter++)
+    {
+        argv.push_back (iter->c_str ());
+        argvlen.push_back (iter->length ());
+    }
+    if (redisAsyncCommandArgv (redisConn, onRedisReply, this, argv.size (), &argv[0], &argvlen[0]) != REDIS_OK)
+    {
+        redisDropped->inc ();
+        return;
+    }
+    redisOutstanding++;
+    redisCommands->inc ();
 }
 
 int main (int argc, char **argv)
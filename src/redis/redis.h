@@ -27,6 +27,12 @@
 #include <rts2db/target.h>
 #include <devclient.h>
 #include <hiredis.h>
+#include <async.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 class RedisProxy : public rts2db::DeviceDb
 {
@@ -57,11 +63,35 @@ public:
 
     virtual void message (rts2core::Message & msg);
 
+    /**
+     * Called by hiredis when connection to Redis server is established or failed.
+     */
+    void redisConnected (int status);
+
+    /**
+     * Called by hiredis when connection to Redis server was closed.
+     */
+    void redisDisconnected (int status);
+
+    /**
+     * Called for every reply from Redis server.
+     */
+    void redisReplied (redisReply *reply);
+
+    // hiredis event hooks
+    void setRedisWrite (bool write) { redisWrite = write; }
+
 protected:
     virtual int processOption (int in_opt);
 
     virtual int init ();
 
+    virtual int idle ();
+
+    virtual void addPollSocks ();
+
+    virtual void pollSuccess ();
+
     virtual int reloadConfig ();
 
     virtual int setValue (rts2core::Value *oldValue, rts2core::Value *newValue);
@@ -70,7 +100,59 @@ protected:
 
 private:
     rts2core::ConnNotify *notifyConn;
-    redisContext *redisConn;
+    redisAsyncContext *redisConn;
+
+    // true when connected to Redis server
+    bool redisReady;
+    // true when hiredis has data to write
+    bool redisWrite;
+    // time of the next connection attempt
+    double redisReconnect;
+    // number of commands waiting for reply
+    int redisOutstanding;
+
+    rts2core::ValueLong *redisCommands;
+    rts2core::ValueLong *redisCoalesced;
+    rts2core::ValueLong *redisDropped;
+
+    /**
+     * Changes of device state and values, collected during single run
+     * loop iteration. Only the latest value is kept.
+     */
+    struct DeviceChanges
+    {
+        DeviceChanges (): state (false), stateValue (0), values () {}
+        bool state;
+        rts2_status_t stateValue;
+        std::map <std::string, std::string> values;
+    };
+
+    std::map <std::string, DeviceChanges> pendingChanges;
+
+    // names of values already added to rts2:<device>:values sets
+    std::map <std::string, std::set <std::string> > knownValues;
+
+    void connectRedis ();
+
+    std::string getConnName (rts2core::Connection *conn);
+
+    /**
+     * Queue state and all values of the connection.
+     */
+    void queueConnection (rts2core::Connection *conn);
+
+    void queueValue (const std::string &connName, rts2core::Value *value);
+
+    /**
+     * Send changes collected during run loop iteration as a single
+     * MULTI/EXEC transaction.
+     */
+    void flushChanges ();
+
+    /**
+     * Append command to Redis output buffer.
+     */
+    void command (std::vector <std::string> &args);
 };
 
 class RedisProxyClient : public rts2core::DevClient
@@ -0,0 +1,55 @@
+-- sky pixels for indexed cone searches, see include/skypixel.h
+-- ra, dec
+CREATE OR REPLACE FUNCTION ln_sky_pixel (float8, float8)
+  RETURNS int4 AS 'pg_astrolib.so', 'ln_sky_pixel' LANGUAGE 'c' IMMUTABLE STRICT;
+
+-- ra, dec, radius
+CREATE OR REPLACE FUNCTION ln_sky_pixels (float8, float8, float8)
+  RETURNS int4[] AS 'pg_astrolib.so', 'ln_sky_pixels' LANGUAGE 'c' IMMUTABLE STRICT;
+
+CREATE OR REPLACE FUNCTION img_wcs2_pixels (wcs2)
+  RETURNS int4[] AS 'pg_wcs2.so', 'img_wcs2_pixels' LANGUAGE 'c' IMMUTABLE STRICT;
+
+-- pixels are kept up to date by triggers, so clients do not need to care about them
+ALTER TABLE targets ADD COLUMN tar_pixel integer;
+ALTER TABLE observations ADD COLUMN obs_pixel integer;
+ALTER TABLE images ADD COLUMN img_pixels integer[];
+
+CREATE OR REPLACE FUNCTION targets_pixel () RETURNS trigger AS '
+BEGIN
+	NEW.tar_pixel := ln_sky_pixel (NEW.tar_ra, NEW.tar_dec);
+	RETURN NEW;
+END;
+' LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION observations_pixel () RETURNS trigger AS '
+BEGIN
+	NEW.obs_pixel := ln_sky_pixel (NEW.obs_ra, NEW.obs_dec);
+	RETURN NEW;
+END;
+' LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION images_pixels () RETURNS trigger AS '
+BEGIN
+	NEW.img_pixels := img_wcs2_pixels (NEW.astrometry);
+	RETURN NEW;
+END;
+' LANGUAGE plpgsql;
+
+CREATE TRIGGER targets_pixel BEFORE INSERT OR UPDATE ON targets
+  FOR EACH ROW EXECUTE PROCEDURE targets_pixel ();
+
+CREATE TRIGGER observations_pixel BEFORE INSERT OR UPDATE ON observations
+  FOR EACH ROW EXECUTE PROCEDURE observations_pixel ();
+
+CREATE TRIGGER images_pixels BEFORE INSERT OR UPDATE ON images
+  FOR EACH ROW EXECUTE PROCEDURE images_pixels ();
+
+-- fill pixels of existing rows
+UPDATE targets SET tar_pixel = ln_sky_pixel (tar_ra, tar_dec);
+UPDATE observations SET obs_pixel = ln_sky_pixel (obs_ra, obs_dec);
+UPDATE images SET img_pixels = img_wcs2_pixels (astrometry) WHERE astrometry IS NOT NULL;
+
+CREATE INDEX targets_pixel ON targets (tar_pixel);
+CREATE INDEX observations_pixel ON observations (obs_pixel);
+CREATE INDEX images_pixels ON images USING gin (img_pixels);
@@ -309,6 +309,10 @@ int TelModelTest::init ()
 		}
 	}
 
+	// every tested position is different, cached corrections would be recalculated for each of them
+	telescope->disableCorrectionCache ();
+	gemTelescope->disableCorrectionCache ();
+
 	if (tPointModelFile && rts2ModelFile)
 	{
 		std::cerr << "You cannot specify both T-Point and RTS2 model, exiting" << std::endl;
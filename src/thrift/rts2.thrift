@@ -32,5 +32,9 @@ struct MountInfo {
 
 service MountService {
   MountInfo info(),
+// Returns the first MountInfo with infotime newer than the given infotime.
+// Waits at most timeout seconds (up to 60) for mount update, returns
+// the current info if mount was not updated.
+  MountInfo nextInfo(1: double infotime, 2: double timeout),
   i32 Slew(1: RaDec target)
 }
@@ -1,16 +1,29 @@
 // based on autogenerated Thrift skeleton
 
+#include <errno.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "device.h"
 #include <libnova/libnova.h>
 
 #include "MountService.h"
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/concurrency/PosixThreadFactory.h>
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/server/TSimpleServer.h>
+#include <thrift/server/TThreadedServer.h>
+#include <thrift/server/TThreadPoolServer.h>
 #include <thrift/transport/TServerSocket.h>
 #include <thrift/transport/TBufferTransports.h>
 
+#define OPT_SERVER        OPT_LOCAL + 1
+#define OPT_THREADS       OPT_LOCAL + 2
+
+// maximal time nextInfo waits for new info, in seconds
+#define MAX_WAIT          60
+
 using namespace ::apache::thrift;
+using namespace ::apache::thrift::concurrency;
 using namespace ::apache::thrift::protocol;
 using namespace ::apache::thrift::transport;
 using namespace ::apache::thrift::server;
@@ -19,25 +32,287 @@ using boost::shared_ptr;
 
 using namespace  ::rts2;
 
+/**
+ * Mount state published by the device thread and read by Thrift server
+ * threads. Protected by a sequence lock - writer never waits for readers,
+ * readers retry if the state was modified while they were copying it.
+ * Readers waiting for the next update sleep on condition, which is signalled
+ * after each update.
+ */
+class MountSnapshot
+{
+	public:
+		MountSnapshot ()
+		{
+			sequence = 0;
+			memset (&state, 0, sizeof (state));
+			pthread_mutex_init (&mutex, NULL);
+			pthread_cond_init (&cond, NULL);
+		}
+
+		~MountSnapshot ()
+		{
+			pthread_cond_destroy (&cond);
+			pthread_mutex_destroy (&mutex);
+		}
+
+		/**
+		 * Publish new state. Must be called only from the device thread.
+		 */
+		void publish (const MountInfo &info)
+		{
+			State s;
+			s.infotime = info.infotime;
+			s.ori_ra = info.ORI.ra;
+			s.ori_dec = info.ORI.dec;
+			s.offs_ra = info.offsets.ra;
+			s.offs_dec = info.offsets.dec;
+			s.altaz_offs_az = info.altAzOffsets.az;
+			s.altaz_offs_alt = info.altAzOffsets.alt;
+			s.tel_ra = info.TEL.ra;
+			s.tel_dec = info.TEL.dec;
+			s.hrz_az = info.HRZ.az;
+			s.hrz_alt = info.HRZ.alt;
+			s.jd = info.JulianDay;
+
+			// odd sequence marks state being written
+			sequence++;
+			__sync_synchronize ();
+			state = s;
+			__sync_synchronize ();
+			sequence++;
+
+			pthread_mutex_lock (&mutex);
+			pthread_cond_broadcast (&cond);
+			pthread_mutex_unlock (&mutex);
+		}
+
+		/**
+		 * Returns the current state. Does not block.
+		 */
+		void read (MountInfo &info)
+		{
+			State s;
+			unsigned int seq;
+			do
+			{
+				seq = sequence;
+				__sync_synchronize ();
+				s = state;
+				__sync_synchronize ();
+			}
+			while ((seq & 1) || seq != sequence);
+
+			info.infotime = s.infotime;
+			info.ORI.ra = s.ori_ra;
+			info.ORI.dec = s.ori_dec;
+			info.offsets.ra = s.offs_ra;
+			info.offsets.dec = s.offs_dec;
+			info.altAzOffsets.az = s.altaz_offs_az;
+			info.altAzOffsets.alt = s.altaz_offs_alt;
+			info.TEL.ra = s.tel_ra;
+			info.TEL.dec = s.tel_dec;
+			info.HRZ.az = s.hrz_az;
+			info.HRZ.alt = s.hrz_alt;
+			info.JulianDay = s.jd;
+		}
+
+		/**
+		 * Wait for state with infotime newer than the given time.
+		 *
+		 * @param info      returns the state
+		 * @param infotime  infotime of the last state known to the caller
+		 * @param timeout   maximal wait time, in seconds
+		 *
+		 * @return true if newer state was found, false on timeout
+		 */
+		bool waitNext (MountInfo &info, double infotime, double timeout)
+		{
+			read (info);
+			if (info.infotime > infotime || !(timeout > 0))
+				return info.infotime > infotime;
+
+			if (timeout > MAX_WAIT)
+				timeout = MAX_WAIT;
+
+			struct timeval now;
+			gettimeofday (&now, NULL);
+			double end = now.tv_sec + now.tv_usec / 1e6 + timeout;
+			struct timespec abstime;
+			abstime.tv_sec = (time_t) end;
+			abstime.tv_nsec = (long) ((end - abstime.tv_sec) * 1e9);
+
+			bool ret = false;
+			pthread_mutex_lock (&mutex);
+			while (true)
+			{
+				// publish signals under the mutex, so no update can be missed
+				read (info);
+				if (info.infotime > infotime)
+				{
+					ret = true;
+					break;
+				}
+				if (pthread_cond_timedwait (&cond, &mutex, &abstime) == ETIMEDOUT)
+					break;
+			}
+			pthread_mutex_unlock (&mutex);
+			return ret;
+		}
+
+	private:
+		struct State
+		{
+			double infotime;
+			double ori_ra;
+			double ori_dec;
+			double offs_ra;
+			double offs_dec;
+			double altaz_offs_az;
+			double altaz_offs_alt;
+			double tel_ra;
+			double tel_dec;
+			double hrz_az;
+			double hrz_alt;
+			double jd;
+		};
+
+		volatile unsigned int sequence;
+		State state;
+
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+};
+
 // RTS2 thrift service..
 class ThriftD: public rts2core::Device
 {
 	public:
 		ThriftD (int argc, char **argv);
+		virtual ~ThriftD ();
+
 		virtual int idle ();
 
-		MountInfo mountInfo;
+		/**
+		 * Request slew of the mount. Can be called from any thread, the
+		 * command is send from the device thread.
+		 */
+		void requestSlew (double ra, double dec);
+
+		/**
+		 * Run Thrift server. Returns when server is stopped.
+		 */
+		void serve ();
+
+		MountSnapshot mountSnapshot;
 
 	protected:
+		virtual int processOption (int opt);
+		virtual void beforeRun ();
 		virtual int willConnect (rts2core::NetworkAddress * _addr);
+
+	private:
+		// mount info collected in the device thread
+		MountInfo mountInfo;
+
+		int port;
+		// simple, threaded or pool
+		const char *serverType;
+		int threads;
+
+		pthread_t thriftThread;
+
+		// protects slew request
+		pthread_mutex_t slewMutex;
+		bool slewRequested;
+		double slewRa;
+		double slewDec;
 };
 
 ThriftD::ThriftD (int argc, char **argv): rts2core::Device (argc, argv, DEVICE_TYPE_THRIFT, "THRIFT")
 {
+	port = 9093;
+	serverType = "pool";
+	threads = 8;
+
+	slewRequested = false;
+	slewRa = NAN;
+	slewDec = NAN;
+	pthread_mutex_init (&slewMutex, NULL);
+
+	addOption ('p', NULL, 1, "Thrift port. Default to 9093");
+	addOption (OPT_SERVER, "server", 1, "Thrift server type - simple (single client), threaded (thread per client) or pool (default)");
+	addOption (OPT_THREADS, "threads", 1, "number of threads of pool server. Default to 8");
+}
+
+ThriftD::~ThriftD ()
+{
+	pthread_mutex_destroy (&slewMutex);
+}
+
+int ThriftD::processOption (int opt)
+{
+	switch (opt)
+	{
+		case 'p':
+			port = atoi (optarg);
+			break;
+		case OPT_SERVER:
+			if (strcmp (optarg, "simple") && strcmp (optarg, "threaded") && strcmp (optarg, "pool"))
+			{
+				std::cerr << "invalid server type " << optarg << ", expected simple, threaded or pool" << std::endl;
+				return -1;
+			}
+			serverType = optarg;
+			break;
+		case OPT_THREADS:
+			threads = atoi (optarg);
+			if (threads <= 0)
+			{
+				std::cerr << "invalid number of threads " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		default:
+			return Device::processOption (opt);
+	}
+	return 0;
+}
+
+void *thrift_thread (void *args)
+{
+	((ThriftD *) args)->serve ();
+	return NULL;
+}
+
+void ThriftD::beforeRun ()
+{
+	Device::beforeRun ();
+
+	// server thread must be started in the daemonized process
+	int ret = pthread_create (&thriftThread, NULL, &thrift_thread, (void *) this);
+	if (ret)
+	{
+		logStream (MESSAGE_ERROR) << "cannot start Thrift server thread: " << strerror (ret) << sendLog;
+		exit (1);
+	}
 }
 
 int ThriftD::idle ()
 {
+	pthread_mutex_lock (&slewMutex);
+	bool slew = slewRequested;
+	double ra = slewRa;
+	double dec = slewDec;
+	slewRequested = false;
+	pthread_mutex_unlock (&slewMutex);
+
+	if (slew)
+	{
+		rts2core::CommandMove cmd (this, NULL, ra, dec);
+		queueCommandForType (DEVICE_TYPE_MOUNT, cmd);
+	}
+
 	rts2core::Connection *telConn = getOpenConnection (DEVICE_TYPE_MOUNT);
 	if (telConn != NULL)
 	{
@@ -46,45 +321,56 @@ int ThriftD::idle ()
 		rts2core::ValueAltAz *altAz;
 
 		val = telConn->getValue ("infotime");
-		if (val != NULL)
+		// publish only new information, to not wake up waiting clients
+		if (val != NULL && val->getValueDouble () != mountInfo.infotime)
 		{
 			mountInfo.infotime = val->getValueDouble ();
-		}
-		raDec = (rts2core::ValueRaDec *) telConn->getValue ("ORI");
-		if (raDec != NULL)
-		{
-			mountInfo.ORI.ra = raDec->getRa ();
-			mountInfo.ORI.dec = raDec->getDec ();
-		}
-		raDec = (rts2core::ValueRaDec *) telConn->getValue ("OFFS");
-		if (raDec != NULL)
-		{
-			mountInfo.offsets.ra = raDec->getRa ();
-			mountInfo.offsets.dec = raDec->getDec ();
-		}
-		raDec = (rts2core::ValueRaDec *) telConn->getValue ("TEL");
-		if (raDec != NULL)
-		{
-			mountInfo.TEL.ra = raDec->getRa ();
-			mountInfo.TEL.dec = raDec->getDec ();
-		}
-		altAz = (rts2core::ValueAltAz *) telConn->getValue ("TEL_");
-		if (altAz != NULL)
-		{
-			mountInfo.HRZ.alt = altAz->getAlt ();
-			mountInfo.HRZ.az = ln_range_degrees (altAz->getAz () + 180.0);
-		}
-		val = telConn->getValue ("JD");
-		if (val != NULL)
-		{
-			mountInfo.JulianDay = val->getValueDouble ();
-		}
 
+			raDec = (rts2core::ValueRaDec *) telConn->getValue ("ORI");
+			if (raDec != NULL)
+			{
+				mountInfo.ORI.ra = raDec->getRa ();
+				mountInfo.ORI.dec = raDec->getDec ();
+			}
+			raDec = (rts2core::ValueRaDec *) telConn->getValue ("OFFS");
+			if (raDec != NULL)
+			{
+				mountInfo.offsets.ra = raDec->getRa ();
+				mountInfo.offsets.dec = raDec->getDec ();
+			}
+			raDec = (rts2core::ValueRaDec *) telConn->getValue ("TEL");
+			if (raDec != NULL)
+			{
+				mountInfo.TEL.ra = raDec->getRa ();
+				mountInfo.TEL.dec = raDec->getDec ();
+			}
+			altAz = (rts2core::ValueAltAz *) telConn->getValue ("TEL_");
+			if (altAz != NULL)
+			{
+				mountInfo.HRZ.alt = altAz->getAlt ();
+				mountInfo.HRZ.az = ln_range_degrees (altAz->getAz () + 180.0);
+			}
+			val = telConn->getValue ("JD");
+			if (val != NULL)
+			{
+				mountInfo.JulianDay = val->getValueDouble ();
+			}
 
+			mountSnapshot.publish (mountInfo);
+		}
 	}
 	return Device::idle ();
 }
 
+void ThriftD::requestSlew (double ra, double dec)
+{
+	pthread_mutex_lock (&slewMutex);
+	slewRequested = true;
+	slewRa = ra;
+	slewDec = dec;
+	pthread_mutex_unlock (&slewMutex);
+}
+
 int ThriftD::willConnect (rts2core::NetworkAddress *_addr)
 {
 	if (_addr->getType () < getDeviceType () || (_addr->getType () == getDeviceType () && strcmp (_addr->getName (), getDeviceName ()) < 0))
@@ -94,53 +380,66 @@ int ThriftD::willConnect (rts2core::NetworkAddress *_addr)
 
 ThriftD *rts2Device;
 
-void *rts2_thread (void *args)
-{
-	rts2Device->run ();
-	return NULL;
-}
-
 class MountServiceHandler : virtual public MountServiceIf {
 	public:
 		MountServiceHandler() {
 		}
 
 		void info(MountInfo& _return) {
-			_return = rts2Device->mountInfo;
+			rts2Device->mountSnapshot.read (_return);
+		}
+
+		void nextInfo(MountInfo& _return, const double infotime, const double timeout) {
+			rts2Device->mountSnapshot.waitNext (_return, infotime, timeout);
 		}
 
 		int32_t Slew(const RaDec& target) {
-			rts2core::CommandMove cmd (rts2Device, NULL, target.ra, target.dec);
-			rts2Device->queueCommandForType (DEVICE_TYPE_MOUNT, cmd);
+			rts2Device->requestSlew (target.ra, target.dec);
 			return 0;
 		}
 };
 
-void *thrift_thread (void *args)
+void ThriftD::serve ()
 {
-		int port = 9093;
-		shared_ptr<MountServiceHandler> handler(new MountServiceHandler());
-		shared_ptr<TProcessor> processor(new MountServiceProcessor(handler));
-		shared_ptr<TServerTransport> serverTransport(new TServerSocket(port));
-		shared_ptr<TTransportFactory> transportFactory(new TBufferedTransportFactory());
-		shared_ptr<TProtocolFactory> protocolFactory(new TBinaryProtocolFactory());
-
-		TSimpleServer server(processor, serverTransport, transportFactory, protocolFactory);
-		server.serve();
-		return NULL;
+	shared_ptr<MountServiceHandler> handler(new MountServiceHandler());
+	shared_ptr<TProcessor> processor(new MountServiceProcessor(handler));
+	shared_ptr<TServerTransport> serverTransport(new TServerSocket(port));
+	shared_ptr<TTransportFactory> transportFactory(new TBufferedTransportFactory());
+	shared_ptr<TProtocolFactory> protocolFactory(new TBinaryProtocolFactory());
+
+	try
+	{
+		if (!strcmp (serverType, "simple"))
+		{
+			TSimpleServer server(processor, serverTransport, transportFactory, protocolFactory);
+			server.serve();
+		}
+		else if (!strcmp (serverType, "threaded"))
+		{
+			TThreadedServer server(processor, serverTransport, transportFactory, protocolFactory);
+			server.serve();
+		}
+		else
+		{
+			// clients waiting in nextInfo occupy pool threads
+			shared_ptr<ThreadManager> threadManager = ThreadManager::newSimpleThreadManager(threads);
+			shared_ptr<PosixThreadFactory> threadFactory(new PosixThreadFactory());
+			threadManager->threadFactory(threadFactory);
+			threadManager->start();
+
+			TThreadPoolServer server(processor, serverTransport, transportFactory, protocolFactory, threadManager);
+			server.serve();
+		}
+	}
+	catch (TException &ex)
+	{
+		logStream (MESSAGE_ERROR) << "Thrift server failed: " << ex.what () << sendLog;
+	}
 }
 
 int main (int argc, char **argv)
 {
 		rts2Device = new ThriftD (argc, argv);
- 
-		pthread_t thrift_thr;
-		pthread_t rts2_thr;
-
-		pthread_create (&rts2_thr, NULL, &rts2_thread, NULL);
-		pthread_create (&thrift_thr, NULL, &thrift_thread, NULL);
-
-		pthread_join (thrift_thr, NULL);
-		pthread_join (rts2_thr, NULL);
-		return 0;
+		// Thrift server thread is started from init, after options are parsed
+		return rts2Device->run ();
 }
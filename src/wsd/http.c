@@ -420,7 +420,7 @@ bail:
 
 	case LWS_CALLBACK_ADD_POLL_FD:
 
-		if (count_pollfds >= max_poll_elements) {
+		if (count_pollfds >= max_poll_elements || pa->fd >= max_poll_elements) {
 			lwsl_err("LWS_CALLBACK_ADD_POLL_FD: too many sockets to track\n");
 			return 1;
 		}
@@ -432,6 +432,7 @@ bail:
 		break;
 
 	case LWS_CALLBACK_DEL_POLL_FD:
+		poll_fd_closed(pa->fd);
 		if (!--count_pollfds)
 			break;
 		m = fd_lookup[pa->fd];
@@ -0,0 +1,166 @@
+/*
+ * WebSocket client receiving value and state changes.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "pushclient.h"
+
+#include <math.h>
+#include <sstream>
+
+// maximal length of command received from client
+#define MAX_COMMAND_LEN    4096
+
+// estimated size of encoded state
+#define STATE_SIZE         64
+
+using namespace rts2wsd;
+
+PushClient::PushClient (struct lws *_wsi, size_t _maxQueue)
+{
+	wsi = _wsi;
+	maxQueue = _maxQueue;
+	queued = 0;
+	coalesced = 0;
+	overflown = false;
+}
+
+bool PushClient::queueValue (const std::string &device, const std::string &name, const std::string &json)
+{
+	if (overflown)
+		return false;
+
+	DeviceFrame &df = getFrame (device);
+	std::map <std::string, std::string>::iterator iter = df.values.find (name);
+	if (iter != df.values.end ())
+	{
+		queued -= iter->second.length ();
+		iter->second = json;
+		coalesced++;
+	}
+	else
+	{
+		df.values[name] = json;
+	}
+	queued += json.length ();
+
+	if (queued > maxQueue)
+		return overflow ();
+	return true;
+}
+
+bool PushClient::queueState (const std::string &device, rts2_status_t state, double progressStart, double progressEnd)
+{
+	if (overflown)
+		return false;
+
+	DeviceFrame &df = getFrame (device);
+	if (df.state)
+	{
+		coalesced++;
+	}
+	else
+	{
+		df.state = true;
+		queued += STATE_SIZE;
+	}
+	df.value = state;
+	df.progressStart = progressStart;
+	df.progressEnd = progressEnd;
+
+	if (queued > maxQueue)
+		return overflow ();
+	return true;
+}
+
+void PushClient::popFrame (std::string &frame)
+{
+	std::map <std::string, DeviceFrame>::iterator iter = pending.find (order.front ());
+	order.pop_front ();
+
+	DeviceFrame &df = iter->second;
+
+	std::ostringstream os;
+	os << std::fixed << "{\"d\":\"" << iter->first << "\",\"t\":" << getNow ();
+	if (df.state)
+	{
+		os << ",\"s\":" << df.value;
+		if (!isnan (df.progressStart))
+			os << ",\"sf\":" << df.progressStart;
+		if (!isnan (df.progressEnd))
+			os << ",\"st\":" << df.progressEnd;
+		queued -= STATE_SIZE;
+	}
+	if (!df.values.empty ())
+	{
+		os << ",\"v\":{";
+		for (std::map <std::string, std::string>::iterator viter = df.values.begin (); viter != df.values.end (); viter++)
+		{
+			if (viter != df.values.begin ())
+				os << ",";
+			os << viter->second;
+			queued -= viter->second.length ();
+		}
+		os << "}";
+	}
+	os << "}";
+
+	pending.erase (iter);
+	frame = os.str ();
+}
+
+bool PushClient::addReceived (const char *data, size_t len)
+{
+	if (received.length () + len > MAX_COMMAND_LEN)
+	{
+		received.clear ();
+		return false;
+	}
+	received.append (data, len);
+	return true;
+}
+
+std::string PushClient::takeCommand ()
+{
+	std::string ret;
+	ret.swap (received);
+	return ret;
+}
+
+PushClient::DeviceFrame &PushClient::getFrame (const std::string &device)
+{
+	std::map <std::string, DeviceFrame>::iterator iter = pending.find (device);
+	if (iter != pending.end ())
+		return iter->second;
+
+	order.push_back (device);
+	DeviceFrame &df = pending[device];
+	df.state = false;
+	df.value = 0;
+	df.progressStart = NAN;
+	df.progressEnd = NAN;
+	return df;
+}
+
+bool PushClient::overflow ()
+{
+	pending.clear ();
+	order.clear ();
+	queued = 0;
+	overflown = true;
+	return false;
+}
@@ -0,0 +1,169 @@
+/*
+ * WebSocket client receiving value and state changes.
+ * Copyright (C) 2016 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_PUSHCLIENT__
+#define __RTS2_PUSHCLIENT__
+
+#include "status.h"
+#include "utilsfunc.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+struct lws;
+
+namespace rts2wsd
+{
+
+/**
+ * Client of the WebSocket gateway. Holds changes waiting to be sent to the
+ * client. Changes are coalesced - if a value changes again before the client
+ * was able to receive the previous change, only the latest value is sent.
+ * Changes of a device are sent together in a single frame, using the same
+ * format as the rts2-httpd /async API:
+ *
+ * {"d":"C0","t":1460000000.123,"s":1,"sf":..,"st":..,"v":{"exposure":[flags,10.0,0,0,"desc"]}}
+ *
+ * Size of the queued data is limited. If a client is not reading and the
+ * limit is reached, queued data are dropped and the client should be
+ * disconnected.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class PushClient
+{
+	public:
+		/**
+		 * @param _wsi       WebSocket connection of the client
+		 * @param _maxQueue  maximal size of queued data, in bytes
+		 */
+		PushClient (struct lws *_wsi, size_t _maxQueue);
+
+		struct lws *getWsi () { return wsi; }
+
+		/**
+		 * Record subscription to device states.
+		 */
+		void subscribe (const char *device) { devices.insert (ci_string (device)); }
+
+		/**
+		 * Returns true if client is subscribed to the device.
+		 */
+		bool isSubscribed (const char *device) { return devices.find (ci_string (device)) != devices.end (); }
+
+		/**
+		 * Remove all subscriptions.
+		 */
+		void unsubscribe () { devices.clear (); }
+
+		/**
+		 * Queue value change.
+		 *
+		 * @param device  device name
+		 * @param name    value name
+		 * @param json    JSON encoded value, including its name (see rts2json::jsonValue)
+		 *
+		 * @return false if queue limit was reached and client should be disconnected
+		 */
+		bool queueValue (const std::string &device, const std::string &name, const std::string &json);
+
+		/**
+		 * Queue state change.
+		 *
+		 * @return false if queue limit was reached and client should be disconnected
+		 */
+		bool queueState (const std::string &device, rts2_status_t state, double progressStart, double progressEnd);
+
+		/**
+		 * Returns true if there are data waiting to be sent.
+		 */
+		bool hasPending () { return !order.empty (); }
+
+		/**
+		 * Remove frame of the device with the oldest change from the
+		 * queue.
+		 *
+		 * @param frame  returns encoded frame
+		 */
+		void popFrame (std::string &frame);
+
+		/**
+		 * Add received data to command buffer.
+		 *
+		 * @return false if command is too long
+		 */
+		bool addReceived (const char *data, size_t len);
+
+		/**
+		 * Returns received command and clears command buffer.
+		 */
+		std::string takeCommand ();
+
+		/**
+		 * Size of queued data, in bytes.
+		 */
+		size_t getQueued () { return queued; }
+
+		/**
+		 * Number of changes replaced by newer change before they were sent.
+		 */
+		unsigned long getCoalesced () { return coalesced; }
+
+		/**
+		 * Client should be disconnected, as it did not read data fast enough.
+		 */
+		bool isOverflown () { return overflown; }
+
+	private:
+		struct DeviceFrame
+		{
+			bool state;
+			rts2_status_t value;
+			double progressStart;
+			double progressEnd;
+			// JSON encoded values with names, indexed by name
+			std::map <std::string, std::string> values;
+		};
+
+		struct lws *wsi;
+		size_t maxQueue;
+
+		std::set <ci_string> devices;
+
+		std::map <std::string, DeviceFrame> pending;
+		// devices with pending changes, in order of their first change
+		std::list <std::string> order;
+
+		size_t queued;
+		unsigned long coalesced;
+		bool overflown;
+
+		std::string received;
+
+		DeviceFrame &getFrame (const std::string &device);
+
+		// drop all queued data, mark client for disconnection
+		bool overflow ();
+};
+
+}
+
+#endif // !__RTS2_PUSHCLIENT__
@@ -19,6 +19,7 @@
 
 #include "rts2-config.h"
 #include "wsd.h"
+#include "pushclient.h"
 
 #ifdef RTS2_HAVE_PGSQL
 #include "rts2db/devicedb.h"
@@ -26,64 +27,20 @@
 #include "device.h"
 #endif
 
+#include "rts2json/jsonvalue.h"
+#include "rts2json/subscriptions.h"
+
+#include <sstream>
+
+#define OPT_MAX_QUEUE      OPT_LOCAL + 1
+
 int max_poll_elements;
 
 struct lws_pollfd *pollfds;
 int *fd_lookup;
 int count_pollfds;
 
-int callback_dumb_increment (struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
-{
-	unsigned char buf[LWS_PRE + 512];
-	struct per_session_data__dumb_increment *pss = (struct per_session_data__dumb_increment *)user;
-	unsigned char *p = &buf[LWS_PRE];
-	int n, m;
-
-	switch (reason) {
-
-	case LWS_CALLBACK_ESTABLISHED:
-		pss->number = 0;
-		break;
-
-	case LWS_CALLBACK_SERVER_WRITEABLE:
-		n = sprintf((char *)p, "%d", pss->number++);
-		m = lws_write(wsi, p, n, LWS_WRITE_TEXT);
-		if (m < n)
-		{
-			logStream (MESSAGE_ERROR) << "ERROR " << n << " writing to di socket" << sendLog;
-			return -1;
-		}
-		break;
-
-	case LWS_CALLBACK_RECEIVE:
-		if (len < 6)
-			break;
-		if (strcmp((const char *)in, "reset\n") == 0)
-			pss->number = 0;
-		if (strcmp((const char *)in, "closeme\n") == 0) {
-			logStream (MESSAGE_INFO) << "dumb_inc: closing as requested" << sendLog;
-			lws_close_reason(wsi, LWS_CLOSE_STATUS_GOINGAWAY, (unsigned char *)"seeya", 5);
-			return -1;
-		}
-		break;
-	/*
-	 * this just demonstrates how to handle
-	 * LWS_CALLBACK_WS_PEER_INITIATED_CLOSE and extract the peer's close
-	 * code and auxiliary data.  You can just not handle it if you don't
-	 * have a use for this.
-	 */
-	case LWS_CALLBACK_WS_PEER_INITIATED_CLOSE:
-		logStream (MESSAGE_INFO) << "LWS_CALLBACK_WS_PEER_INITIATED_CLOSE: len " << len << sendLog;
-		for (n = 0; n < (int)len; n++)
-			logStream (MESSAGE_INFO) << " " << n << ": " << ((unsigned char*) in)[n] << sendLog;
-		break;
-
-	default:
-		break;
-	}
-
-	return 0;
-}
+int callback_rts2 (struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len);
 
 static struct lws_protocols protocols[] = {
 	/* first protocol must always be HTTP handler */
@@ -94,15 +51,41 @@ static struct lws_protocols protocols[] = {
 		0			/* max frame size / rx buffer */
 	},
 	{
-		"dumb-increment-protocol",
-		callback_dumb_increment,
-		sizeof(struct per_session_data__dumb_increment),
-		10
-	}
+		"rts2-protocol",
+		callback_rts2,
+		sizeof (struct per_session_data__rts2),
+		4096
+	},
+	{ NULL, NULL, 0, 0 }
 };
 
+namespace rts2wsd
+{
+
 /**
- * Websocket access daemon.
+ * Passes value and state changes of a device to WsD.
+ */
+class WsDevClient:public rts2core::DevClient
+{
+	public:
+		WsDevClient (rts2core::Connection *_conn):rts2core::DevClient (_conn) {}
+
+		virtual void stateChanged (rts2core::ServerState *state);
+		virtual void valueChanged (rts2core::Value *value);
+};
+
+/**
+ * Websocket access daemon. Clients connect with rts2-protocol and send
+ * commands to subscribe to device values and states:
+ *
+ * <ul>
+ *   <li><b>subscribe</b> <i>device</i> [<i>value</i> ..] - subscribe to
+ *   device state and to the given values, or to all device values if no value
+ *   is given. Current state and values are sent immediately.</li>
+ *   <li><b>unsubscribe</b> - remove all client subscriptions.</li>
+ * </ul>
+ *
+ * Changes are sent as JSON text frames, see PushClient.
  *
  * @author Petr Kubanek <petr@kubanek.net>
  */
@@ -116,35 +99,242 @@ class WsD:public rts2core::Device
 		WsD (int argc, char **argv);
 		virtual ~WsD ();
 
+		virtual rts2core::DevClient *createOtherType (rts2core::Connection *conn, int other_device_type);
+
+		virtual void connectionRemoved (rts2core::Connection *conn);
+
+		void stateChangedEvent (rts2core::Connection *conn);
+		void valueChangedEvent (rts2core::Connection *conn, rts2core::Value *value);
+
+		PushClient *clientConnected (struct lws *wsi);
+		void clientClosed (PushClient *client);
+
+		/**
+		 * Process command received from the client.
+		 */
+		void command (PushClient *client, const std::string &cmd);
+
+		/**
+		 * Send queued frames to the client.
+		 *
+		 * @return -1 if client should be disconnected
+		 */
+		int clientWritable (PushClient *client);
+
 	protected:
 		virtual int processOption (int opt);
 		virtual int initHardware ();
+		virtual int info ();
+		virtual int idle ();
+
+		virtual void addPollSocks ();
+		virtual void pollSuccess ();
 #ifndef RTS2_HAVE_PGSQL
 		virtual int willConnect (NetworkAddress * _addr);
 #endif
 
 	private:
-		struct lws_context_creation_info info;
+		struct lws_context_creation_info creationInfo;
 		struct lws_context *context;
+
+		size_t maxQueue;
+
+		std::set <PushClient *> clients;
+		rts2json::SubscriptionIndex <PushClient *> subscriptions;
+
+		rts2core::ValueInteger *wsClients;
+		rts2core::ValueLong *wsFrames;
+		rts2core::ValueLong *wsCoalesced;
+		rts2core::ValueLong *wsSlow;
+
+		// coalesced changes of closed clients
+		unsigned long closedCoalesced;
+
+		void subscribe (PushClient *client, const char *device, const char *value);
+
+		void queueState (PushClient *client, rts2core::Connection *conn);
+		void queueValue (PushClient *client, const char *device, rts2core::Value *value, const std::string &json);
+
+		// queue of the client is full, client will be closed in writable callback
+		void slowClient (PushClient *client);
 };
 
+}
+
+using namespace rts2wsd;
+
+void WsDevClient::stateChanged (rts2core::ServerState *state)
+{
+	rts2core::DevClient::stateChanged (state);
+	((WsD *) getMaster ())->stateChangedEvent (getConnection ());
+}
+
+void WsDevClient::valueChanged (rts2core::Value *value)
+{
+	((WsD *) getMaster ())->valueChangedEvent (getConnection (), value);
+}
+
 #ifdef RTS2_HAVE_PGSQL
-WsD::WsD (int argc, char **argv):rts2db::DeviceDb (argc, argv, DEVICE_TYPE_HTTPD, "WSD")
+WsD::WsD (int argc, char **argv):rts2db::DeviceDb (argc, argv, DEVICE_TYPE_HTTPD, "WSD"), subscriptions (false)
 #else
-WsD::WsD (int argc, char **argv):rts2core::Device (argc, argv, DEVICE_TYPE_XMLRPC, "WSD")
+WsD::WsD (int argc, char **argv):rts2core::Device (argc, argv, DEVICE_TYPE_XMLRPC, "WSD"), subscriptions (false)
 #endif
 {
-	memset (&info, 0, sizeof info);
-	info.port = 8888;
+	memset (&creationInfo, 0, sizeof creationInfo);
+	creationInfo.port = 8888;
 
 	context = NULL;
 
+	maxQueue = 1024 * 1024;
+	closedCoalesced = 0;
+
+	createValue (wsClients, "clients", "number of connected WebSocket clients", false);
+	wsClients->setValueInteger (0);
+	createValue (wsFrames, "frames", "number of frames sent to clients", false);
+	wsFrames->setValueLong (0);
+	createValue (wsCoalesced, "coalesced", "number of changes replaced by newer change before they were sent", false);
+	wsCoalesced->setValueLong (0);
+	createValue (wsSlow, "slow_clients", "number of clients disconnected as they were not reading data", false);
+	wsSlow->setValueLong (0);
+
 	addOption ('p', NULL, 1, "websocket port. Default to 8888");
+	addOption (OPT_MAX_QUEUE, "max-queue", 1, "maximal size (in bytes) of data queued for a client. Slower clients are disconnected. Default to 1MB");
+
+	// libwebsockets timeouts should be checked every second
+	setTimeout (USEC_SEC);
 }
 
 WsD::~WsD()
 {
-	lws_context_destroy (context);
+	if (context)
+		lws_context_destroy (context);
+	for (std::set <PushClient *>::iterator iter = clients.begin (); iter != clients.end (); iter++)
+		delete *iter;
+	free (pollfds);
+	free (fd_lookup);
+}
+
+rts2core::DevClient *WsD::createOtherType (rts2core::Connection *conn, int other_device_type)
+{
+	return new WsDevClient (conn);
+}
+
+void WsD::connectionRemoved (rts2core::Connection *conn)
+{
+	subscriptions.connectionRemoved (conn);
+#ifdef RTS2_HAVE_PGSQL
+	DeviceDb::connectionRemoved (conn);
+#else
+	Device::connectionRemoved (conn);
+#endif
+}
+
+void WsD::stateChangedEvent (rts2core::Connection *conn)
+{
+	const char *device = rts2json::SubscriptionIndex <PushClient *>::getDeviceName (conn);
+	for (std::set <PushClient *>::iterator iter = clients.begin (); iter != clients.end (); iter++)
+	{
+		if ((*iter)->isSubscribed (device))
+			queueState (*iter, conn);
+	}
+}
+
+void WsD::valueChangedEvent (rts2core::Connection *conn, rts2core::Value *value)
+{
+	const std::vector <PushClient *> &subscribers = subscriptions.find (conn, value);
+	if (subscribers.empty ())
+		return;
+
+	// encode value only once for all subscribers
+	std::ostringstream os;
+	rts2json::jsonValue (value, true, os);
+	std::string json = os.str ();
+
+	const char *device = rts2json::SubscriptionIndex <PushClient *>::getDeviceName (conn);
+	for (std::vector <PushClient *>::const_iterator iter = subscribers.begin (); iter != subscribers.end (); iter++)
+		queueValue (*iter, device, value, json);
+}
+
+PushClient *WsD::clientConnected (struct lws *wsi)
+{
+	PushClient *client = new PushClient (wsi, maxQueue);
+	clients.insert (client);
+	return client;
+}
+
+void WsD::clientClosed (PushClient *client)
+{
+	subscriptions.unsubscribe (client);
+	closedCoalesced += client->getCoalesced ();
+	clients.erase (client);
+	delete client;
+}
+
+void WsD::command (PushClient *client, const std::string &cmd)
+{
+	std::istringstream is (cmd);
+	std::string c;
+	is >> c;
+	if (c == "subscribe")
+	{
+		std::string device;
+		is >> device;
+		if (is.fail ())
+		{
+			logStream (MESSAGE_WARNING) << "missing device name in subscribe command" << sendLog;
+			return;
+		}
+		std::string value;
+		is >> value;
+		if (is.fail ())
+		{
+			subscribe (client, device.c_str (), NULL);
+			return;
+		}
+		do
+		{
+			subscribe (client, device.c_str (), value.c_str ());
+			is >> value;
+		}
+		while (!is.fail ());
+	}
+	else if (c == "unsubscribe")
+	{
+		subscriptions.unsubscribe (client);
+		client->unsubscribe ();
+	}
+	else
+	{
+		logStream (MESSAGE_WARNING) << "unknow WebSocket command " << cmd << sendLog;
+	}
+}
+
+int WsD::clientWritable (PushClient *client)
+{
+	if (client->isOverflown ())
+	{
+		lws_close_reason (client->getWsi (), LWS_CLOSE_STATUS_POLICY_VIOLATION, (unsigned char *) "slow client", 11);
+		return -1;
+	}
+
+	std::string frame;
+	// do not queue more than a single partially written frame in libwebsockets
+	while (client->hasPending () && !lws_send_pipe_choked (client->getWsi ()))
+	{
+		client->popFrame (frame);
+		std::vector <unsigned char> buf (LWS_PRE + frame.length ());
+		memcpy (&buf[LWS_PRE], frame.data (), frame.length ());
+		if (lws_write (client->getWsi (), &buf[LWS_PRE], frame.length (), LWS_WRITE_TEXT) < 0)
+		{
+			logStream (MESSAGE_ERROR) << "cannot write frame to WebSocket client" << sendLog;
+			return -1;
+		}
+		wsFrames->inc ();
+	}
+
+	if (client->hasPending ())
+		lws_callback_on_writable (client->getWsi ());
+	return 0;
 }
 
 int WsD::processOption (int opt)
@@ -152,7 +342,10 @@ int WsD::processOption (int opt)
 	switch (opt)
 	{
 		case 'p':
-			info.port = atoi (optarg);
+			creationInfo.port = atoi (optarg);
+			break;
+		case OPT_MAX_QUEUE:
+			maxQueue = atol (optarg);
 			break;
 		default:
 #ifdef RTS2_HAVE_PGSQL
@@ -166,15 +359,26 @@ int WsD::processOption (int opt)
 
 int WsD::initHardware ()
 {
-	info.protocols = protocols;
+	max_poll_elements = getdtablesize ();
+	pollfds = (struct lws_pollfd *) malloc (max_poll_elements * sizeof (struct lws_pollfd));
+	fd_lookup = (int *) malloc (max_poll_elements * sizeof (int));
+	count_pollfds = 0;
+	if (pollfds == NULL || fd_lookup == NULL)
+	{
+		logStream (MESSAGE_ERROR) << "cannot allocate poll array" << sendLog;
+		return -1;
+	}
+
+	creationInfo.protocols = protocols;
+	creationInfo.user = this;
 
-	info.gid = -1;
-	info.uid = -1;
-	info.max_http_header_pool = 16;
-	info.options = LWS_SERVER_OPTION_ALLOW_NON_SSL_ON_SSL_PORT | LWS_SERVER_OPTION_VALIDATE_UTF8;
-	info.extensions = NULL;
-	info.timeout_secs = 5;
-	info.ssl_cipher_list = "ECDHE-ECDSA-AES256-GCM-SHA384:"
+	creationInfo.gid = -1;
+	creationInfo.uid = -1;
+	creationInfo.max_http_header_pool = 16;
+	creationInfo.options = LWS_SERVER_OPTION_ALLOW_NON_SSL_ON_SSL_PORT | LWS_SERVER_OPTION_VALIDATE_UTF8;
+	creationInfo.extensions = NULL;
+	creationInfo.timeout_secs = 5;
+	creationInfo.ssl_cipher_list = "ECDHE-ECDSA-AES256-GCM-SHA384:"
 			       "ECDHE-RSA-AES256-GCM-SHA384:"
 			       "DHE-RSA-AES256-GCM-SHA384:"
 			       "ECDHE-RSA-AES256-SHA384:"
@@ -187,7 +391,7 @@ int WsD::initHardware ()
 			       "!DHE-RSA-AES256-SHA256:"
 			       "!AES256-GCM-SHA384:"
 			       "!AES256-SHA256";
-	context = lws_create_context(&info);
+	context = lws_create_context(&creationInfo);
 	if (context == NULL)
 	{
 		logStream (MESSAGE_ERROR) << "cannot create libwebsocket context" << sendLog;
@@ -197,6 +401,62 @@ int WsD::initHardware ()
 	return 0;
 }
 
+int WsD::info ()
+{
+	wsClients->setValueInteger (clients.size ());
+	unsigned long coalesced = closedCoalesced;
+	for (std::set <PushClient *>::iterator iter = clients.begin (); iter != clients.end (); iter++)
+		coalesced += (*iter)->getCoalesced ();
+	wsCoalesced->setValueLong (coalesced);
+#ifdef RTS2_HAVE_PGSQL
+	return DeviceDb::info ();
+#else
+	return Device::info ();
+#endif
+}
+
+int WsD::idle ()
+{
+	// handle libwebsockets timeouts
+	if (context)
+		lws_service_fd (context, NULL);
+#ifdef RTS2_HAVE_PGSQL
+	return DeviceDb::idle ();
+#else
+	return Device::idle ();
+#endif
+}
+
+void WsD::addPollSocks ()
+{
+#ifdef RTS2_HAVE_PGSQL
+	DeviceDb::addPollSocks ();
+#else
+	Device::addPollSocks ();
+#endif
+	for (int i = 0; i < count_pollfds; i++)
+		addPollFD (pollfds[i].fd, pollfds[i].events);
+}
+
+void WsD::pollSuccess ()
+{
+#ifdef RTS2_HAVE_PGSQL
+	DeviceDb::pollSuccess ();
+#else
+	Device::pollSuccess ();
+#endif
+	if (context == NULL)
+		return;
+	for (int i = 0; i < count_pollfds; i++)
+		pollfds[i].revents = getPollEvents (pollfds[i].fd);
+	// servicing a descriptor can remove it from the array and move the last descriptor to its place
+	for (int i = 0; i < count_pollfds; i++)
+	{
+		if (pollfds[i].revents && lws_service_fd (context, &pollfds[i]) < 0)
+			break;
+	}
+}
+
 #ifndef RTS2_HAVE_PGSQL
 int WsD::willConnect (NetworkAddress *_addr)
 {
@@ -208,6 +468,112 @@ int WsD::willConnect (NetworkAddress *_addr)
 }
 #endif
 
+void WsD::subscribe (PushClient *client, const char *device, const char *value)
+{
+	subscriptions.subscribe (device, value, client);
+	client->subscribe (device);
+
+	// send current state and values
+	rts2core::Connection *conn = strcasecmp (device, "centrald") ? getOpenConnection (device) : getSingleCentralConn ();
+	if (conn == NULL)
+		return;
+
+	queueState (client, conn);
+
+	const char *dname = rts2json::SubscriptionIndex <PushClient *>::getDeviceName (conn);
+	if (value == NULL)
+	{
+		for (rts2core::ValueVector::iterator iter = conn->valueBegin (); iter != conn->valueEnd (); iter++)
+		{
+			std::ostringstream os;
+			rts2json::jsonValue (*iter, true, os);
+			queueValue (client, dname, *iter, os.str ());
+		}
+	}
+	else
+	{
+		rts2core::Value *v = conn->getValue (value);
+		if (v == NULL)
+			return;
+		std::ostringstream os;
+		rts2json::jsonValue (v, true, os);
+		queueValue (client, dname, v, os.str ());
+	}
+}
+
+void WsD::queueState (PushClient *client, rts2core::Connection *conn)
+{
+	if (client->isOverflown ())
+		return;
+	if (client->queueState (rts2json::SubscriptionIndex <PushClient *>::getDeviceName (conn), conn->getState (), conn->getProgressStart (), conn->getProgressEnd ()) == false)
+		slowClient (client);
+	lws_callback_on_writable (client->getWsi ());
+}
+
+void WsD::queueValue (PushClient *client, const char *device, rts2core::Value *value, const std::string &json)
+{
+	if (client->isOverflown ())
+		return;
+	if (client->queueValue (device, value->getName (), json) == false)
+		slowClient (client);
+	lws_callback_on_writable (client->getWsi ());
+}
+
+void WsD::slowClient (PushClient *client)
+{
+	logStream (MESSAGE_WARNING) << "WebSocket client is not reading data, disconnecting it" << sendLog;
+	wsSlow->inc ();
+}
+
+void poll_fd_closed (int fd)
+{
+	// descriptor can be closed and reopened in the same run loop iteration
+	rts2core::Block *master = (rts2core::Block *) getMasterApp ();
+	if (master)
+		master->pollFDClosed (fd);
+}
+
+int callback_rts2 (struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
+{
+	struct per_session_data__rts2 *pss = (struct per_session_data__rts2 *) user;
+	WsD *master = (WsD *) lws_context_user (lws_get_context (wsi));
+
+	switch (reason)
+	{
+		case LWS_CALLBACK_ESTABLISHED:
+			pss->client = master->clientConnected (wsi);
+			break;
+
+		case LWS_CALLBACK_CLOSED:
+			if (pss->client)
+				master->clientClosed ((PushClient *) pss->client);
+			pss->client = NULL;
+			break;
+
+		case LWS_CALLBACK_SERVER_WRITEABLE:
+			if (pss->client)
+				return master->clientWritable ((PushClient *) pss->client);
+			break;
+
+		case LWS_CALLBACK_RECEIVE:
+			if (pss->client == NULL)
+				break;
+			if (((PushClient *) pss->client)->addReceived ((const char *) in, len) == false)
+			{
+				lws_close_reason (wsi, LWS_CLOSE_STATUS_MESSAGE_TOO_LARGE, (unsigned char *) "command too long", 16);
+				return -1;
+			}
+			if (lws_is_final_fragment (wsi) && lws_remaining_packet_payload (wsi) == 0)
+				master->command ((PushClient *) pss->client, ((PushClient *) pss->client)->takeCommand ());
+			break;
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
 int main (int argc, char **argv)
 {
 	WsD device (argc, argv);
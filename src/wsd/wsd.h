@@ -21,13 +21,19 @@ struct per_session_data__http {
 	unsigned int client_finished:1;
 };
 
-struct per_session_data__dumb_increment
+struct per_session_data__rts2
 {
-	int number;
+	// rts2wsd::PushClient
+	void *client;
 };
 
 int callback_http (struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len);
 
+/**
+ * Called when libwebsockets removes file descriptor from the poll array.
+ */
+void poll_fd_closed (int fd);
+
 #ifdef __cplusplus
 };
 #endif